@@ -0,0 +1,180 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Benchmark of compression ratio and CPU cost of the delta codec in codec_tools.c
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Isrc extras/benchmarks/codec_bench.c src/data_tools/codec_tools.c -o codec_bench
+ *     ./codec_bench
+ *
+ * Encodes synthetic sensor series of int32 samples in blocks of different sizes and checks that they decode again.
+ * Prints one line per series and block size: series block ratio bytes/value packed% enc_ns/byte dec_ns/byte
+ * with ratio = raw size / encoded size and ns per raw byte (4 per sample).
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "data_tools/codec_tools.h"
+
+#define SAMPLES     4096
+
+static int32_t samples[SAMPLES];
+static int32_t decoded[SAMPLES];
+static uint8_t encoded[CODEC_BLOCK_MAX(SAMPLES) * 2];
+static volatile int32_t sink;
+
+typedef void (*generator)(int32_t * values, size_t n);
+
+// temperature in 0.01 degC, slow random walk
+static void gen_temperature(int32_t * values, size_t n) {
+    int32_t t = 2150;
+    for(size_t i = 0; i < n; i++) {
+        t += rand() % 7 - 3;
+        values[i] = t;
+    }
+}
+
+// energy meter, monotonic counter
+static void gen_counter(int32_t * values, size_t n) {
+    int32_t c = 1000000;
+    for(size_t i = 0; i < n; i++) {
+        c += 1 + rand() % 3;
+        values[i] = c;
+    }
+}
+
+// door or valve state, constant with rare steps
+static void gen_steps(int32_t * values, size_t n) {
+    int32_t s = 0;
+    for(size_t i = 0; i < n; i++) {
+        if(rand() % 100 == 0) { s = rand() % 4; }
+        values[i] = s;
+    }
+}
+
+// acceleration in mg, noise around 1 g
+static void gen_accel(int32_t * values, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+        values[i] = 1000 + rand() % 1001 - 500;
+    }
+}
+
+// incompressible worst case
+static void gen_random(int32_t * values, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+        values[i] = (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+    }
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// encodes all samples in blocks of block values, returns the encoded size and the number of packed blocks
+static size_t encode_all(uint8_t block, size_t * packedBlocks) {
+    codec_stream stream;
+    codec_stream_init(&stream, 0);
+    size_t size = 0;
+    *packedBlocks = 0;
+    for(size_t i = 0; i < SAMPLES; i += block) {
+        uint8_t n = SAMPLES - i < block ? (uint8_t)(SAMPLES - i) : block;
+        size_t len = codec_delta_encode(&stream, samples + i, n, encoded + size, sizeof(encoded) - size);
+        *packedBlocks += (encoded[size] & CODEC_BLOCK_PACKED) != 0;
+        size += len;
+    }
+    return size;
+}
+
+static bool decode_all(size_t size) {
+    codec_stream stream;
+    codec_stream_init(&stream, 0);
+    size_t pos = 0;
+    size_t count = 0;
+    while(pos < size) {
+        uint8_t n;
+        size_t len = codec_delta_decode(&stream, encoded + pos, size - pos, decoded + count, 255, &n);
+        if(len == 0) { return false; }
+        pos += len;
+        count += n;
+    }
+    return count == SAMPLES;
+}
+
+static int bench(char const * series, uint8_t block) {
+    size_t packedBlocks;
+    size_t const size = encode_all(block, &packedBlocks);
+    if(!decode_all(size) || memcmp(decoded, samples, sizeof(samples)) != 0) {
+        fprintf(stderr, "%s block %u: decoded samples differ\n", series, block);
+        return 1;
+    }
+    size_t const blocks = (SAMPLES + block - 1) / block;
+    size_t const iterations = 2000;
+
+    double start = now_ns();
+    for(size_t i = 0; i < iterations; i++) {
+        sink ^= (int32_t)encode_all(block, &packedBlocks);
+    }
+    double const encNs = now_ns() - start;
+    start = now_ns();
+    for(size_t i = 0; i < iterations; i++) {
+        sink ^= decode_all(size);
+        sink ^= decoded[i % SAMPLES];
+    }
+    double const decNs = now_ns() - start;
+
+    double const rawBytes = (double)iterations * sizeof(samples);
+    printf("%-11s %5u %7.2f %11.3f %7.1f %11.3f %11.3f\n", series, block, (double)sizeof(samples) / size,
+            (double)size / SAMPLES, 100.0 * packedBlocks / blocks, encNs / rawBytes, decNs / rawBytes);
+    return 0;
+}
+
+int main(void) {
+    static struct { char const * name; generator gen; } const series[] = {
+        { "temperature", gen_temperature },
+        { "counter", gen_counter },
+        { "steps", gen_steps },
+        { "accel", gen_accel },
+        { "random", gen_random },
+    };
+    static uint8_t const blocks[] = { 8, 16, 32, 64, 128, 255 };
+
+    printf("# series block ratio bytes/value packed%% enc_ns/byte dec_ns/byte\n");
+    for(size_t s = 0; s < sizeof(series) / sizeof(series[0]); s++) {
+        srand(1);
+        series[s].gen(samples, SAMPLES);
+        for(size_t b = 0; b < sizeof(blocks); b++) {
+            if(bench(series[s].name, blocks[b]) != 0) { return 1; }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Benchmark of the hex codec in string_tools.c against the former nibble by nibble implementation
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Isrc extras/benchmarks/hex_codec_bench.c src/data_tools/string_tools.c src/data_tools/char_tools.c -o hex_codec_bench
+ *     ./hex_codec_bench
+ *
+ * Prints one line per codec, implementation and payload size: codec impl bytes ns/byte MB/s
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "data_tools/string_tools.h"
+#include "data_tools/char_tools.h"
+
+#define MAX_BYTES   4096
+
+static uint8_t bytes[MAX_BYTES];
+static uint8_t decoded[MAX_BYTES];
+static char hex[2 * MAX_BYTES];
+static volatile uint8_t sink;
+
+// former implementation of string_byteArray2hex
+static size_t ref_bytes2hex(uint8_t const * byteArray, size_t nBytes, char * dest, size_t destSize) {
+    if(destSize < 2 * nBytes) { return 0; }
+    for(size_t i = 0; i < nBytes; i++) {
+        string_byte2hex(byteArray[i], &dest[i*2]);
+    }
+    return 2*nBytes;
+}
+
+// former implementation of string_hex2byteArray, without validation
+static bool ref_hex2bytes(unsigned char const * hexString, size_t hexStringLength, uint8_t * dest, size_t destSize, size_t * errorPos) {
+    if(destSize < hexStringLength/2 || hexStringLength&1) { return false; }
+    for(size_t i = 0; i < hexStringLength/2; i++) {
+        dest[i] = char_hex2uint(hexString[2*i])<<4 | char_hex2uint(hexString[2*i+1]);
+    }
+    return true;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(char const * codec, char const * impl, size_t n, double ns, size_t iterations) {
+    double const perByte = ns / ((double)iterations * n);
+    printf("%-6s %-7s %5zu %8.3f %9.1f\n", codec, impl, n, perByte, 1e3 / perByte);
+}
+
+static void bench_encode(char const * impl, size_t (*encode)(uint8_t const *, size_t, char *, size_t), size_t n) {
+    size_t const iterations = 20000000 / n + 1;
+    double const start = now_ns();
+    for(size_t i = 0; i < iterations; i++) {
+        encode(bytes, n, hex, sizeof(hex));
+        sink ^= hex[i % (2*n)];
+    }
+    report("encode", impl, n, now_ns() - start, iterations);
+}
+
+static void bench_decode(char const * impl, bool (*decode)(unsigned char const *, size_t, uint8_t *, size_t, size_t *), size_t n) {
+    size_t const iterations = 20000000 / n + 1;
+    double const start = now_ns();
+    for(size_t i = 0; i < iterations; i++) {
+        decode((unsigned char const *)hex, 2*n, decoded, sizeof(decoded), NULL);
+        sink ^= decoded[i % n];
+    }
+    report("decode", impl, n, now_ns() - start, iterations);
+}
+
+int main(void) {
+    static size_t const sizes[] = { 1, 2, 8, 16, 32, 64, 128, 255, 1024, MAX_BYTES };
+
+    srand(1);
+    for(size_t i = 0; i < MAX_BYTES; i++) { bytes[i] = rand(); }
+
+    // cross check both implementations before timing them
+    char refHex[2 * MAX_BYTES];
+    ref_bytes2hex(bytes, MAX_BYTES, refHex, sizeof(refHex));
+    string_bytes2hex(bytes, MAX_BYTES, hex, sizeof(hex));
+    if(memcmp(refHex, hex, sizeof(hex)) != 0 || !string_hex2bytes((unsigned char *)hex, sizeof(hex), decoded, sizeof(decoded), NULL)
+            || memcmp(decoded, bytes, MAX_BYTES) != 0) {
+        fprintf(stderr, "hex codec mismatch\n");
+        return 1;
+    }
+
+    printf("# kernels: %s\n", string_hexKernelName());
+    printf("# codec impl bytes ns/byte MB/s\n");
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_encode("nibble", ref_bytes2hex, sizes[i]);
+        bench_encode("fast", string_bytes2hex, sizes[i]);
+        bench_decode("nibble", ref_hex2bytes, sizes[i]);
+        bench_decode("fast", string_hex2bytes, sizes[i]);
+    }
+    return 0;
+}
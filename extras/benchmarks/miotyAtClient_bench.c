@@ -0,0 +1,214 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Benchmark of the client: command serialization, response parsing, hex codec and round trips
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Isrc -Iextras/simulator extras/benchmarks/miotyAtClient_bench.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtClient_bench
+ *     ./miotyAtClient_bench [label] > results.txt
+ *
+ * Payload sizes are swept from 1 to 255 byte and RX chunk sizes from 1 byte over the read buffer to the whole
+ * response in one piece, as an event driven transport or a readn hook may deliver it. Round trips run against
+ * the in-process simulator, their latency is the CPU time of client and simulator per transaction.
+ * Prints one line per benchmark, payload size and chunk size, with a header describing the columns:
+ *
+ *     label bench payload chunk iterations ns/op p50_ns p90_ns p99_ns max_ns ops/s MB/s
+ *
+ * Lines starting with '#' are comments. MB/s refers to the payload bytes.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "miotyAtClient.h"
+#include "miotyAtSim.h"
+#include "data_tools/string_tools.h"
+
+#define MAX_SAMPLES     20000
+
+static char const * label = "-";
+static uint8_t payload[255];
+static uint8_t downlink[255];
+static char hex[2 * 255];
+static uint8_t response[600];
+static uint32_t samples[MAX_SAMPLES];
+static volatile uint32_t sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int compare_u32(void const * a, void const * b) {
+    uint32_t x = *(uint32_t const *)a;
+    uint32_t y = *(uint32_t const *)b;
+    return x < y ? -1 : x > y;
+}
+
+// prints one result line, samples holds the duration of every iteration in ns
+static void report(char const * bench, size_t payloadSize, size_t chunk, size_t iterations, uint64_t totalNs) {
+    size_t n = iterations < MAX_SAMPLES ? iterations : MAX_SAMPLES;
+    qsort(samples, n, sizeof(samples[0]), compare_u32);
+    double perOp = (double)totalNs / iterations;
+    printf("%s %-8s %3zu %3zu %8zu %10.1f %8u %8u %8u %8u %12.0f %9.2f\n", label, bench, payloadSize, chunk, iterations,
+            perOp, samples[n / 2], samples[n * 9 / 10], samples[n * 99 / 100], samples[n - 1],
+            1e9 / perOp, payloadSize * 1e3 / perOp);
+}
+
+static void discard(void * user, uint8_t * data, uint16_t size) {
+    sink += size;
+}
+
+static bool no_read(void * user, uint8_t * buf, uint8_t * len) {
+    *len = 0;
+    return true;
+}
+
+// submitting an uplink: begin of the transaction and serialization into the TX buffer
+static void bench_encode(size_t size) {
+    static miotyAtClient_ctx ctx;
+    miotyAtClientCtx_init(&ctx, discard, no_read, NULL);
+    size_t const iterations = 2000000 / (size + 16);
+    uint64_t total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        uint64_t start = now_ns();
+        miotyAtClientCtx_sendMessageUniAsync(&ctx, payload, size, NULL, NULL, NULL);
+        uint64_t d = now_ns() - start;
+        total += d;
+        if (i < MAX_SAMPLES)
+            samples[i] = d;
+        miotyAtClientCtx_feed(&ctx, (uint8_t const *)"0\r\n", 3);
+    }
+    report("encode", size, 0, iterations, total);
+}
+
+// response of a bidirectional message with a downlink of size bytes, fed in chunks
+static void bench_parse(size_t size, size_t chunk) {
+    static miotyAtClient_ctx ctx;
+    miotyAtClientCtx_init(&ctx, discard, no_read, NULL);
+    char * pos = (char *)response;
+    pos += sprintf(pos, "-B:%zu\t", size);
+    pos += string_bytes2hex(downlink, size, pos, sizeof(response) - 64);
+    pos += sprintf(pos, "\x1A\r\n-MPCT:4711\r\n0\r\n");
+    size_t len = pos - (char *)response;
+
+    uint8_t data[255];
+    size_t const iterations = 2000000 / (len + 16 * (len / chunk));
+    uint64_t total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        miotyAtClientCtx_sendMessageBidiAsync(&ctx, payload, 1, data, sizeof(data), NULL, NULL, NULL);
+        uint64_t start = now_ns();
+        for (size_t off = 0; off < len; off += chunk)
+            miotyAtClientCtx_feed(&ctx, response + off, off + chunk <= len ? chunk : len - off);
+        uint64_t d = now_ns() - start;
+        total += d;
+        if (i < MAX_SAMPLES)
+            samples[i] = d;
+        sink += ctx.txn.result.sizeData;
+    }
+    report("parse", size, chunk, iterations, total);
+}
+
+static void bench_hex(size_t size) {
+    size_t const iterations = 2000000 / (size + 4);
+    uint64_t total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        uint64_t start = now_ns();
+        string_bytes2hex(payload, size, hex, sizeof(hex));
+        string_hex2bytes((unsigned char const *)hex, 2 * size, downlink, sizeof(downlink), NULL);
+        uint64_t d = now_ns() - start;
+        total += d;
+        if (i < MAX_SAMPLES)
+            samples[i] = d;
+        sink += downlink[i % size];
+    }
+    report("hex", size, 0, iterations, total);
+}
+
+// blocking bidirectional message with a downlink of the same size against the simulator
+static void bench_roundtrip(size_t size, size_t chunk) {
+    static miotyAtSim sim;
+    static miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .chunkSize = chunk };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+
+    uint8_t data[255];
+    size_t const iterations = 400000 / (size + 32) + 200;
+    uint64_t total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        uint8_t sizeData = sizeof(data);
+        uint32_t packetCounter;
+        miotyAtSim_queueDownlink(&sim, downlink, size);
+        uint64_t start = now_ns();
+        miotyAtClient_returnCode rc = miotyAtClientCtx_sendMessageBidi(&ctx, payload, size, data, &sizeData, &packetCounter);
+        uint64_t d = now_ns() - start;
+        if (rc != MIOTYATCLIENT_RETURN_CODE_OK || sizeData != size) {
+            fprintf(stderr, "round trip failed: %d\n", rc);
+            exit(1);
+        }
+        total += d;
+        if (i < MAX_SAMPLES)
+            samples[i] = d;
+    }
+    report("roundtrip", size, chunk, iterations, total);
+}
+
+int main(int argc, char ** argv) {
+    static size_t const sizes[] = { 1, 2, 4, 8, 16, 32, 64, 128, 255 };
+    static size_t const chunks[] = { 1, 2, 4, 8, 16, MIOTYATCLIENT_RX_CHUNK_SIZE, sizeof(response) };
+    size_t const nSizes = sizeof(sizes) / sizeof(sizes[0]);
+    size_t const nChunks = sizeof(chunks) / sizeof(chunks[0]);
+
+    if (argc > 1)
+        label = argv[1];
+    srand(1);
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = rand();
+        downlink[i] = rand();
+    }
+
+    printf("# hex kernels: %s, rx chunk size %d, tx buffer %d\n", string_hexKernelName(), MIOTYATCLIENT_RX_CHUNK_SIZE, MIOTYATCLIENT_TX_BUF_SIZE);
+    printf("# label bench payload chunk iterations ns/op p50_ns p90_ns p99_ns max_ns ops/s MB/s\n");
+    for (size_t i = 0; i < nSizes; i++)
+        bench_encode(sizes[i]);
+    for (size_t i = 0; i < nSizes; i++)
+        for (size_t j = 0; j < nChunks; j++)
+            bench_parse(sizes[i], chunks[j]);
+    for (size_t i = 0; i < nSizes; i++)
+        bench_hex(sizes[i]);
+    for (size_t i = 0; i < nSizes; i++)
+        for (size_t j = 0; j < nChunks; j++)
+            bench_roundtrip(sizes[i], chunks[j]);
+    return 0;
+}
@@ -0,0 +1,402 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Gateway daemon driving many MIOTY™ modems from one event loop, uplinks are requested over a Unix socket
+ *
+ * Build on a Linux host from the repository root:
+ *
+ *     gcc -O2 -DMIOTYATSERIAL_LOOP_SIZE=64 -Isrc -Iextras/gateway extras/gateway/miotyAtGateway.c \
+ *         src/miotyAtSerial.c src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtGateway
+ *     ./miotyAtGateway -s /run/mioty.sock /dev/ttyUSB0 /dev/ttyUSB1
+ *
+ * Every modem has its own queue of uplink requests and at most one command in flight, so a long
+ * bidirectional transaction only delays requests for the same modem. Responses, including downlinks, go back
+ * to the connection that sent the request. The message format is described in miotyAtGateway.h.
+ *
+ * Options:
+ *     -s <path>    path of the Unix socket, default /tmp/miotyAtGateway.sock
+ *     -b <baud>    baud rate of all modems, default 115200
+ *     -q <n>       queued requests per modem, default 16
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "miotyAtSerial.h"
+#include "miotyAtGateway.h"
+
+#define MAX_CLIENTS     256
+#define MAX_EVENTS      64
+
+// epoll tags
+#define TAG_LISTEN      0
+#define TAG_MODEMS      1
+#define TAG_CLIENT      2
+
+typedef struct request {
+    uint32_t tag;
+    uint16_t client;
+    uint16_t generation;        // of the client slot, responses to closed connections are dropped
+    uint8_t type;
+    uint8_t size;
+    uint8_t data[255];
+} request;
+
+typedef struct modem {
+    uint8_t index;
+    char const * path;
+    miotyAtSerial serial;
+    miotyAtClient_ctx ctx;
+    request * queue;
+    uint16_t head;
+    uint16_t count;
+    bool busy;
+    bool online;
+    uint8_t downlink[255];
+    uint32_t uplinks;
+    uint32_t failed;
+} modem;
+
+typedef struct client {
+    int fd;
+    uint16_t generation;
+} client;
+
+static volatile sig_atomic_t running = 1;
+static int epfd;
+static int listenFd;
+static miotyAtSerialLoop loop;
+static modem * modems;
+static uint16_t nModems;
+static uint16_t queueSize = 16;
+static client clients[MAX_CLIENTS];
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void put_u32(uint8_t * dest, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++)
+        dest[i] = value >> (8 * i);
+}
+
+static uint32_t get_u32(uint8_t const * src) {
+    return src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static void respond(uint16_t slot, uint16_t generation, uint32_t tag, uint8_t modemIndex, miotyAtClient_result const * result) {
+    client * c = &clients[slot];
+    if (c->fd < 0 || c->generation != generation)
+        return;
+    uint8_t msg[MIOTYATGW_MESSAGE_SIZE];
+    uint8_t sizeData = result->data != NULL && result->returnCode == MIOTYATCLIENT_RETURN_CODE_OK ? result->sizeData : 0;
+    put_u32(msg, tag);
+    msg[4] = modemIndex;
+    msg[5] = result->returnCode;
+    put_u32(msg + 6, result->hasPacketCounter ? result->packetCounter : 0);
+    msg[10] = sizeData;
+    memcpy(msg + MIOTYATGW_RESPONSE_HEADER_SIZE, result->data, sizeData);
+    // a client that doesn't read its responses loses them instead of stalling the gateway
+    if (send(c->fd, msg, MIOTYATGW_RESPONSE_HEADER_SIZE + sizeData, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+        fprintf(stderr, "client %u: response %u dropped: %s\n", slot, tag, strerror(errno));
+}
+
+static void respond_error(uint16_t slot, uint16_t generation, uint32_t tag, uint8_t modemIndex, miotyAtClient_returnCode returnCode) {
+    miotyAtClient_result result = { .returnCode = returnCode };
+    respond(slot, generation, tag, modemIndex, &result);
+}
+
+static void submit_next(modem * m);
+
+static void on_complete(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser) {
+    (void)ctx;
+    modem * m = cbUser;
+    request * req = &m->queue[m->head];
+    respond(req->client, req->generation, req->tag, m->index, result);
+    if (result->returnCode == MIOTYATCLIENT_RETURN_CODE_OK)
+        m->uplinks++;
+    else
+        m->failed++;
+    m->head = (m->head + 1) % queueSize;
+    m->count--;
+    m->busy = false;
+    // the tty failed, check_modems() answers the rest of the queue
+    if (result->returnCode != MIOTYATCLIENT_RETURN_CODE_ATReadFailed)
+        submit_next(m);
+}
+
+// starts the oldest queued request of m unless a command is in flight
+static void submit_next(modem * m) {
+    while (!m->busy && m->count > 0) {
+        request * req = &m->queue[m->head];
+        miotyAtClient_ctx * ctx = &m->ctx;
+        miotyAtClient_returnCode rc;
+        switch (req->type) {
+        case MIOTYATGW_UPLINK_UNI:
+            rc = miotyAtClientCtx_sendMessageUniAsync(ctx, req->data, req->size, on_complete, m, NULL);
+            break;
+        case MIOTYATGW_UPLINK_BIDI:
+            rc = miotyAtClientCtx_sendMessageBidiAsync(ctx, req->data, req->size, m->downlink, sizeof(m->downlink), on_complete, m, NULL);
+            break;
+        case MIOTYATGW_UPLINK_UNI_MPF:
+            rc = miotyAtClientCtx_sendMessageUniMPFAsync(ctx, req->data, req->size, on_complete, m, NULL);
+            break;
+        case MIOTYATGW_UPLINK_BIDI_MPF:
+            rc = miotyAtClientCtx_sendMessageBidiMPFAsync(ctx, req->data, req->size, m->downlink, sizeof(m->downlink), on_complete, m, NULL);
+            break;
+        case MIOTYATGW_UPLINK_UNI_TRANSPARENT:
+            rc = miotyAtClientCtx_sendMessageUniTransparentAsync(ctx, req->data, req->size, on_complete, m, NULL);
+            break;
+        case MIOTYATGW_UPLINK_BIDI_TRANSPARENT:
+            rc = miotyAtClientCtx_sendMessageBidiTransparentAsync(ctx, req->data, req->size, m->downlink, sizeof(m->downlink), on_complete, m, NULL);
+            break;
+        default:
+            rc = MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+            break;
+        }
+        if (rc == MIOTYATCLIENT_RETURN_CODE_OK) {
+            m->busy = true;
+            return;
+        }
+        // the modem may still answer a timed out request, check_modems() tries again once that is over
+        if (rc == MIOTYATCLIENT_RETURN_CODE_Busy)
+            return;
+        // rejected before anything was written, answer right away and go on with the queue
+        respond_error(req->client, req->generation, req->tag, m->index, rc);
+        m->failed++;
+        m->head = (m->head + 1) % queueSize;
+        m->count--;
+    }
+}
+
+static void handle_request(uint16_t slot, uint8_t const * msg, ssize_t len) {
+    if (len < MIOTYATGW_REQUEST_HEADER_SIZE)
+        return;
+    uint32_t tag = get_u32(msg);
+    uint8_t modemIndex = msg[4];
+    if (len != MIOTYATGW_REQUEST_HEADER_SIZE + msg[6]) {
+        respond_error(slot, clients[slot].generation, tag, modemIndex, MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch);
+        return;
+    }
+    if (modemIndex >= nModems || !modems[modemIndex].online) {
+        respond_error(slot, clients[slot].generation, tag, modemIndex, MIOTYATCLIENT_RETURN_CODE_ArgumentOOR);
+        return;
+    }
+    modem * m = &modems[modemIndex];
+    if (m->count == queueSize) {
+        respond_error(slot, clients[slot].generation, tag, modemIndex, MIOTYATCLIENT_RETURN_CODE_Busy);
+        return;
+    }
+    request * req = &m->queue[(m->head + m->count) % queueSize];
+    req->tag = tag;
+    req->client = slot;
+    req->generation = clients[slot].generation;
+    req->type = msg[5];
+    req->size = msg[6];
+    memcpy(req->data, msg + MIOTYATGW_REQUEST_HEADER_SIZE, req->size);
+    m->count++;
+    submit_next(m);
+}
+
+static void accept_client(void) {
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+    for (uint16_t slot = 0; slot < MAX_CLIENTS; slot++) {
+        if (clients[slot].fd < 0) {
+            struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)TAG_CLIENT << 32 | slot };
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+                break;
+            clients[slot].fd = fd;
+            clients[slot].generation++;
+            return;
+        }
+    }
+    close(fd);
+}
+
+static void close_client(uint16_t slot) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, clients[slot].fd, NULL);
+    close(clients[slot].fd);
+    clients[slot].fd = -1;
+}
+
+static void service_client(uint16_t slot) {
+    uint8_t msg[MIOTYATGW_MESSAGE_SIZE];
+    for (;;) {
+        ssize_t len = recv(clients[slot].fd, msg, sizeof(msg), MSG_DONTWAIT);
+        if (len > 0) {
+            handle_request(slot, msg, len);
+            continue;
+        }
+        if (len == 0 || (errno != EAGAIN && errno != EINTR))
+            close_client(slot);
+        return;
+    }
+}
+
+// modems whose tty failed were removed from the loop, answer their queued requests, resume the others after draining
+static void check_modems(void) {
+    for (uint16_t i = 0; i < nModems; i++) {
+        modem * m = &modems[i];
+        if (!m->online)
+            continue;
+        bool inLoop = false;
+        for (uint8_t j = 0; j < loop.count; j++)
+            inLoop |= loop.serial[j] == &m->serial;
+        if (inLoop) {
+            submit_next(m);
+            continue;
+        }
+        fprintf(stderr, "%s: hung up\n", m->path);
+        m->online = false;
+        while (m->count > 0) {
+            request * req = &m->queue[m->head];
+            respond_error(req->client, req->generation, req->tag, m->index, MIOTYATCLIENT_RETURN_CODE_ATReadFailed);
+            m->head = (m->head + 1) % queueSize;
+            m->count--;
+        }
+    }
+}
+
+static int open_socket(char const * path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char ** argv) {
+    char const * socketPath = "/tmp/miotyAtGateway.sock";
+    uint32_t baudrate = 115200;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:q:")) != -1) {
+        switch (opt) {
+        case 's': socketPath = optarg; break;
+        case 'b': baudrate = strtoul(optarg, NULL, 0); break;
+        case 'q': queueSize = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-s socket] [-b baud] [-q queue] tty...\n", argv[0]);
+            return 2;
+        }
+    }
+    nModems = argc - optind;
+    if (nModems == 0 || nModems > MIOTYATSERIAL_LOOP_SIZE || queueSize == 0) {
+        fprintf(stderr, "1 to %d ttys and a queue size > 0 are required\n", MIOTYATSERIAL_LOOP_SIZE);
+        return 2;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    for (uint16_t slot = 0; slot < MAX_CLIENTS; slot++)
+        clients[slot].fd = -1;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0 || !miotyAtSerialLoop_init(&loop)) {
+        perror("epoll");
+        return 1;
+    }
+    modems = calloc(nModems, sizeof(*modems));
+    if (modems == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    for (uint16_t i = 0; i < nModems; i++) {
+        modem * m = &modems[i];
+        m->index = i;
+        m->path = argv[optind + i];
+        m->queue = calloc(queueSize, sizeof(*m->queue));
+        if (m->queue == NULL) {
+            perror("calloc");
+            return 1;
+        }
+        if (!miotyAtSerial_open(&m->serial, m->path, baudrate)) {
+            fprintf(stderr, "%s: %s\n", m->path, strerror(errno));
+            continue;
+        }
+        miotyAtSerial_bind(&m->serial, &m->ctx);
+        m->online = miotyAtSerialLoop_add(&loop, &m->serial);
+    }
+
+    listenFd = open_socket(socketPath);
+    if (listenFd < 0) {
+        fprintf(stderr, "%s: %s\n", socketPath, strerror(errno));
+        return 1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)TAG_LISTEN << 32 };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+    // the epoll fd of the modems is readable whenever one of them is
+    ev.data.u64 = (uint64_t)TAG_MODEMS << 32;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, loop.epfd, &ev);
+
+    while (running) {
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epfd, events, MAX_EVENTS, miotyAtSerialLoop_timeout(&loop, -1));
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u64 >> 32;
+            if (tag == TAG_LISTEN)
+                accept_client();
+            else if (tag == TAG_CLIENT)
+                service_client((uint16_t)events[i].data.u64);
+        }
+        // services modems with input and enforces deadlines, completions respond and submit the next request
+        miotyAtSerialLoop_run(&loop, 0);
+        check_modems();
+    }
+
+    for (uint16_t i = 0; i < nModems; i++) {
+        printf("%s uplinks %u failed %u queued %u\n", modems[i].path, modems[i].uplinks, modems[i].failed, modems[i].count);
+        miotyAtSerial_close(&modems[i].serial);
+    }
+    miotyAtSerialLoop_close(&loop);
+    close(listenFd);
+    unlink(socketPath);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Message format of the Unix socket of miotyAtGateway
+ *
+ * Clients connect a SOCK_SEQPACKET socket to the gateway, every packet is one message. Integers are little endian.
+ *
+ * Request (client -> gateway):
+ *
+ *     offset  size    field
+ *     0       4       tag, returned in the response
+ *     4       1       modem, index in the order of the command line
+ *     5       1       MIOTYATGW_UPLINK_* type
+ *     6       1       payload size
+ *     7       n       payload
+ *
+ * Response (gateway -> client), one per request:
+ *
+ *     0       4       tag
+ *     4       1       modem
+ *     5       1       miotyAtClient_returnCode, MIOTYATCLIENT_RETURN_CODE_Busy if the queue of the modem is full
+ *     6       4       packet counter, 0 if not reported
+ *     10      1       downlink size
+ *     11      n       downlink data (bidirectional uplinks)
+ */
+
+#ifndef _AT_GATEWAY_H
+#define _AT_GATEWAY_H
+
+#define MIOTYATGW_REQUEST_HEADER_SIZE   7
+#define MIOTYATGW_RESPONSE_HEADER_SIZE  11
+#define MIOTYATGW_MESSAGE_SIZE          (MIOTYATGW_RESPONSE_HEADER_SIZE + 255)
+
+// uplink types
+#define MIOTYATGW_UPLINK_UNI            0   // AT-U
+#define MIOTYATGW_UPLINK_BIDI           1   // AT-B
+#define MIOTYATGW_UPLINK_UNI_MPF        2   // AT-UMPF
+#define MIOTYATGW_UPLINK_BIDI_MPF       3   // AT-BMPF
+#define MIOTYATGW_UPLINK_UNI_TRANSPARENT    4   // AT-TU
+#define MIOTYATGW_UPLINK_BIDI_TRANSPARENT   5   // AT-TB
+
+#endif
@@ -0,0 +1,471 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Simulated MIOTY™ modem (AT protocol v2.2.x subset used by the client) for tests and benchmarks
+ */
+
+#include <string.h>
+#include "miotyAtSim.h"
+#include "data_tools/string_tools.h"
+
+#define DEFAULTS_VALIDATION     0xbf07a938
+
+// AT!ERR: codes
+#define AT_ERR_GENERIC          1
+#define AT_ERR_UNKNOWN_CMD      2
+#define AT_ERR_SIZE_MISMATCH    4
+#define AT_ERR_UNEXPECTED_CHAR  5
+#define AT_ERR_ARG_INVALID      6
+
+// -MNFO: codes
+#define MAC_NOT_ATTACHED        6
+#define MAC_ALREADY_ATTACHED    8
+
+static void process_cmd(miotyAtSim * sim);
+static void process_set(miotyAtSim * sim, miotyAtCmd_id id, uint8_t const * arg, uint16_t len);
+static void process_send(miotyAtSim * sim, miotyAtCmd_id id, uint8_t const * data, uint8_t size);
+static void process_exec(miotyAtSim * sim, miotyAtCmd_id id);
+static void process_get(miotyAtSim * sim, miotyAtCmd_id id);
+static void load_defaults(miotyAtSim * sim);
+static bool parse_uint(uint8_t const * s, uint16_t len, uint16_t * pos, uint32_t * value);
+static uint8_t lookup_cmd(uint8_t const * name, uint16_t len);
+static bool inject_error(miotyAtSim * sim);
+static void out_bytes(miotyAtSim * sim, void const * data, uint16_t len);
+static void out_str(miotyAtSim * sim, char const * s);
+static void out_uint(miotyAtSim * sim, uint32_t value);
+static void out_field(miotyAtSim * sim, char const * field, uint8_t len);
+static void out_field_uint(miotyAtSim * sim, char const * field, uint8_t len, uint32_t value);
+static void out_field_bytes(miotyAtSim * sim, char const * field, uint8_t len, uint8_t const * data, uint8_t size);
+static void out_result(miotyAtSim * sim, uint8_t resultCode);
+static void out_at_error(miotyAtSim * sim, uint32_t code);
+static void out_mac_info(miotyAtSim * sim, uint32_t code);
+static void sim_write(void * user, uint8_t * data, uint16_t size);
+static bool sim_read(void * user, uint8_t * buf, uint8_t * len);
+static bool sim_readn(void * user, uint8_t * buf, size_t cap, size_t * len);
+static uint32_t sim_clock(void * user);
+
+
+void miotyAtSim_init(miotyAtSim * sim, miotyAtSim_config const * config) {
+    static uint8_t const eui[8] = { 0x70, 0xb3, 0xd5, 0x67, 0x70, 0x00, 0x00, 0x01 };
+
+    memset(sim, 0, sizeof(*sim));
+    if (config != NULL)
+        sim->config = *config;
+    sim->rng = sim->config.seed != 0 ? sim->config.seed : 1;
+    sim->msta = sim->config.detached ? MIOTYATSIM_MSTA_DETACHED : MIOTYATSIM_MSTA_ATTACHED;
+
+    sim->intValue[MIOTYATCMD_IPR] = 115200;
+    sim->intValue[MIOTYATCMD_UTPL] = 14;
+    memcpy(sim->bytesValue[MIOTYATCMD_MEUI], eui, sizeof(eui));
+    for (uint8_t id = 0; id < MIOTYATCMD_COUNT; id++) {
+        if (miotyAtCmd_table[id].type == MIOTYATCMD_TYPE_BYTES && (miotyAtCmd_table[id].ops & MIOTYATCMD_OP_SET))
+            sim->bytesSize[id] = miotyAtCmd_table[id].size;
+    }
+}
+
+void miotyAtSim_write(miotyAtSim * sim, uint8_t const * data, size_t len, uint32_t nowMs) {
+    for (size_t i = 0; i < len; i++) {
+        if (sim->cmdLen == 0 && (data[i] == '\n' || data[i] == '\r'))
+            continue;
+        if (sim->cmdLen < sizeof(sim->cmd))
+            sim->cmd[sim->cmdLen++] = data[i];
+        else
+            sim->cmdOverflow = true;
+        if (data[i] != '\r')
+            continue;
+
+        // the response of a command is readable latencyMs after its end, unread bytes before it right away
+        sim->readyAt = nowMs + sim->config.latencyMs;
+        sim->outEarly = sim->outLen;
+        process_cmd(sim);
+        sim->cmdLen = 0;
+        sim->cmdOverflow = false;
+    }
+}
+
+size_t miotyAtSim_read(miotyAtSim * sim, uint8_t * buf, size_t cap, uint32_t nowMs) {
+    size_t n = sim->outLen;
+    if ((int32_t)(nowMs - sim->readyAt) < 0)
+        n = sim->outEarly;
+    if (n == 0)
+        return 0;
+    if (n > cap)
+        n = cap;
+    if (sim->config.chunkSize != 0 && n > sim->config.chunkSize)
+        n = sim->config.chunkSize;
+    memcpy(buf, sim->out + sim->outHead, n);
+    sim->outHead += n;
+    sim->outLen -= n;
+    sim->outEarly = n < sim->outEarly ? sim->outEarly - n : 0;
+    if (sim->outLen == 0)
+        sim->outHead = 0;
+    return n;
+}
+
+uint32_t miotyAtSim_readyAt(miotyAtSim const * sim) {
+    // unread bytes of the previous response became readable with the end of the last command
+    return sim->outEarly != 0 ? sim->readyAt - sim->config.latencyMs : sim->readyAt;
+}
+
+bool miotyAtSim_pending(miotyAtSim const * sim) {
+    return sim->outLen != 0;
+}
+
+void miotyAtSim_injectError(miotyAtSim * sim, uint8_t kind, uint32_t code) {
+    sim->nextErrorKind = kind;
+    sim->nextErrorCode = code;
+}
+
+void miotyAtSim_urc(miotyAtSim * sim, char const * line) {
+    bool due = sim->outEarly != sim->outLen;
+    out_str(sim, line);
+    out_str(sim, "\r\n");
+    if (!due)
+        sim->outEarly = sim->outLen;
+}
+
+bool miotyAtSim_queueDownlink(miotyAtSim * sim, uint8_t const * data, uint8_t size) {
+    if (sim->downlinkCount == MIOTYATSIM_DOWNLINKS)
+        return false;
+    miotyAtSim_downlink * dl = &sim->downlinks[(sim->downlinkHead + sim->downlinkCount) % MIOTYATSIM_DOWNLINKS];
+    memcpy(dl->data, data, size);
+    dl->size = size;
+    sim->downlinkCount++;
+    return true;
+}
+
+void miotyAtSim_bind(miotyAtSim * sim, miotyAtClient_ctx * ctx) {
+    miotyAtClientCtx_init(ctx, sim_write, sim_read, sim);
+    miotyAtClientCtx_setReadn(ctx, sim_readn);
+    miotyAtClientCtx_setClock(ctx, sim_clock);
+}
+
+// one complete command ending with '\r' is in sim->cmd
+static void process_cmd(miotyAtSim * sim) {
+    uint8_t const * cmd = sim->cmd;
+    uint16_t len = sim->cmdLen - 1;
+    sim->commands++;
+
+    if (sim->cmdOverflow) {
+        out_at_error(sim, AT_ERR_SIZE_MISMATCH);
+        return;
+    }
+    if (inject_error(sim))
+        return;
+
+    uint16_t nameLen = 0;
+    while (nameLen < len && cmd[nameLen] != '?' && cmd[nameLen] != '=')
+        nameLen++;
+    uint8_t id = lookup_cmd(cmd, nameLen);
+    if (id == MIOTYATCMD_NONE) {
+        out_at_error(sim, AT_ERR_UNKNOWN_CMD);
+        return;
+    }
+
+    uint8_t ops = miotyAtCmd_table[id].ops;
+    if (nameLen == len) {
+        if (ops & MIOTYATCMD_OP_EXEC)
+            process_exec(sim, id);
+        else
+            out_at_error(sim, AT_ERR_UNKNOWN_CMD);
+    } else if (cmd[nameLen] == '?' && nameLen + 1 == len) {
+        if (ops & MIOTYATCMD_OP_GET)
+            process_get(sim, id);
+        else
+            out_at_error(sim, AT_ERR_UNKNOWN_CMD);
+    } else if (cmd[nameLen] == '=' && (ops & (MIOTYATCMD_OP_SET | MIOTYATCMD_OP_SEND))) {
+        process_set(sim, id, cmd + nameLen + 1, len - nameLen - 1);
+    } else {
+        out_at_error(sim, AT_ERR_UNEXPECTED_CHAR);
+    }
+}
+
+// argument of "AT-xxx=<arg>", a decimal value or "<n>\t<hex>\x1A"
+static void process_set(miotyAtSim * sim, miotyAtCmd_id id, uint8_t const * arg, uint16_t len) {
+    miotyAtCmd const * cmd = &miotyAtCmd_table[id];
+    uint16_t pos = 0;
+    uint32_t value;
+    if (!parse_uint(arg, len, &pos, &value)) {
+        out_at_error(sim, AT_ERR_UNEXPECTED_CHAR);
+        return;
+    }
+
+    if (cmd->type == MIOTYATCMD_TYPE_INT) {
+        if (pos != len) {
+            out_at_error(sim, AT_ERR_UNEXPECTED_CHAR);
+            return;
+        }
+        sim->intValue[id] = value;
+        out_result(sim, 0);
+        return;
+    }
+
+    uint8_t data[255];
+    if (pos == len || arg[pos] != '\t' || arg[len-1] != 0x1A) {
+        out_at_error(sim, AT_ERR_UNEXPECTED_CHAR);
+        return;
+    }
+    uint16_t hexLen = len - pos - 2;
+    if (value > sizeof(data) || hexLen != 2 * value || (cmd->size != 0 && value != cmd->size)) {
+        out_at_error(sim, AT_ERR_SIZE_MISMATCH);
+        return;
+    }
+    if (!string_hex2bytes(arg + pos + 1, hexLen, data, sizeof(data), NULL)) {
+        out_at_error(sim, AT_ERR_UNEXPECTED_CHAR);
+        return;
+    }
+
+    if (cmd->ops & MIOTYATCMD_OP_SEND) {
+        process_send(sim, id, data, value);
+        return;
+    }
+    if (id == MIOTYATCMD_DEF) {
+        uint32_t validation = data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+        if (validation != DEFAULTS_VALIDATION) {
+            out_at_error(sim, AT_ERR_ARG_INVALID);
+            return;
+        }
+        memcpy(sim->defaults, data, value);
+        sim->hasDefaults = true;
+    } else if (value <= MIOTYATSIM_VALUE_SIZE) {
+        memcpy(sim->bytesValue[id], data, value);
+        sim->bytesSize[id] = value;
+    }
+    out_result(sim, 0);
+}
+
+static void process_send(miotyAtSim * sim, miotyAtCmd_id id, uint8_t const * data, uint8_t size) {
+    if (id == MIOTYATCMD_MAOA || id == MIOTYATCMD_MDOA) {
+        uint8_t msta = id == MIOTYATCMD_MAOA ? MIOTYATSIM_MSTA_ATTACHED : MIOTYATSIM_MSTA_DETACHED;
+        if (sim->msta == msta) {
+            out_mac_info(sim, msta == MIOTYATSIM_MSTA_ATTACHED ? MAC_ALREADY_ATTACHED : MAC_NOT_ATTACHED);
+            return;
+        }
+        sim->msta = msta;
+        out_field_uint(sim, "-MSTA", 5, msta);
+        out_result(sim, 0);
+        return;
+    }
+
+    if (sim->msta != MIOTYATSIM_MSTA_ATTACHED) {
+        out_mac_info(sim, MAC_NOT_ATTACHED);
+        return;
+    }
+    bool bidi = id == MIOTYATCMD_B || id == MIOTYATCMD_TB || id == MIOTYATCMD_BMPF;
+    if (bidi && sim->downlinkCount > 0) {
+        miotyAtSim_downlink * dl = &sim->downlinks[sim->downlinkHead];
+        out_field_bytes(sim, miotyAtCmd_field(&miotyAtCmd_table[id]), miotyAtCmd_table[id].nameLen - 2, dl->data, dl->size);
+        sim->downlinkHead = (sim->downlinkHead + 1) % MIOTYATSIM_DOWNLINKS;
+        sim->downlinkCount--;
+    }
+    sim->packetCounter++;
+    out_field_uint(sim, "-MPCT", 5, sim->packetCounter);
+    out_result(sim, 0);
+}
+
+static void process_exec(miotyAtSim * sim, miotyAtCmd_id id) {
+    switch (id) {
+    case MIOTYATCMD_MALO:
+    case MIOTYATCMD_MDLO:
+        sim->msta = id == MIOTYATCMD_MALO ? MIOTYATSIM_MSTA_ATTACHED : MIOTYATSIM_MSTA_DETACHED;
+        out_field_uint(sim, "-MSTA", 5, sim->msta);
+        break;
+    case MIOTYATCMD_Z:
+        load_defaults(sim);
+        break;
+    default:
+        break;
+    }
+    out_result(sim, 0);
+}
+
+static void process_get(miotyAtSim * sim, miotyAtCmd_id id) {
+    miotyAtCmd const * cmd = &miotyAtCmd_table[id];
+    if (id == MIOTYATCMD_MPCT)
+        out_field_uint(sim, miotyAtCmd_field(cmd), cmd->nameLen - 2, sim->packetCounter);
+    else if (cmd->type == MIOTYATCMD_TYPE_INT)
+        out_field_uint(sim, miotyAtCmd_field(cmd), cmd->nameLen - 2, sim->intValue[id]);
+    else
+        out_field_bytes(sim, miotyAtCmd_field(cmd), cmd->nameLen - 2, sim->bytesValue[id], sim->bytesSize[id]);
+    out_result(sim, 0);
+}
+
+// factory reset, the layout of the defaults is the one of miotyAtClient_setDefaults()
+static void load_defaults(miotyAtSim * sim) {
+    uint8_t const * d = sim->defaults;
+    sim->packetCounter = 0;
+    if (!sim->hasDefaults) {
+        sim->msta = MIOTYATSIM_MSTA_DETACHED;
+        return;
+    }
+    sim->intValue[MIOTYATCMD_UP] = d[4];
+    sim->intValue[MIOTYATCMD_UM] = d[5];
+    sim->intValue[MIOTYATCMD_US] = d[6];
+    memcpy(sim->bytesValue[MIOTYATCMD_MEUI], d + 8, 8);
+    memcpy(sim->bytesValue[MIOTYATCMD_MIP6], d + 16, 8);
+    memcpy(sim->bytesValue[MIOTYATCMD_MNWK], d + 24, 16);
+    memcpy(sim->bytesValue[MIOTYATCMD_MSAD], d + 40, 2);
+    sim->intValue[MIOTYATCMD_ACM] = d[42];
+    sim->msta = d[43] ? MIOTYATSIM_MSTA_ATTACHED : MIOTYATSIM_MSTA_DETACHED;
+    memcpy(sim->bytesValue[MIOTYATCMD_ACK], d + 48, 16);
+}
+
+static bool parse_uint(uint8_t const * s, uint16_t len, uint16_t * pos, uint32_t * value) {
+    uint16_t start = *pos;
+    *value = 0;
+    while (*pos < len && s[*pos] >= '0' && s[*pos] <= '9')
+        *value = *value * 10 + (s[(*pos)++] - '0');
+    return *pos > start;
+}
+
+static uint8_t lookup_cmd(uint8_t const * name, uint16_t len) {
+    for (uint8_t id = 0; id < MIOTYATCMD_COUNT; id++) {
+        miotyAtCmd const * cmd = &miotyAtCmd_table[id];
+        if (cmd->nameLen != len)
+            continue;
+        uint16_t i = 0;
+        while (i < len && (name[i] >= 'a' && name[i] <= 'z' ? name[i] - 'a' + 'A' : name[i]) == cmd->request[i])
+            i++;
+        if (i == len)
+            return id;
+    }
+    return MIOTYATCMD_NONE;
+}
+
+static bool inject_error(miotyAtSim * sim) {
+    uint8_t kind = sim->nextErrorKind;
+    uint32_t code = sim->nextErrorCode;
+    sim->nextErrorKind = MIOTYATSIM_ERROR_NONE;
+
+    if (kind == MIOTYATSIM_ERROR_NONE && sim->config.errorPermille != 0) {
+        // xorshift32, repeatable for a given seed
+        sim->rng ^= sim->rng << 13;
+        sim->rng ^= sim->rng >> 17;
+        sim->rng ^= sim->rng << 5;
+        if (sim->rng % 1000 < sim->config.errorPermille) {
+            kind = sim->config.errorKind;
+            code = sim->config.errorCode;
+        }
+    }
+
+    if (kind == MIOTYATSIM_ERROR_MAC) {
+        out_field_uint(sim, "-MERR", 5, code);
+        out_result(sim, 1);
+    } else if (kind == MIOTYATSIM_ERROR_AT) {
+        out_at_error(sim, code);
+    } else {
+        return false;
+    }
+    sim->injectedErrors++;
+    return true;
+}
+
+static void out_bytes(miotyAtSim * sim, void const * data, uint16_t len) {
+    if ((size_t)sim->outHead + sim->outLen + len > sizeof(sim->out)) {
+        memmove(sim->out, sim->out + sim->outHead, sim->outLen);
+        sim->outHead = 0;
+    }
+    if ((size_t)sim->outLen + len > sizeof(sim->out))
+        return;
+    memcpy(sim->out + sim->outHead + sim->outLen, data, len);
+    sim->outLen += len;
+}
+
+static void out_str(miotyAtSim * sim, char const * s) {
+    out_bytes(sim, s, strlen(s));
+}
+
+static void out_uint(miotyAtSim * sim, uint32_t value) {
+    char buf[11];
+    char * end = string_uint2str_la_zt(value, buf);
+    out_bytes(sim, buf, end - buf);
+}
+
+// "<field>:", field is not zero terminated
+static void out_field(miotyAtSim * sim, char const * field, uint8_t len) {
+    out_bytes(sim, field, len);
+    out_str(sim, ":");
+}
+
+static void out_field_uint(miotyAtSim * sim, char const * field, uint8_t len, uint32_t value) {
+    out_field(sim, field, len);
+    out_uint(sim, value);
+    out_str(sim, "\r\n");
+}
+
+static void out_field_bytes(miotyAtSim * sim, char const * field, uint8_t len, uint8_t const * data, uint8_t size) {
+    char hex[2 * 255];
+    out_field(sim, field, len);
+    out_uint(sim, size);
+    out_str(sim, "\t");
+    out_bytes(sim, hex, string_bytes2hex(data, size, hex, sizeof(hex)));
+    out_str(sim, "\x1A\r\n");
+}
+
+static void out_result(miotyAtSim * sim, uint8_t resultCode) {
+    char line[3] = { '0' + resultCode, '\r', '\n' };
+    out_bytes(sim, line, sizeof(line));
+}
+
+static void out_at_error(miotyAtSim * sim, uint32_t code) {
+    out_field_uint(sim, "AT!ERR", 6, code);
+    out_result(sim, 2);
+}
+
+static void out_mac_info(miotyAtSim * sim, uint32_t code) {
+    out_field_uint(sim, "-MNFO", 5, code);
+    out_result(sim, 1);
+}
+
+static void sim_write(void * user, uint8_t * data, uint16_t size) {
+    miotyAtSim * sim = user;
+    miotyAtSim_write(sim, data, size, sim->nowMs);
+}
+
+static bool sim_read(void * user, uint8_t * buf, uint8_t * len) {
+    size_t n;
+    sim_readn(user, buf, *len, &n);
+    *len = n;
+    return true;
+}
+
+// an empty read lets virtual time pass: up to the next response, or 1 ms if none is coming
+static bool sim_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    miotyAtSim * sim = user;
+    size_t n = miotyAtSim_read(sim, buf, cap, sim->nowMs);
+    if (n == 0) {
+        if (sim->outLen != 0 && (int32_t)(sim->readyAt - sim->nowMs) > 0)
+            sim->nowMs = sim->readyAt;
+        else
+            sim->nowMs++;
+    }
+    *len = n;
+    return true;
+}
+
+static uint32_t sim_clock(void * user) {
+    return ((miotyAtSim *)user)->nowMs;
+}
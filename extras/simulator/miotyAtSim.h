@@ -0,0 +1,175 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Simulated MIOTY™ modem (AT protocol v2.2.x subset used by the client) for tests and benchmarks
+ *
+ * The simulator consumes the bytes written by the host and produces the responses of a modem. It knows the
+ * commands of MIOTYATCMD_TABLE: parameter reads and writes, uplinks (AT-TU, AT-U, AT-UMPF), bidirectional
+ * messages (AT-TB, AT-B, AT-BMPF) with queued downlinks, attach/detach (AT-M*), AT-DEF, AT+IPR, AT-RST and ATZ.
+ * Response latency, the size of the chunks returned per read and injected errors (-MERR:, AT!ERR:) are
+ * configurable, unsolicited lines can be sent at any time.
+ *
+ * Time is passed in by the caller. miotyAtSim_bind() connects a client context in-process and drives a
+ * virtual clock, so runs are repeatable and take no wall-clock time. miotyAtSimPty.c serves the simulator
+ * over a Linux pseudo-terminal in real time.
+ */
+
+#ifndef _AT_SIM_H
+#define _AT_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATSIM_CMD_SIZE         600     // longest command, "AT-UMPF=255\t" + 510 hex digits + "\x1A\r"
+#define MIOTYATSIM_OUT_SIZE         1024
+#define MIOTYATSIM_VALUE_SIZE       64
+#define MIOTYATSIM_DOWNLINKS        4
+
+// kinds of injected errors
+#define MIOTYATSIM_ERROR_NONE       0
+#define MIOTYATSIM_ERROR_MAC        1       // "-MERR:<code>" + result code 1
+#define MIOTYATSIM_ERROR_AT         2       // "AT!ERR:<code>" + result code 2
+
+// MAC states reported in -MSTA:
+#define MIOTYATSIM_MSTA_DETACHED    0
+#define MIOTYATSIM_MSTA_ATTACHED    1
+
+typedef struct miotyAtSim_config {
+    uint32_t latencyMs;         // from the end of a command to its response
+    uint16_t chunkSize;         // at most this many bytes per read, 0 for no limit
+    uint16_t errorPermille;     // probability of an injected error per command
+    uint8_t errorKind;          // MIOTYATSIM_ERROR_* used for random errors
+    uint32_t errorCode;         // code used for random errors
+    uint32_t seed;              // seed of the error generator
+    bool detached;              // start detached, uplinks then fail with -MNFO:6
+} miotyAtSim_config;
+
+typedef struct miotyAtSim_downlink {
+    uint8_t data[255];
+    uint8_t size;
+} miotyAtSim_downlink;
+
+typedef struct miotyAtSim {
+    miotyAtSim_config config;
+
+    // modem state
+    uint32_t intValue[MIOTYATCMD_COUNT];
+    uint8_t bytesValue[MIOTYATCMD_COUNT][MIOTYATSIM_VALUE_SIZE];
+    uint8_t bytesSize[MIOTYATCMD_COUNT];
+    uint8_t defaults[MIOTYATSIM_VALUE_SIZE];
+    bool hasDefaults;
+    uint32_t packetCounter;
+    uint8_t msta;
+
+    // injected errors
+    uint8_t nextErrorKind;
+    uint32_t nextErrorCode;
+    uint32_t rng;
+
+    miotyAtSim_downlink downlinks[MIOTYATSIM_DOWNLINKS];
+    uint8_t downlinkHead;
+    uint8_t downlinkCount;
+
+    // host -> modem
+    uint8_t cmd[MIOTYATSIM_CMD_SIZE];
+    uint16_t cmdLen;
+    bool cmdOverflow;
+
+    // modem -> host, the first outEarly bytes are readable right away, the rest from readyAt on
+    uint8_t out[MIOTYATSIM_OUT_SIZE];
+    uint16_t outHead;
+    uint16_t outLen;
+    uint16_t outEarly;
+    uint32_t readyAt;
+
+    // statistics
+    uint32_t commands;
+    uint32_t injectedErrors;
+
+    // virtual clock of miotyAtSim_bind()
+    uint32_t nowMs;
+} miotyAtSim;
+
+/**
+ * @brief Initialize the simulator, config may be NULL for an attached modem without latency or errors
+ */
+void miotyAtSim_init(miotyAtSim * sim, miotyAtSim_config const * config);
+
+/**
+ * @brief Bytes written by the host at time nowMs
+ */
+void miotyAtSim_write(miotyAtSim * sim, uint8_t const * data, size_t len, uint32_t nowMs);
+
+/**
+ * @brief Bytes of the modem readable by the host at time nowMs, at most config.chunkSize per call
+ *
+ * @return          Number of bytes copied to buf
+ */
+size_t miotyAtSim_read(miotyAtSim * sim, uint8_t * buf, size_t cap, uint32_t nowMs);
+
+/**
+ * @brief Time at which the next response bytes become readable, only valid if miotyAtSim_pending()
+ */
+uint32_t miotyAtSim_readyAt(miotyAtSim const * sim);
+
+/**
+ * @brief Check if response bytes are waiting to be read
+ */
+bool miotyAtSim_pending(miotyAtSim const * sim);
+
+/**
+ * @brief Fail the next command with an error of kind MIOTYATSIM_ERROR_MAC or MIOTYATSIM_ERROR_AT
+ */
+void miotyAtSim_injectError(miotyAtSim * sim, uint8_t kind, uint32_t code);
+
+/**
+ * @brief Queue a downlink returned by the next bidirectional message
+ *
+ * @return          false if the queue is full
+ */
+bool miotyAtSim_queueDownlink(miotyAtSim * sim, uint8_t const * data, uint8_t size);
+
+/**
+ * @brief Send the unsolicited line "<line>\r\n", readable right away unless a response is still due, then after it
+ */
+void miotyAtSim_urc(miotyAtSim * sim, char const * line);
+
+/**
+ * @brief Set up ctx to talk to sim in-process, with a virtual clock advancing 1 ms per empty read
+ */
+void miotyAtSim_bind(miotyAtSim * sim, miotyAtClient_ctx * ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Serves the simulated MIOTY™ modem of miotyAtSim.c over a Linux pseudo-terminal
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Isrc -Iextras/simulator extras/simulator/miotyAtSimPty.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtSimPty
+ *     ./miotyAtSimPty -l 20 -c 8
+ *
+ * The path of the slave side (e.g. /dev/pts/5) is printed on stdout, open it like the UART of a modem.
+ *
+ * Options:
+ *     -l <ms>      response latency
+ *     -c <bytes>   chunk size of responses, 0 writes a response at once
+ *     -g <ms>      gap between chunks
+ *     -e <1/1000>  probability of an injected error per command
+ *     -k mac|at    kind of injected errors (-MERR: or AT!ERR:), default mac
+ *     -x <code>    code of injected errors, default 1
+ *     -s <seed>    seed of the error generator
+ *     -d <hex>     queue a downlink for the next bidirectional message, may be repeated
+ *     -D           start detached
+ */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include "miotyAtSim.h"
+#include "data_tools/string_tools.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint32_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000);
+}
+
+static int open_pty(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        return -1;
+
+    // raw slave, kept open so that clients can close and reopen it
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0)
+        return -1;
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    return master;
+}
+
+int main(int argc, char ** argv) {
+    static miotyAtSim sim;
+    miotyAtSim_config config = { .errorKind = MIOTYATSIM_ERROR_MAC, .errorCode = 1 };
+    uint8_t downlinks[MIOTYATSIM_DOWNLINKS][255];
+    uint8_t downlinkSizes[MIOTYATSIM_DOWNLINKS];
+    uint8_t nDownlinks = 0;
+    uint32_t gapMs = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:c:g:e:k:x:s:d:D")) != -1) {
+        switch (opt) {
+        case 'l': config.latencyMs = strtoul(optarg, NULL, 0); break;
+        case 'c': config.chunkSize = strtoul(optarg, NULL, 0); break;
+        case 'g': gapMs = strtoul(optarg, NULL, 0); break;
+        case 'e': config.errorPermille = strtoul(optarg, NULL, 0); break;
+        case 'k': config.errorKind = strcmp(optarg, "at") == 0 ? MIOTYATSIM_ERROR_AT : MIOTYATSIM_ERROR_MAC; break;
+        case 'x': config.errorCode = strtoul(optarg, NULL, 0); break;
+        case 's': config.seed = strtoul(optarg, NULL, 0); break;
+        case 'D': config.detached = true; break;
+        case 'd':
+            if (nDownlinks == MIOTYATSIM_DOWNLINKS || strlen(optarg) > 2 * 255
+                    || !string_hex2bytes((unsigned char const *)optarg, strlen(optarg), downlinks[nDownlinks], 255, NULL)) {
+                fprintf(stderr, "invalid downlink %s\n", optarg);
+                return 1;
+            }
+            downlinkSizes[nDownlinks++] = strlen(optarg) / 2;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l ms] [-c bytes] [-g ms] [-e permille] [-k mac|at] [-x code] [-s seed] [-d hex]... [-D]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    miotyAtSim_init(&sim, &config);
+    for (uint8_t i = 0; i < nDownlinks; i++)
+        miotyAtSim_queueDownlink(&sim, downlinks[i], downlinkSizes[i]);
+
+    int master = open_pty();
+    if (master < 0) {
+        perror("pty");
+        return 1;
+    }
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    uint32_t nextChunkAt = 0;
+    while (running) {
+        uint32_t now = now_ms();
+        int timeout = -1;
+        if (miotyAtSim_pending(&sim)) {
+            uint32_t at = miotyAtSim_readyAt(&sim);
+            if ((int32_t)(nextChunkAt - at) > 0)
+                at = nextChunkAt;
+            timeout = (int32_t)(at - now) > 0 ? (int)(at - now) : 0;
+        }
+
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        if (poll(&pfd, 1, timeout) < 0)
+            continue;
+        now = now_ms();
+        if (pfd.revents & POLLIN) {
+            uint8_t buf[256];
+            ssize_t n = read(master, buf, sizeof(buf));
+            if (n > 0)
+                miotyAtSim_write(&sim, buf, n, now);
+        }
+
+        if ((int32_t)(now - nextChunkAt) >= 0) {
+            uint8_t buf[MIOTYATSIM_OUT_SIZE];
+            size_t n = miotyAtSim_read(&sim, buf, sizeof(buf), now);
+            if (n > 0) {
+                if (write(master, buf, n) < 0)
+                    perror("write");
+                nextChunkAt = now + gapMs;
+            }
+        }
+    }
+
+    fprintf(stderr, "commands %u injected errors %u packet counter %u\n", sim.commands, sim.injectedErrors, sim.packetCounter);
+    return 0;
+}
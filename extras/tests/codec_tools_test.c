@@ -0,0 +1,182 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the time series codec in codec_tools.c
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc extras/tests/codec_tools_test.c src/data_tools/codec_tools.c -o codec_tools_test
+ *     ./codec_tools_test
+ *
+ * Covers zigzag mapping and varints at their boundaries, round trips of blocks of different series and sizes
+ * on one stream, and the rejection of blocks that don't fit or are truncated.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "data_tools/codec_tools.h"
+#include "miotyAtTest.h"
+
+#define SAMPLES     1024
+
+static int32_t samples[SAMPLES];
+static int32_t decoded[SAMPLES];
+static uint8_t encoded[CODEC_BLOCK_MAX(SAMPLES) * 2];
+
+static void test_zigzag(void) {
+    CHECK(codec_zigzag_encode(0) == 0 && codec_zigzag_encode(-1) == 1 && codec_zigzag_encode(1) == 2);
+    CHECK(codec_zigzag_encode(-2) == 3 && codec_zigzag_encode(INT32_MAX) == UINT32_MAX - 1);
+    CHECK(codec_zigzag_encode(INT32_MIN) == UINT32_MAX);
+    int32_t const values[] = { 0, 1, -1, 63, -64, 12345, -12345, INT32_MAX, INT32_MIN };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        CHECK(codec_zigzag_decode(codec_zigzag_encode(values[i])) == values[i]);
+}
+
+static void test_varint(void) {
+    uint32_t const values[] = { 0, 127, 128, 16383, 16384, 2097151, 2097152, 268435455, 268435456, UINT32_MAX };
+    uint8_t const lengths[] = { 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
+    uint8_t buf[CODEC_VARINT_MAX + 1];
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint32_t value;
+        uint8_t n = codec_varint_encode(buf, values[i]);
+        CHECK(n == lengths[i]);
+        CHECK(codec_varint_decode(buf, n, &value) == n && value == values[i]);
+        CHECK(codec_varint_decode(buf, n - 1, &value) == 0);
+    }
+    CHECK(codec_varint_encode(buf, 300) == 2 && buf[0] == 0xAC && buf[1] == 0x02);
+
+    // continuation bit on the last possible byte
+    uint32_t value;
+    memset(buf, 0x80, sizeof(buf));
+    CHECK(codec_varint_decode(buf, sizeof(buf), &value) == 0);
+}
+
+typedef void (*generator)(int32_t * values, size_t n);
+
+static void gen_constant(int32_t * values, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        values[i] = -42;
+}
+
+static void gen_counter(int32_t * values, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        values[i] = 1000000 + (int32_t)i * 3;
+}
+
+static void gen_walk(int32_t * values, size_t n) {
+    int32_t t = 2150;
+    for (size_t i = 0; i < n; i++) {
+        t += rand() % 7 - 3;
+        values[i] = t;
+    }
+}
+
+// full range including the extremes, the differences overflow int32
+static void gen_random(int32_t * values, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        values[i] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+    values[0] = INT32_MAX;
+    values[1] = INT32_MIN;
+    values[n - 1] = INT32_MIN;
+}
+
+static void test_blocks(void) {
+    generator const generators[] = { gen_constant, gen_counter, gen_walk, gen_random };
+    uint8_t const blockSizes[] = { 1, 2, 7, 8, 64, 255 };
+
+    srand(1);
+    for (size_t g = 0; g < sizeof(generators) / sizeof(generators[0]); g++) {
+        generators[g](samples, SAMPLES);
+        for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+            codec_stream enc, dec;
+            codec_stream_init(&enc, 0);
+            codec_stream_init(&dec, 0);
+            size_t encodedLen = 0;
+            bool ok = true;
+            for (size_t i = 0; i < SAMPLES; i += blockSizes[b]) {
+                uint8_t count = SAMPLES - i < blockSizes[b] ? SAMPLES - i : blockSizes[b];
+                size_t n = codec_delta_encode(&enc, samples + i, count, encoded + encodedLen, CODEC_BLOCK_MAX(count));
+                ok = ok && n > 0 && n <= CODEC_BLOCK_MAX(count);
+                encodedLen += n;
+            }
+            CHECK(ok);
+            size_t pos = 0, total = 0;
+            while (ok && pos < encodedLen) {
+                uint8_t count;
+                size_t n = codec_delta_decode(&dec, encoded + pos, encodedLen - pos, decoded + total, SAMPLES - total > 255 ? 255 : SAMPLES - total, &count);
+                ok = n > 0;
+                pos += n;
+                total += count;
+            }
+            CHECK(ok && total == SAMPLES && memcmp(decoded, samples, sizeof(samples)) == 0);
+            if (!ok)
+                printf("series %zu, block size %u\n", g, blockSizes[b]);
+        }
+    }
+
+    // constant blocks pack to the header, steps of 3 to 3 bit per value
+    codec_stream stream;
+    codec_stream_init(&stream, -42);
+    gen_constant(samples, 200);
+    CHECK(codec_delta_encode(&stream, samples, 200, encoded, sizeof(encoded)) == CODEC_BLOCK_HEADER);
+    CHECK(encoded[0] == CODEC_BLOCK_PACKED && encoded[1] == 200);
+    codec_stream_init(&stream, 1000000 - 3);
+    gen_counter(samples, 200);
+    CHECK(codec_delta_encode(&stream, samples, 200, encoded, sizeof(encoded)) == CODEC_BLOCK_HEADER + 75);
+    CHECK(encoded[0] == (CODEC_BLOCK_PACKED | 3));
+}
+
+static void test_limits(void) {
+    codec_stream enc, dec;
+    codec_stream_init(&enc, 0);
+    codec_stream_init(&dec, 0);
+    gen_walk(samples, 16);
+
+    // a block that doesn't fit leaves the stream where it was
+    size_t n = codec_delta_encode(&enc, samples, 16, encoded, sizeof(encoded));
+    CHECK(n > CODEC_BLOCK_HEADER);
+    codec_stream_init(&enc, 0);
+    CHECK(codec_delta_encode(&enc, samples, 16, encoded, n - 1) == 0 && enc.prev == 0);
+    CHECK(codec_delta_encode(&enc, samples, 16, encoded, n) == n && enc.prev == samples[15]);
+
+    // truncated blocks and too small value buffers are rejected without touching the stream
+    uint8_t count;
+    for (size_t size = 0; size < n; size++)
+        CHECK(codec_delta_decode(&dec, encoded, size, decoded, 16, &count) == 0 && dec.prev == 0);
+    CHECK(codec_delta_decode(&dec, encoded, n, decoded, 15, &count) == 0 && dec.prev == 0);
+    CHECK(codec_delta_decode(&dec, encoded, n, decoded, 16, &count) == n && count == 16);
+    CHECK(memcmp(decoded, samples, 16 * sizeof(int32_t)) == 0 && dec.prev == samples[15]);
+}
+
+int main(void) {
+    test_zigzag();
+    test_varint();
+    test_blocks();
+    test_limits();
+    return miotyAtTest_report();
+}
@@ -0,0 +1,158 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the attach tracking against the in-process simulator
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc -Iextras/simulator extras/tests/miotyAtAttach_test.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtAttach.c src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtAttach_test
+ *     ./miotyAtAttach_test
+ *
+ * Covers the uplink without status query, reattach and replay after MacNodeNotAttached, the LOCAL/OTA
+ * split of MacNetworkKeyNotSet and the backoff of failed attaches.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtAttach.h"
+#include "miotyAtTest.h"
+
+// attach commands written while failAttach is set fail with a MAC error
+static miotyAtSim * failSim;
+static bool failAttach;
+static miotyAtClient_writeHook simWrite;
+
+static void attach_write(void * user, uint8_t * data, uint16_t size) {
+    bool attach = size >= 7 && (memcmp(data, "AT-MALO", 7) == 0 || memcmp(data, "AT-MAOA", 7) == 0);
+    if (failAttach && attach)
+        miotyAtSim_injectError(failSim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacError);
+    simWrite(user, data, size);
+}
+
+static void bind(miotyAtSim * sim, miotyAtClient_ctx * ctx, bool detached) {
+    miotyAtSim_config config = { .detached = detached };
+    miotyAtSim_init(sim, &config);
+    miotyAtSim_bind(sim, ctx);
+    failSim = sim;
+    failAttach = false;
+    simWrite = ctx->write;
+    ctx->write = attach_write;
+}
+
+static miotyAtClient_returnCode send_uplink(miotyAtAttach * att, uint32_t nowMs) {
+    return miotyAtAttach_send(att, MIOTYATCMD_U, (uint8_t *)"ab", 2, NULL, NULL, NULL, nowMs);
+}
+
+static void test_reattach(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtAttach att;
+
+    // an attached node sends with one command
+    bind(&sim, &ctx, false);
+    miotyAtAttach_init(&att, &ctx, MIOTYATATTACH_LOCAL, NULL);
+    CHECK(miotyAtAttach_getState(&att) == MIOTYATATTACH_UNKNOWN);
+    CHECK(send_uplink(&att, 0) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == 1 && sim.packetCounter == 1 && miotyAtAttach_getState(&att) == MIOTYATATTACH_ATTACHED);
+
+    // after a reboot of the modem the node is attached locally and the uplink is sent again
+    sim.msta = MIOTYATSIM_MSTA_DETACHED;
+    uint32_t commands = sim.commands;
+    CHECK(send_uplink(&att, 0) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == commands + 3 && sim.packetCounter == 2 && sim.msta == MIOTYATSIM_MSTA_ATTACHED);
+    CHECK(att.reattaches == 1 && att.replays == 1 && miotyAtAttach_getState(&att) == MIOTYATATTACH_ATTACHED);
+
+    // over the air with the data given at init
+    static uint8_t const data[4] = { 1, 2, 3, 4 };
+    bind(&sim, &ctx, true);
+    miotyAtAttach_init(&att, &ctx, MIOTYATATTACH_OTA, data);
+    CHECK(send_uplink(&att, 0) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == 3 && sim.packetCounter == 1 && att.reattaches == 1 && att.replays == 1);
+}
+
+static void test_network_key(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtAttach att;
+    static uint8_t const data[4] = { 1, 2, 3, 4 };
+
+    // a local attach can't bring the key, the error is returned right away
+    bind(&sim, &ctx, false);
+    miotyAtAttach_init(&att, &ctx, MIOTYATATTACH_LOCAL, NULL);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNetworkKeyNotSet);
+    CHECK(send_uplink(&att, 0) == MIOTYATCLIENT_RETURN_CODE_MacNetworkKeyNotSet);
+    CHECK(sim.commands == 1 && att.reattaches == 0 && att.replays == 0);
+
+    // an over the air attach does
+    bind(&sim, &ctx, false);
+    miotyAtAttach_init(&att, &ctx, MIOTYATATTACH_OTA, data);
+    sim.msta = MIOTYATSIM_MSTA_DETACHED;
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNetworkKeyNotSet);
+    CHECK(send_uplink(&att, 0) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == 3 && att.reattaches == 1 && att.replays == 1);
+}
+
+static void test_backoff(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtAttach att;
+    bind(&sim, &ctx, true);
+    miotyAtAttach_init(&att, &ctx, MIOTYATATTACH_LOCAL, NULL);
+
+    // a failed attach returns the error of the uplink and waits before the next attempt
+    failAttach = true;
+    CHECK(send_uplink(&att, 1000) == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    CHECK(sim.commands == 2 && att.failedAttaches == 1 && att.backoff.delayMs == MIOTYATBACKOFF_MIN_MS);
+    CHECK(send_uplink(&att, 1000 + MIOTYATBACKOFF_MIN_MS - 1) == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    CHECK(sim.commands == 3 && att.failedAttaches == 1);
+
+    // every further failure doubles the wait
+    CHECK(send_uplink(&att, 1000 + MIOTYATBACKOFF_MIN_MS) == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    CHECK(sim.commands == 5 && att.failedAttaches == 2 && att.backoff.delayMs == 2 * MIOTYATBACKOFF_MIN_MS);
+    uint32_t nowMs = 1000 + 3 * MIOTYATBACKOFF_MIN_MS;
+    CHECK(send_uplink(&att, nowMs - 1) == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached && att.failedAttaches == 2);
+
+    // the wait is capped, and a successful attach starts over
+    for (uint8_t i = 0; i < 32; i++)
+        miotyAtBackoff_failed(&att.backoff, nowMs);
+    CHECK(att.backoff.delayMs == MIOTYATBACKOFF_MAX_MS);
+    nowMs += MIOTYATBACKOFF_MAX_MS;
+    failAttach = false;
+    CHECK(send_uplink(&att, nowMs) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(att.reattaches == 1 && att.replays == 1 && att.backoff.delayMs == 0);
+    CHECK(!miotyAtBackoff_waiting(&att.backoff, nowMs));
+}
+
+int main(void) {
+    test_reattach();
+    test_network_key();
+    test_backoff();
+    return miotyAtTest_report();
+}
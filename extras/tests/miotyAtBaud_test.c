@@ -0,0 +1,185 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the baud rate negotiation against the in-process simulator
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc -Iextras/simulator extras/tests/miotyAtBaud_test.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtBaud.c src/miotyAtClient.c src/miotyAtClientDefault.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtBaud_test
+ *     ./miotyAtBaud_test
+ *
+ * The simulator is wrapped by a link that loses every byte while host and modem run at different rates.
+ * Covers stepping up, rates the modem refuses, a step the modem never sees, a lost answer after the modem
+ * switched, and the missing clock hook.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtBaud.h"
+#include "miotyAtTest.h"
+
+// transport of the default context, unused
+void miotyAtClientWrite(uint8_t * data, uint16_t size) {
+    (void)data;
+    (void)size;
+}
+
+bool miotyAtClientRead(uint8_t * buf, uint8_t * len) {
+    (void)buf;
+    *len = 0;
+    return false;
+}
+
+// UART between host and simulated modem
+typedef struct link {
+    miotyAtSim * sim;
+    miotyAtClient_writeHook write;
+    miotyAtClient_readnHook readn;
+    uint32_t hostRate;
+    uint32_t modemRate;
+    uint32_t refuseRate;        // AT+IPR=<rate> answered with an AT error
+    uint32_t dropRate;          // AT+IPR=<rate> never reaches the modem
+    uint32_t loseRate;          // answer to AT+IPR=<rate> is lost, the modem switches anyway
+    bool losing;
+    uint8_t hostSwitches;
+} link;
+
+static link uart;
+
+static bool is_set(uint8_t const * data, uint16_t size, uint32_t rate) {
+    char cmd[20];
+    int len = snprintf(cmd, sizeof(cmd), "AT+IPR=%u\r", (unsigned)rate);
+    return rate != 0 && size == len && memcmp(data, cmd, len) == 0;
+}
+
+static void link_write(void * user, uint8_t * data, uint16_t size) {
+    if (uart.hostRate != uart.modemRate || is_set(data, size, uart.dropRate))
+        return;
+    if (is_set(data, size, uart.refuseRate))
+        miotyAtSim_injectError(uart.sim, MIOTYATSIM_ERROR_AT, 4);
+    uart.losing = is_set(data, size, uart.loseRate);
+    uart.write(user, data, size);
+}
+
+// the modem switches once its answer is out
+static bool link_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    bool ok = uart.readn(user, buf, cap, len);
+    if (uart.hostRate != uart.modemRate || uart.losing)
+        *len = 0;
+    if (!miotyAtSim_pending(uart.sim)) {
+        uart.modemRate = uart.sim->intValue[MIOTYATCMD_IPR];
+        uart.losing = false;
+    }
+    return ok;
+}
+
+static bool set_baud(void * user, uint32_t baudrate) {
+    (void)user;
+    uart.hostRate = baudrate;
+    uart.hostSwitches++;
+    return true;
+}
+
+static void link_init(miotyAtSim * sim, miotyAtClient_ctx * ctx) {
+    miotyAtSim_init(sim, NULL);
+    miotyAtSim_bind(sim, ctx);
+    memset(&uart, 0, sizeof(uart));
+    uart.sim = sim;
+    uart.write = ctx->write;
+    uart.readn = ctx->readn;
+    uart.hostRate = uart.modemRate = sim->intValue[MIOTYATCMD_IPR];
+    ctx->write = link_write;
+    ctx->readn = link_readn;
+}
+
+static uint32_t const rates[] = { 9600, 115200, 230400, 460800 };
+
+static void test_step_up(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtClient_baudReport report;
+    link_init(&sim, &ctx);
+
+    // rates at or below the current one are skipped
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.baudrate == 460800 && report.steps == 2 && report.refused == 0 && !report.fellBack);
+    CHECK(uart.hostRate == 460800 && uart.modemRate == 460800);
+
+    // nothing left to try
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.baudrate == 460800 && report.steps == 0);
+
+    // deadlines are required
+    ctx.clock = NULL;
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_ArgumentOOR);
+}
+
+static void test_refused(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtClient_baudReport report;
+    link_init(&sim, &ctx);
+
+    // the modem stays at the old rate and the next candidate is tried
+    uart.refuseRate = 230400;
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.baudrate == 460800 && report.steps == 2 && report.refused == 1 && !report.fellBack);
+    CHECK(uart.hostRate == 460800 && uart.modemRate == 460800 && uart.hostSwitches == 1);
+}
+
+static void test_fall_back(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtClient_baudReport report;
+
+    // the modem never sees the step and keeps the last working rate
+    link_init(&sim, &ctx);
+    uart.dropRate = 460800;
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.baudrate == 230400 && report.steps == 2 && report.fellBack);
+    CHECK(uart.hostRate == 230400 && uart.modemRate == 230400);
+    uint32_t baud = 0;
+    CHECK(miotyAtClientCtx_getOrSetBaudrate(&ctx, &baud, false) == MIOTYATCLIENT_RETURN_CODE_OK && baud == 230400);
+
+    // the modem switched but its answer got lost, it is told to go back over the new rate
+    link_init(&sim, &ctx);
+    uart.loseRate = 460800;
+    CHECK(miotyAtClientCtx_negotiateBaudrate(&ctx, set_baud, rates, 4, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.baudrate == 230400 && report.fellBack);
+    CHECK(uart.hostRate == 230400 && uart.modemRate == 230400);
+    CHECK(miotyAtClientCtx_getOrSetBaudrate(&ctx, &baud, false) == MIOTYATCLIENT_RETURN_CODE_OK && baud == 230400);
+}
+
+int main(void) {
+    test_step_up();
+    test_refused();
+    test_fall_back();
+    return miotyAtTest_report();
+}
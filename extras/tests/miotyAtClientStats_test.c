@@ -0,0 +1,104 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the per-command statistics against the in-process simulator
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -DMIOTYATCLIENT_STATS -Isrc -Iextras/simulator extras/tests/miotyAtClientStats_test.c \
+ *         extras/simulator/miotyAtSim.c src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtClientStats_test
+ *     ./miotyAtClientStats_test
+ *
+ * Covers the byte, call and read counters, the latency histogram on the simulator clock, the return code
+ * distribution, what is not counted (cache hits, Busy rejections) and resetting.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtTest.h"
+
+static miotyAtClient_stats stats;
+
+static miotyAtClient_cmdStats const * snapshot(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd) {
+    miotyAtClientCtx_getStats(ctx, &stats);
+    return &stats.cmd[cmd];
+}
+
+static void test_counters(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .latencyMs = 20, .chunkSize = 4 };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+
+    // one read of the transmit power, "-UTPL:14\r\n0\r" consumed in chunks of 4 byte after 20 ms
+    uint32_t txPower;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtClient_cmdStats const * s = snapshot(&ctx, MIOTYATCMD_UTPL);
+    CHECK(s->calls == 1 && s->bytesWritten == strlen("AT-UTPL?\r") && s->bytesRead == strlen("-UTPL:14\r\n0\r"));
+    CHECK(s->reads >= 4 && s->latencyMsSum == 20 && s->latency[5] == 1 && s->returnCodes[MIOTYATCLIENT_RETURN_CODE_OK] == 1);
+    CHECK(snapshot(&ctx, MIOTYATCMD_MEUI)->calls == 0);
+
+    // uplinks count their payload, errors their return code
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"abc", 3, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"abc", 3, NULL) == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    s = snapshot(&ctx, MIOTYATCMD_U);
+    CHECK(s->calls == 2 && s->bytesWritten == 2 * strlen("AT-U=3\t616263\x1A\r") && s->latencyMsSum == 40);
+    CHECK(s->returnCodes[MIOTYATCLIENT_RETURN_CODE_OK] == 1 && s->returnCodes[MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached] == 1);
+
+    // timeouts are counted as well, the virtual clock jumps to the response after 1500 ms
+    sim.config.latencyMs = 1500;
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    s = snapshot(&ctx, MIOTYATCMD_UTPL);
+    CHECK(s->calls == 2 && s->returnCodes[MIOTYATCLIENT_RETURN_CODE_Timeout] == 1 && s->latency[11] == 1);
+    while (miotyAtClientCtx_draining(&ctx))
+        miotyAtClientCtx_poll(&ctx);
+    sim.config.latencyMs = 20;
+
+    // cache hits and Busy rejections never reach the modem
+    miotyAtClientCtx_enableCache(&ctx, true);
+    for (uint8_t i = 0; i < 3; i++)
+        CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(snapshot(&ctx, MIOTYATCMD_UTPL)->calls == 3);
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, NULL, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, NULL, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_Busy);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(snapshot(&ctx, MIOTYATCMD_U)->calls == 3);
+
+    miotyAtClientCtx_resetStats(&ctx);
+    s = snapshot(&ctx, MIOTYATCMD_U);
+    CHECK(s->calls == 0 && s->bytesWritten == 0 && s->returnCodes[MIOTYATCLIENT_RETURN_CODE_OK] == 0);
+}
+
+int main(void) {
+    test_counters();
+    return miotyAtTest_report();
+}
@@ -0,0 +1,709 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the client and its add-ons against the in-process simulator
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc -Iextras/simulator extras/tests/miotyAtClient_test.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c src/miotyAtQueue.c \
+ *         src/miotyAtScheduler.c src/miotyAtSegment.c src/data_tools/string_tools.c src/data_tools/char_tools.c \
+ *         -o miotyAtClient_test
+ *     ./miotyAtClient_test
+ *
+ * Covers the async API and its callbacks, the timeout and drain path, payloads written in one or several
+ * pieces, the configuration cache, dispatch of unsolicited lines in between commands and within a response,
+ * the packet counter mirror and its verification, recovery of the queue after a torn record, ordering and
+ * supersede rules of the scheduler, and segmentation and reassembly.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtQueue.h"
+#include "miotyAtScheduler.h"
+#include "miotyAtSegment.h"
+#include "data_tools/string_tools.h"
+#include "miotyAtTest.h"
+
+// ***** async **********************************************************************************
+
+static miotyAtClient_result completed[4];
+static uint8_t nCompleted;
+static void * completedUser;
+
+static void on_completed(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser);
+
+// submits an uplink from the callback of the first command
+static void on_chain(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser) {
+    on_completed(ctx, result, cbUser);
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(ctx, (uint8_t *)"cd", 2, on_completed, cbUser, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+}
+
+static void on_completed(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser) {
+    CHECK(!miotyAtClientCtx_pending(ctx));
+    if (nCompleted < sizeof(completed) / sizeof(completed[0]))
+        completed[nCompleted] = *result;
+    nCompleted++;
+    completedUser = cbUser;
+}
+
+static void test_async(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .latencyMs = 20, .chunkSize = 7 };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+    int user;
+
+    // returns right away, the callback runs from poll with the downlink
+    static uint8_t const downlink[] = { 1, 2, 3, 4, 5 };
+    uint8_t data[8];
+    miotyAtClient_handle handle = 0;
+    nCompleted = 0;
+    miotyAtSim_queueDownlink(&sim, downlink, sizeof(downlink));
+    CHECK(miotyAtClientCtx_sendMessageBidiAsync(&ctx, (uint8_t *)"ab", 2, data, sizeof(data), on_completed, &user, &handle)
+            == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(handle != 0 && nCompleted == 0 && miotyAtClientCtx_pending(&ctx));
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, &user, NULL) == MIOTYATCLIENT_RETURN_CODE_Busy);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(nCompleted == 1 && completedUser == &user && completed[0].handle == handle);
+    CHECK(completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_OK && completed[0].hasPacketCounter);
+    CHECK(completed[0].packetCounter == sim.packetCounter && completed[0].data == data);
+    CHECK(completed[0].sizeData == sizeof(downlink) && memcmp(data, downlink, sizeof(downlink)) == 0);
+
+    // errors of the modem reach the callback, handles differ per command
+    nCompleted = 0;
+    miotyAtClient_handle last = handle;
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, NULL, &handle) == MIOTYATCLIENT_RETURN_CODE_OK);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(nCompleted == 1 && handle != last && completed[0].handle == handle);
+    CHECK(completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached && !completed[0].hasPacketCounter);
+
+    // the callback may submit the next command
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_macDetachLocalAsync(&ctx, on_chain, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(nCompleted == 2 && completed[0].hasMSTA && completed[0].MSTA == MIOTYATSIM_MSTA_DETACHED);
+    CHECK(completed[1].returnCode == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_macAttachLocalAsync(&ctx, on_completed, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(nCompleted == 1 && completed[0].hasMSTA && completed[0].MSTA == MIOTYATSIM_MSTA_ATTACHED);
+
+    // an event driven transport hands the received bytes to feed
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    while (miotyAtClientCtx_pending(&ctx)) {
+        uint8_t buf[16];
+        sim.nowMs++;
+        size_t n = miotyAtSim_read(&sim, buf, sizeof(buf), sim.nowMs);
+        // bytes behind the final result code are left over
+        CHECK(miotyAtClientCtx_feed(&ctx, buf, n) == n || !miotyAtClientCtx_pending(&ctx));
+    }
+    CHECK(nCompleted == 1 && completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(completed[0].packetCounter == sim.packetCounter);
+
+    // abort ends the command with the given code
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtClientCtx_abort(&ctx, MIOTYATCLIENT_RETURN_CODE_ATReadFailed);
+    CHECK(nCompleted == 1 && completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_ATReadFailed && !miotyAtClientCtx_pending(&ctx));
+}
+
+// ***** timeout ********************************************************************************
+
+static int asyncResult;
+
+static void on_async(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser) {
+    (void)ctx;
+    (void)cbUser;
+    asyncResult = result->returnCode;
+}
+
+static void test_timeout_drain(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .latencyMs = 1500 };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+    sim.intValue[MIOTYATCMD_UTPL] = 14;
+
+    // the modem answers after the deadline
+    uint32_t txPower = 0;
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    CHECK(miotyAtSim_pending(&sim));
+    CHECK(miotyAtClientCtx_draining(&ctx));
+
+    // async commands are rejected until the late response is swallowed
+    asyncResult = -1;
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_async, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_Busy);
+    while (miotyAtClientCtx_draining(&ctx))
+        miotyAtClientCtx_poll(&ctx);
+    CHECK(!miotyAtSim_pending(&sim));
+    CHECK(asyncResult == -1);
+
+    // the next command gets its own response, not the late one
+    sim.config.latencyMs = 10;
+    uint8_t eui[8];
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, eui, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(memcmp(eui, sim.bytesValue[MIOTYATCMD_MEUI], sizeof(eui)) == 0);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, 3);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == 3);
+
+    // a blocking call right after a timeout waits for the drain to end
+    sim.config.latencyMs = 1500;
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    sim.config.latencyMs = 10;
+    txPower = 0;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_OK && txPower == 14);
+
+    // flushing the receive path ends the drain right away
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    sim.config.latencyMs = 1500;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    sim.outHead = sim.outLen = sim.outEarly = 0;
+    miotyAtClientCtx_rxFlushed(&ctx);
+    CHECK(!miotyAtClientCtx_draining(&ctx));
+    sim.config.latencyMs = 10;
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, eui, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+
+    // without an answer the drain ends once its time is up
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    sim.config.latencyMs = 1500;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    sim.outHead = sim.outLen = sim.outEarly = 0;
+    uint32_t start = sim.nowMs;
+    while (miotyAtClientCtx_draining(&ctx))
+        miotyAtClientCtx_poll(&ctx);
+    CHECK(sim.nowMs - start >= MIOTYATCLIENT_DRAIN_MS);
+}
+
+// ***** commands *********************************************************************************
+
+// every byte written to the simulator, and the number of write hook calls
+static char written[MIOTYATSIM_CMD_SIZE];
+static uint16_t nWritten;
+static uint8_t writeCalls;
+static miotyAtClient_writeHook capturedWrite;
+
+static void capture_write(void * user, uint8_t * data, uint16_t size) {
+    if (nWritten + size <= sizeof(written))
+        memcpy(written + nWritten, data, size);
+    nWritten += size;
+    writeCalls++;
+    capturedWrite(user, data, size);
+}
+
+static void capture_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt) {
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        capture_write(user, (uint8_t *)iov[i].data, iov[i].size);
+        writeCalls--;
+    }
+    writeCalls++;
+}
+
+static void test_cmd_bytes(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    capturedWrite = ctx.write;
+    ctx.write = capture_write;
+
+    // the largest payload, split over several writes if the TX buffer is smaller (-DMIOTYATCLIENT_TX_BUF_SIZE=20)
+    uint8_t payload[255];
+    char expected[MIOTYATSIM_CMD_SIZE] = "AT-U=255\t";
+    for (uint16_t i = 0; i < sizeof(payload); i++)
+        payload[i] = i;
+    string_bytes2hex(payload, sizeof(payload), expected + 9, sizeof(expected) - 9);
+    memcpy(expected + 9 + 2 * sizeof(payload), "\x1A\r", 2);
+    uint16_t const len = 9 + 2 * sizeof(payload) + 2;
+
+    for (uint8_t vectored = 0; vectored < 2; vectored++) {
+        if (vectored)
+            miotyAtClientCtx_setWritev(&ctx, capture_writev);
+        for (uint16_t size = 0; size <= sizeof(payload); size += size < 20 ? 1 : 47) {
+            nWritten = writeCalls = 0;
+            CHECK(miotyAtClientCtx_sendMessageUni(&ctx, payload, size, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+            if (size != sizeof(payload))
+                continue;
+            CHECK(nWritten == len && memcmp(written, expected, len) == 0);
+            bool fits = (vectored ? 2 * sizeof(payload) : len) <= MIOTYATCLIENT_TX_BUF_SIZE;
+            CHECK(fits ? writeCalls == 1 : writeCalls > 1);
+        }
+    }
+    CHECK(sim.commands == 2 * 26);
+}
+
+// ***** cache ************************************************************************************
+
+// reads the transmit power and returns the number of commands the simulator saw for it
+static uint32_t read_tx_power(miotyAtSim * sim, miotyAtClient_ctx * ctx, uint32_t * txPower) {
+    uint32_t commands = sim->commands;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(ctx, txPower, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    return sim->commands - commands;
+}
+
+static void test_cache(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    miotyAtClientCtx_enableCache(&ctx, true);
+    sim.intValue[MIOTYATCMD_UTPL] = 14;
+
+    // the first read goes to the modem, the next ones are served locally
+    uint32_t txPower = 0;
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1 && txPower == 14);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 0 && txPower == 14);
+    uint8_t eui[8], cached[8];
+    uint32_t commands = sim.commands;
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, eui, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, cached, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == commands + 1 && memcmp(eui, cached, sizeof(eui)) == 0);
+
+    // sets write through, a failed set drops the value
+    txPower = 10;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, true) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 0 && txPower == 10 && sim.intValue[MIOTYATCMD_UTPL] == 10);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_AT, 3);
+    txPower = 12;
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, true) != MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1 && txPower == 10);
+
+    // reset, factory reset and AT-DEF drop the values the modem may have changed
+    sim.intValue[MIOTYATCMD_UTPL] = 5;
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 0 && txPower == 10);
+    CHECK(miotyAtClientCtx_reset(&ctx) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1 && txPower == 5);
+    sim.intValue[MIOTYATCMD_UTPL] = 6;
+    CHECK(miotyAtClientCtx_factoryReset(&ctx) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1 && txPower == 6);
+    uint8_t key[16] = { 0 }, ipv6[8] = { 0 }, shortAdress[2] = { 0 };
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 0);
+    CHECK(miotyAtClientCtx_setDefaults(&ctx, eui, ipv6, key, shortAdress, key, 0, 0, 0, 0, 1) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+    miotyAtClientCtx_invalidateCache(&ctx);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+
+    // a call budget used up by a cache hit does not carry over to the next command
+    sim.config.latencyMs = 100;
+    miotyAtClientCtx_setCallTimeout(&ctx, 5);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 0);
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, eui, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtClientCtx_setCallTimeout(&ctx, 5);
+    CHECK(miotyAtClientCtx_getOrSetEui(&ctx, eui, false) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtClientCtx_invalidateCache(&ctx);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+
+    // the same for the packet counter mirror
+    uint32_t counter = 0;
+    sim.msta = MIOTYATSIM_MSTA_ATTACHED;
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"ab", 2, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtClientCtx_setCallTimeout(&ctx, 5);
+    commands = sim.commands;
+    CHECK(miotyAtClientCtx_getPacketCounter(&ctx, &counter) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(sim.commands == commands && counter == sim.packetCounter);
+    miotyAtClientCtx_invalidateCache(&ctx);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+
+    // disabled, every read goes to the modem
+    miotyAtClientCtx_enableCache(&ctx, false);
+    sim.config.latencyMs = 0;
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+    CHECK(read_tx_power(&sim, &ctx, &txPower) == 1);
+}
+
+// ***** URC **************************************************************************************
+
+static char urcText[32];
+static uint8_t urcCalls;
+
+static void on_urc(miotyAtParser_urc const * urc, uint8_t const * text, uint8_t len) {
+    CHECK(urc->user == &urcCalls && len < sizeof(urcText));
+    memcpy(urcText, text, len);
+    urcText[len] = 0;
+    urcCalls++;
+}
+
+static void null_write(void * user, uint8_t * data, uint16_t size) {
+    (void)user;
+    (void)data;
+    (void)size;
+}
+
+static bool null_read(void * user, uint8_t * buf, uint8_t * len) {
+    (void)user;
+    (void)buf;
+    *len = 0;
+    return true;
+}
+
+static void test_urc(void) {
+    static miotyAtParser_urc const table[] = { { "-MDLR", on_urc, &urcCalls } };
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .chunkSize = 3 };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+
+    // without a table, poll doesn't read in between commands
+    miotyAtSim_urc(&sim, "-MDLR: 1");
+    CHECK(!miotyAtClientCtx_poll(&ctx) && miotyAtSim_pending(&sim));
+    sim.outHead = sim.outLen = sim.outEarly = 0;
+
+    // idle, lines of other keys are dropped
+    miotyAtClientCtx_setUrcTable(&ctx, table, 1);
+    miotyAtSim_urc(&sim, "-MFOO:9");
+    miotyAtSim_urc(&sim, "-mdlr: 2\tab");
+    while (miotyAtSim_pending(&sim))
+        CHECK(!miotyAtClientCtx_poll(&ctx));
+    CHECK(urcCalls == 1 && strcmp(urcText, "2\tab") == 0);
+
+    // a line not read yet when a command is submitted, it arrives while the command waits for its response
+    uint32_t txPower = 0;
+    sim.config.latencyMs = 50;
+    miotyAtSim_urc(&sim, "-MDLR:3");
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    while (miotyAtClientCtx_poll(&ctx));
+    CHECK(urcCalls == 2 && strcmp(urcText, "3") == 0);
+    CHECK(nCompleted == 1 && completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_OK && completed[0].packetCounter == sim.packetCounter);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, false) == MIOTYATCLIENT_RETURN_CODE_OK && txPower == sim.intValue[MIOTYATCMD_UTPL]);
+
+    // within a response and right after its final result code, in one piece
+    static char const response[] = "-MPCT:7\r\n-MDLR:4\r\n0\r\n-MDLR:5\r\n";
+    miotyAtClientCtx_init(&ctx, null_write, null_read, NULL);
+    miotyAtClientCtx_setUrcTable(&ctx, table, 1);
+    nCompleted = 0;
+    CHECK(miotyAtClientCtx_sendMessageUniAsync(&ctx, (uint8_t *)"ab", 2, on_completed, NULL, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(miotyAtClientCtx_feed(&ctx, (uint8_t const *)response, sizeof(response) - 1) == sizeof(response) - 1);
+    CHECK(nCompleted == 1 && completed[0].returnCode == MIOTYATCLIENT_RETURN_CODE_OK && completed[0].packetCounter == 7);
+    CHECK(urcCalls == 4 && strcmp(urcText, "5") == 0);
+}
+
+// ***** packet counter *****************************************************************************
+
+// reads the packet counter, checks it against the simulator and returns the number of commands it took
+static uint32_t read_counter(miotyAtSim * sim, miotyAtClient_ctx * ctx) {
+    uint32_t commands = sim->commands;
+    uint32_t counter = 0;
+    CHECK(miotyAtClientCtx_getPacketCounter(ctx, &counter) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(counter == sim->packetCounter);
+    return sim->commands - commands;
+}
+
+static void test_packet_counter(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    sim.packetCounter = 40;
+
+    // unknown at first, then mirrored from AT-MPCT and from -MPCT: of every uplink
+    CHECK(read_counter(&sim, &ctx) == 1);
+    CHECK(read_counter(&sim, &ctx) == 0);
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"ab", 2, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_counter(&sim, &ctx) == 0 && sim.packetCounter == 41);
+
+    // commands that may change the counter without reporting it drop the mirror
+    sim.packetCounter = 7;
+    CHECK(miotyAtClientCtx_reset(&ctx) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_counter(&sim, &ctx) == 1);
+    CHECK(miotyAtClientCtx_macAttachLocal(&ctx, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_counter(&sim, &ctx) == 1 && read_counter(&sim, &ctx) == 0);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_AT, 3);
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"ab", 2, NULL) != MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(read_counter(&sim, &ctx) == 1);
+
+    // so does an uplink that timed out, its late -MPCT: resyncs
+    sim.config.latencyMs = 1500;
+    miotyAtClientCtx_setCallTimeout(&ctx, 1000);
+    CHECK(miotyAtClientCtx_sendMessageUni(&ctx, (uint8_t *)"ab", 2, NULL) == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    CHECK(!ctx.packetCounter.valid);
+    while (miotyAtClientCtx_draining(&ctx))
+        miotyAtClientCtx_poll(&ctx);
+    sim.config.latencyMs = 0;
+    CHECK(read_counter(&sim, &ctx) == 0);
+
+    // verification reads the modem once the interval has passed and counts a counter that moved on its own
+    miotyAtClientCtx_setPacketCounterVerify(&ctx, 1000);
+    sim.packetCounter += 5;
+    sim.nowMs += 999;
+    uint32_t counter = 0;
+    CHECK(miotyAtClientCtx_getPacketCounter(&ctx, &counter) == MIOTYATCLIENT_RETURN_CODE_OK && counter == sim.packetCounter - 5);
+    sim.nowMs += 1;
+    CHECK(read_counter(&sim, &ctx) == 1 && ctx.packetCounter.mismatches == 1);
+    CHECK(read_counter(&sim, &ctx) == 0);
+    sim.nowMs += 1000;
+    CHECK(read_counter(&sim, &ctx) == 1 && ctx.packetCounter.mismatches == 1);
+}
+
+// ***** queue ************************************************************************************
+
+#define QUEUE_PAGE      512
+#define QUEUE_PAGES     4
+
+static uint8_t flash[QUEUE_PAGE * QUEUE_PAGES];
+
+static bool flash_program(void * user, uint32_t offset, void const * data, uint32_t size) {
+    (void)user;
+    for (uint32_t i = 0; i < size; i++)
+        flash[offset + i] &= ((uint8_t const *)data)[i];
+    return true;
+}
+
+static bool flash_erase(void * user, uint32_t offset) {
+    (void)user;
+    memset(flash + offset, 0xFF, QUEUE_PAGE);
+    return true;
+}
+
+static bool flash_sync_failed(void * user, uint32_t offset, uint32_t size) {
+    (void)user;
+    (void)offset;
+    (void)size;
+    return false;
+}
+
+static miotyAtQueue_storage const flashStorage = { flash, sizeof(flash), QUEUE_PAGE, flash_program, flash_erase, NULL, NULL };
+
+// first payload byte of every uplink written to the simulator, in order
+static uint8_t uplinks[16];
+static uint8_t nUplinks;
+static miotyAtClient_writeHook simWrite;
+
+static void record_write(void * user, uint8_t * data, uint16_t size) {
+    char const * tab = memchr(data, '\t', size);
+    if (strncmp((char const *)data, "AT-U=", 5) == 0 && tab != NULL && nUplinks < sizeof(uplinks))
+        string_hex2bytes((unsigned char const *)tab + 1, 2, &uplinks[nUplinks++], 1, NULL);
+    simWrite(user, data, size);
+}
+
+static void test_queue_torn_record(void) {
+    miotyAtQueue queue;
+    memset(flash, 0xFF, sizeof(flash));
+    CHECK(miotyAtQueue_open(&queue, &flashStorage));
+    for (uint8_t i = 1; i <= 3; i++) {
+        uint8_t payload[20] = { i };
+        CHECK(miotyAtQueue_push(&queue, MIOTYATCMD_U, payload, sizeof(payload)) == MIOTYATCLIENT_RETURN_CODE_OK);
+    }
+
+    // power cut while appending the fourth record: payload and part of the header are programmed
+    uint32_t torn = queue.tail;
+    uint8_t payload[20] = { 4 };
+    uint8_t header[4] = { MIOTYATQUEUE_MAGIC & 0xFF, MIOTYATQUEUE_MAGIC >> 8, MIOTYATQUEUE_STATE_QUEUED, MIOTYATCMD_U };
+    flash_program(NULL, torn + MIOTYATQUEUE_HEADER_SIZE, payload, sizeof(payload));
+    flash_program(NULL, torn, header, sizeof(header));
+
+    CHECK(miotyAtQueue_open(&queue, &flashStorage));
+    CHECK(miotyAtQueue_pending(&queue) == 3);
+    CHECK(queue.nextSeq == 3);
+    CHECK(queue.tail != torn && queue.tail % QUEUE_PAGE == 0);
+
+    // appending goes on behind the torn record, which is never sent
+    payload[0] = 5;
+    CHECK(miotyAtQueue_push(&queue, MIOTYATCMD_U, payload, sizeof(payload)) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(miotyAtQueue_open(&queue, &flashStorage));
+    CHECK(miotyAtQueue_pending(&queue) == 4);
+
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    simWrite = ctx.write;
+    ctx.write = record_write;
+    nUplinks = 0;
+    CHECK(miotyAtQueue_drain(&queue, &ctx, 0) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(nUplinks == 4 && uplinks[0] == 1 && uplinks[1] == 2 && uplinks[2] == 3 && uplinks[3] == 5);
+
+    // sent records stay sent after a restart
+    CHECK(miotyAtQueue_open(&queue, &flashStorage));
+    CHECK(miotyAtQueue_pending(&queue) == 0);
+
+    // storage failures are not mistaken for a broken modem link
+    miotyAtQueue_storage failing = flashStorage;
+    failing.sync = flash_sync_failed;
+    CHECK(miotyAtQueue_open(&queue, &failing));
+    CHECK(miotyAtQueue_push(&queue, MIOTYATCMD_U, payload, sizeof(payload)) == MIOTYATCLIENT_RETURN_CODE_StorageFailed);
+}
+
+// ***** scheduler ********************************************************************************
+
+static char order[16];
+static uint8_t nOrder;
+static uint8_t supersededCount;
+
+static void on_sched(miotyAtScheduler * sched, miotyAtScheduler_status status, miotyAtClient_result const * result, void * cbUser) {
+    (void)sched;
+    (void)result;
+    if (status == MIOTYATSCHEDULER_SENT && nOrder < sizeof(order) - 1)
+        order[nOrder++] = *(char const *)cbUser;
+    else if (status == MIOTYATSCHEDULER_SUPERSEDED)
+        supersededCount++;
+}
+
+static void run_scheduler(miotyAtScheduler * sched, miotyAtSim * sim, miotyAtClient_ctx * ctx) {
+    while (miotyAtScheduler_pending(sched) != 0) {
+        miotyAtScheduler_run(sched, sim->nowMs);
+        while (miotyAtClientCtx_poll(ctx));
+    }
+}
+
+static void test_scheduler(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtScheduler sched;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    miotyAtScheduler_init(&sched, &ctx, 0, 0, 0);
+
+    // priority first, then earliest deadline, then oldest
+    uint8_t payload[4] = { 0 };
+    memset(order, 0, sizeof(order));
+    nOrder = 0;
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_LOW, 0, payload, 4, 0, on_sched, "a", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 0, on_sched, "b", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 0, on_sched, "c", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 60000, on_sched, "d", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 30000, on_sched, "e", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_HIGH, 0, payload, 4, 0, on_sched, "f", 0);
+    run_scheduler(&sched, &sim, &ctx);
+    CHECK(strcmp(order, "fedbca") == 0);
+
+    // a message with the key of a queued one replaces it and keeps its place in line
+    memset(order, 0, sizeof(order));
+    nOrder = 0;
+    supersededCount = 0;
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 7, payload, 4, 0, on_sched, "x", 0);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 0, on_sched, "y", 0);
+    CHECK(miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 7, payload, 4, 0, on_sched, "z", 0)
+            == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(supersededCount == 1 && miotyAtScheduler_pending(&sched) == 2);
+    run_scheduler(&sched, &sim, &ctx);
+    CHECK(strcmp(order, "zy") == 0);
+
+    // the message in flight is never replaced
+    memset(order, 0, sizeof(order));
+    nOrder = 0;
+    supersededCount = 0;
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 9, payload, 4, 0, on_sched, "p", 0);
+    miotyAtScheduler_run(&sched, sim.nowMs);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 9, payload, 4, 0, on_sched, "q", 0);
+    run_scheduler(&sched, &sim, &ctx);
+    CHECK(supersededCount == 0 && strcmp(order, "pq") == 0);
+
+    // queued messages past their deadline are dropped
+    memset(order, 0, sizeof(order));
+    nOrder = 0;
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 100, on_sched, "r", sim.nowMs);
+    miotyAtScheduler_run(&sched, sim.nowMs + 100);
+    CHECK(miotyAtScheduler_pending(&sched) == 0 && nOrder == 0 && sched.expired == 1);
+
+    // airtime is charged once the modem answered, and only if it may have transmitted
+    miotyAtScheduler_init(&sched, &ctx, 10, 3600000, sim.nowMs);
+    uint32_t credit = sched.creditUs;
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 0, on_sched, "s", sim.nowMs);
+    miotyAtScheduler_run(&sched, sim.nowMs);
+    CHECK(sched.inFlight != NULL && sched.creditUs == credit);
+    run_scheduler(&sched, &sim, &ctx);
+    CHECK(sched.sent == 0 && sched.airtimeUs == 0 && sched.creditUs >= credit);
+    miotyAtScheduler_enqueue(&sched, MIOTYATCMD_U, MIOTYATSCHEDULER_PRIO_NORMAL, 0, payload, 4, 0, on_sched, "t", sim.nowMs);
+    run_scheduler(&sched, &sim, &ctx);
+    CHECK(sched.sent == 1 && sched.airtimeUs == miotyAtScheduler_airtimeUs(sched.profile, sched.mode, 4));
+}
+
+// ***** segments *********************************************************************************
+
+static void test_segments(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+
+    // MPF field in front of the segment header, up- and downlink
+    uint8_t payload[101];
+    payload[0] = 0x42;
+    for (size_t i = 1; i < sizeof(payload); i++)
+        payload[i] = (uint8_t)i;
+    uint8_t const down0[] = { 0x77, 9, 0, 'a', 'b' };
+    uint8_t const down1[] = { 0x77, 9, 1 | MIOTYATSEGMENT_LAST, 'c' };
+    miotyAtSim_queueDownlink(&sim, down0, sizeof(down0));
+    miotyAtSim_queueDownlink(&sim, down1, sizeof(down1));
+
+    uint8_t buf[16];
+    miotyAtSegmentRx rx;
+    miotyAtSegmentTx tx;
+    miotyAtSegmentRx_init(&rx, buf, sizeof(buf));
+    CHECK(miotyAtSegmentTx_start(&tx, &ctx, MIOTYATCMD_BMPF, payload, sizeof(payload), 43, 5, &rx) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(tx.count == 3);
+    CHECK(miotyAtSegmentTx_send(&tx) == MIOTYATCLIENT_RETURN_CODE_OK && miotyAtSegmentTx_done(&tx));
+    CHECK(sim.commands == 3);
+    CHECK(rx.complete && rx.len == 3 && memcmp(buf, "abc", 3) == 0 && rx.mpfField == 0x77);
+    CHECK(tx.uplink[0] == 0x42 && tx.uplink[1] == 5 && tx.uplink[2] == (2 | MIOTYATSEGMENT_LAST) && tx.uplink[3] == 81);
+
+    // a failed uplink is resumed with the same segment
+    CHECK(miotyAtSegmentTx_start(&tx, &ctx, MIOTYATCMD_U, payload, sizeof(payload), 52, 6, NULL) == MIOTYATCLIENT_RETURN_CODE_OK);
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_MAC, 3);
+    CHECK(miotyAtSegmentTx_send(&tx) == 3 && tx.next == 0);
+    CHECK(miotyAtSegmentTx_send(&tx) == MIOTYATCLIENT_RETURN_CODE_OK && tx.next == 3);
+
+    // reassembly: repeated segments are ignored, gaps and overflows drop the message, a new id starts over
+    miotyAtSegmentRx_init(&rx, buf, 4);
+    uint8_t const s0[] = { 1, 0, 'x', 'y' };
+    uint8_t const s1[] = { 1, 1 | MIOTYATSEGMENT_LAST, 'z' };
+    uint8_t const s2[] = { 1, 2 | MIOTYATSEGMENT_LAST, 'z' };
+    uint8_t const big[] = { 2, 1 | MIOTYATSEGMENT_LAST, '1', '2', '3' };
+    uint8_t const t0[] = { 2, 0, 'u', 'v' };
+    uint8_t const u0[] = { 3, 0 | MIOTYATSEGMENT_LAST, 'w' };
+    CHECK(miotyAtSegmentRx_feed(&rx, s0, sizeof(s0)) == MIOTYATSEGMENT_INCOMPLETE);
+    CHECK(miotyAtSegmentRx_feed(&rx, s0, sizeof(s0)) == MIOTYATSEGMENT_INCOMPLETE);
+    CHECK(miotyAtSegmentRx_feed(&rx, s1, sizeof(s1)) == MIOTYATSEGMENT_COMPLETE && rx.len == 3 && memcmp(buf, "xyz", 3) == 0);
+    CHECK(miotyAtSegmentRx_feed(&rx, s0, sizeof(s0)) == MIOTYATSEGMENT_INCOMPLETE);
+    CHECK(miotyAtSegmentRx_feed(&rx, s2, sizeof(s2)) == MIOTYATSEGMENT_ERROR);
+    CHECK(miotyAtSegmentRx_feed(&rx, t0, sizeof(t0)) == MIOTYATSEGMENT_INCOMPLETE);
+    CHECK(miotyAtSegmentRx_feed(&rx, big, sizeof(big)) == MIOTYATSEGMENT_ERROR);
+    CHECK(miotyAtSegmentRx_feed(&rx, t0, sizeof(t0)) == MIOTYATSEGMENT_INCOMPLETE);
+    CHECK(miotyAtSegmentRx_feed(&rx, u0, sizeof(u0)) == MIOTYATSEGMENT_COMPLETE && rx.len == 1 && buf[0] == 'w');
+}
+
+int main(void) {
+    test_async();
+    test_timeout_drain();
+    test_cmd_bytes();
+    test_cache();
+    test_urc();
+    test_packet_counter();
+    test_queue_torn_record();
+    test_scheduler();
+    test_segments();
+    return miotyAtTest_report();
+}
@@ -0,0 +1,169 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the declarative configuration against the in-process simulator
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc -Iextras/simulator extras/tests/miotyAtConfig_test.c extras/simulator/miotyAtSim.c \
+ *         src/miotyAtConfig.c src/miotyAtClient.c src/miotyAtClientDefault.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtConfig_test
+ *     ./miotyAtConfig_test
+ *
+ * Covers writing only the fields that differ, set-only fields, failed writes and the AT-DEF fallback.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtConfig.h"
+#include "miotyAtTest.h"
+
+// transport of the default context, unused
+void miotyAtClientWrite(uint8_t * data, uint16_t size) {
+    (void)data;
+    (void)size;
+}
+
+bool miotyAtClientRead(uint8_t * buf, uint8_t * len) {
+    (void)buf;
+    *len = 0;
+    return false;
+}
+
+// AT-DEF fails with an AT error
+static miotyAtClient_writeHook simWrite;
+
+static void reject_defaults(void * user, uint8_t * data, uint16_t size) {
+    if (size >= 7 && memcmp(data, "AT-DEF=", 7) == 0)
+        miotyAtSim_injectError(user, MIOTYATSIM_ERROR_AT, 6);
+    simWrite(user, data, size);
+}
+
+// every AT-DEF field differs from the state of a fresh simulator
+static void full_config(miotyAtClient_config * config) {
+    memset(config, 0, sizeof(*config));
+    config->fields = MIOTYATCLIENT_CONFIG_DEFAULTS | MIOTYATCLIENT_CONFIG_FLAG(TX_POWER);
+    config->attached1stBoot = 1;
+    memset(config->eui64, 0x11, sizeof(config->eui64));
+    memset(config->ipv6, 0x22, sizeof(config->ipv6));
+    memset(config->shortAdress, 0x33, sizeof(config->shortAdress));
+    memset(config->nwKey, 0x44, sizeof(config->nwKey));
+    memset(config->appCryptoKey, 0x55, sizeof(config->appCryptoKey));
+    config->txPower = 10;
+    config->ulMode = 1;
+    config->ulSyncBurst = 1;
+    config->ulProfile = 2;
+    config->appCryptoMode = 1;
+}
+
+static void test_diff(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtClient_configReport report;
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+
+    // only the transmit power differs
+    miotyAtClient_config config = { .fields = MIOTYATCLIENT_CONFIG_FLAG(EUI) | MIOTYATCLIENT_CONFIG_FLAG(TX_POWER)
+            | MIOTYATCLIENT_CONFIG_FLAG(UL_MODE), .txPower = 10 };
+    memcpy(config.eui64, sim.bytesValue[MIOTYATCMD_MEUI], sizeof(config.eui64));
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.reads == 3 && report.writes == 1 && !report.usedDefaults && sim.commands == 4);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_EUI] == MIOTYATCLIENT_CONFIG_STATUS_UNCHANGED);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_UL_MODE] == MIOTYATCLIENT_CONFIG_STATUS_UNCHANGED);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_TX_POWER] == MIOTYATCLIENT_CONFIG_STATUS_WRITTEN);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_IPV6] == MIOTYATCLIENT_CONFIG_STATUS_SKIPPED);
+    CHECK(sim.intValue[MIOTYATCMD_UTPL] == 10);
+
+    // applied again, nothing is written
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.reads == 3 && report.writes == 0);
+
+    // keys can't be read back and are always written
+    config.fields = MIOTYATCLIENT_CONFIG_FLAG(NETWORK_KEY);
+    memset(config.nwKey, 0x44, sizeof(config.nwKey));
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.reads == 0 && report.writes == 1);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_NETWORK_KEY] == MIOTYATCLIENT_CONFIG_STATUS_WRITTEN);
+    CHECK(memcmp(sim.bytesValue[MIOTYATCMD_MNWK], config.nwKey, sizeof(config.nwKey)) == 0);
+
+    // a failed write is reported with its error
+    miotyAtSim_injectError(&sim, MIOTYATSIM_ERROR_AT, 3);
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == 3 + MIOTYATCLIENT_RETURN_CODE_ATErr);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_NETWORK_KEY] == MIOTYATCLIENT_CONFIG_STATUS_FAILED);
+    CHECK(report.returnCode[MIOTYATCLIENT_CONFIG_NETWORK_KEY] == 3 + MIOTYATCLIENT_RETURN_CODE_ATErr);
+}
+
+static void test_defaults(void) {
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtClient_configReport report;
+    miotyAtClient_config config;
+
+    // without allowDefaults every field is written on its own
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    full_config(&config);
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(!report.usedDefaults && report.writes == 10 && !sim.hasDefaults);
+
+    // with it, AT-DEF and a factory reset replace the single writes, the transmit power follows after the reset
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    config.allowDefaults = true;
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(report.usedDefaults && report.reads == 8 && report.writes == 3 && sim.hasDefaults);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_EUI] == MIOTYATCLIENT_CONFIG_STATUS_DEFAULTS);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_NETWORK_KEY] == MIOTYATCLIENT_CONFIG_STATUS_DEFAULTS);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_TX_POWER] == MIOTYATCLIENT_CONFIG_STATUS_WRITTEN);
+    CHECK(memcmp(sim.bytesValue[MIOTYATCMD_MEUI], config.eui64, sizeof(config.eui64)) == 0);
+    CHECK(memcmp(sim.bytesValue[MIOTYATCMD_ACK], config.appCryptoKey, sizeof(config.appCryptoKey)) == 0);
+    CHECK(sim.intValue[MIOTYATCMD_UP] == 2 && sim.intValue[MIOTYATCMD_UTPL] == 10 && sim.msta == MIOTYATSIM_MSTA_ATTACHED);
+
+    // once the modem matches, the single writes are cheaper again
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(!report.usedDefaults && report.writes == 2);
+
+    // a rejected AT-DEF is reported for its fields, which are then written one by one
+    miotyAtSim_init(&sim, NULL);
+    miotyAtSim_bind(&sim, &ctx);
+    simWrite = ctx.write;
+    ctx.write = reject_defaults;
+    CHECK(miotyAtClientCtx_applyConfig(&ctx, &config, &report) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(!report.usedDefaults && report.writes == 11 && !sim.hasDefaults);
+    CHECK(report.status[MIOTYATCLIENT_CONFIG_EUI] == MIOTYATCLIENT_CONFIG_STATUS_WRITTEN);
+    CHECK(report.returnCode[MIOTYATCLIENT_CONFIG_EUI] == 6 + MIOTYATCLIENT_RETURN_CODE_ATErr);
+    CHECK(report.returnCode[MIOTYATCLIENT_CONFIG_TX_POWER] == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(memcmp(sim.bytesValue[MIOTYATCMD_MEUI], config.eui64, sizeof(config.eui64)) == 0);
+}
+
+int main(void) {
+    test_diff();
+    test_defaults();
+    return miotyAtTest_report();
+}
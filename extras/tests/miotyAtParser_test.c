@@ -0,0 +1,106 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of the response parser
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc extras/tests/miotyAtParser_test.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         -o miotyAtParser_test
+ *     ./miotyAtParser_test
+ *
+ * Covers a response split at every chunk boundary and offset, MAC errors and invalid hex payloads.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "miotyAtParser.h"
+#include "miotyAtTest.h"
+
+static uint8_t urcCalls;
+
+static void on_urc(miotyAtParser_urc const * urc, uint8_t const * text, uint8_t len) {
+    (void)urc;
+    if (len == 3 && memcmp(text, "abc", 3) == 0)
+        urcCalls++;
+}
+
+// feeds response in pieces of chunk bytes starting at offset split, returns bytes consumed
+static size_t feed_split(miotyAtParser * parser, char const * response, size_t split, size_t chunk) {
+    size_t len = strlen(response);
+    size_t used = miotyAtParser_feed(parser, (uint8_t const *)response, split);
+    for (size_t off = split; off < len && !miotyAtParser_done(parser); off += chunk)
+        used += miotyAtParser_feed(parser, (uint8_t const *)response + off, off + chunk <= len ? chunk : len - off);
+    return used;
+}
+
+static void test_parser_chunks(void) {
+    static char const response[] = "AT-B=3\t010203\x1A\r\n-MURC: abc\r\n-MPCT:1234\r\n-MSTA:1\r\n-B:5\t0a0B0c0D0e\r\n0\r\nAT";
+    static miotyAtParser_urc const urc[] = { { "-MURC", on_urc, NULL } };
+    static uint8_t const expected[] = { 0x0a, 0x0b, 0x0c, 0x0d, 0x0e };
+    size_t const len = strlen(response);
+    // parsing stops right after the '\r' of the final result code
+    size_t const end = strstr(response, "\r\n0\r\n") - response + 4;
+
+    for (size_t chunk = 1; chunk <= len; chunk++) {
+        for (size_t split = 0; split <= len; split++) {
+            miotyAtParser parser;
+            uint8_t data[8] = { 0 };
+            miotyAtParser_init(&parser, MIOTYATCMD_B, data, sizeof(data));
+            miotyAtParser_setUrc(&parser, urc, 1);
+            urcCalls = 0;
+            size_t used = feed_split(&parser, response, split, chunk);
+
+            bool ok = miotyAtParser_done(&parser) && parser.resultCode == MIOTYATPARSER_RESULT_OK
+                    && used == end && parser.mpct == 1234 && parser.msta == 1
+                    && parser.dataLen == sizeof(expected) && memcmp(data, expected, sizeof(expected)) == 0
+                    && !parser.invalidHex && urcCalls == 1;
+            CHECK(ok);
+            if (!ok) {
+                printf("     chunk %zu split %zu\n", chunk, split);
+                return;
+            }
+        }
+    }
+
+    // MAC error with its code, split inside the number
+    miotyAtParser parser;
+    miotyAtParser_init(&parser, MIOTYATCMD_U, NULL, 0);
+    feed_split(&parser, "-MNFO:6\r\n1\r\n", 5, 1);
+    CHECK(parser.resultCode == MIOTYATPARSER_RESULT_MACERR && (parser.fields & MIOTYATPARSER_FIELD_MNFO) && parser.mnfo == 6);
+
+    // a non-hex character in the payload is flagged
+    uint8_t data[4];
+    miotyAtParser_init(&parser, MIOTYATCMD_MSAD, data, sizeof(data));
+    feed_split(&parser, "-MSAD:2\t01x2\r\n0\r\n", 9, 3);
+    CHECK(miotyAtParser_done(&parser) && parser.invalidHex);
+}
+
+int main(void) {
+    test_parser_chunks();
+    return miotyAtTest_report();
+}
@@ -0,0 +1,59 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Check macro shared by the test programs in extras/tests
+ *
+ * Every test program is a single file with its own main() and its build line in the file header. CHECK()
+ * counts a check and prints the failed ones, miotyAtTest_report() prints the totals and gives the exit code.
+ */
+
+#ifndef _AT_TEST_H
+#define _AT_TEST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+static unsigned miotyAtTest_checks;
+static unsigned miotyAtTest_failures;
+
+#define CHECK(cond) miotyAtTest_check((cond), #cond, __func__, __LINE__)
+
+static inline bool miotyAtTest_check(bool ok, char const * what, char const * func, int line) {
+    miotyAtTest_checks++;
+    if (!ok) {
+        miotyAtTest_failures++;
+        printf("FAIL %s:%d: %s\n", func, line, what);
+    }
+    return ok;
+}
+
+// exit code of main(): 1 if a check failed
+static inline int miotyAtTest_report(void) {
+    printf("%u checks, %u failed\n", miotyAtTest_checks, miotyAtTest_failures);
+    return miotyAtTest_failures != 0;
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Tests of recording a session against the in-process simulator and replaying it
+ *
+ * Build and run on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Wall -Isrc -Iextras/simulator -Iextras/trace extras/tests/miotyAtTrace_test.c \
+ *         extras/simulator/miotyAtSim.c extras/trace/miotyAtTrace.c src/miotyAtClient.c src/miotyAtParser.c \
+ *         src/miotyAtCommands.c src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtTrace_test
+ *     ./miotyAtTrace_test
+ *
+ * Covers the recorded records, a replay returning the recorded results (errors and a timeout included) and
+ * the detection of commands that differ from the recording.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "miotyAtSim.h"
+#include "miotyAtTrace.h"
+#include "miotyAtTest.h"
+
+#define LOG_PATH    "miotyAtTrace_test.log"
+
+typedef struct session {
+    miotyAtClient_returnCode rc[5];
+    uint32_t txPower;
+    uint32_t packetCounter;
+    uint8_t eui[8];
+} session;
+
+// the same calls against the simulator (sim set) or a replay (sim NULL)
+static void run_session(miotyAtClient_ctx * ctx, miotyAtSim * sim, session * s) {
+    memset(s, 0, sizeof(*s));
+    s->rc[0] = miotyAtClientCtx_getOrSetTransmitPower(ctx, &s->txPower, false);
+    s->rc[1] = miotyAtClientCtx_sendMessageUni(ctx, (uint8_t *)"hello", 5, &s->packetCounter);
+    if (sim)
+        miotyAtSim_injectError(sim, MIOTYATSIM_ERROR_MAC, MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached);
+    s->rc[2] = miotyAtClientCtx_sendMessageUni(ctx, (uint8_t *)"hello", 5, NULL);
+
+    // a command timing out and its late response being drained
+    if (sim)
+        sim->config.latencyMs = 1500;
+    miotyAtClientCtx_setCallTimeout(ctx, 1000);
+    s->rc[3] = miotyAtClientCtx_getOrSetTransmitPower(ctx, &s->txPower, false);
+    while (miotyAtClientCtx_draining(ctx))
+        miotyAtClientCtx_poll(ctx);
+    if (sim)
+        sim->config.latencyMs = 30;
+
+    s->rc[4] = miotyAtClientCtx_getOrSetEui(ctx, s->eui, false);
+}
+
+static size_t load_log(uint8_t ** log) {
+    FILE * file = fopen(LOG_PATH, "rb");
+    if (file == NULL)
+        return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    *log = malloc(size);
+    size_t n = fread(*log, 1, size, file);
+    fclose(file);
+    return n;
+}
+
+static void test_round_trip(void) {
+    static miotyAtTrace trace;
+    miotyAtSim sim;
+    miotyAtClient_ctx ctx;
+    miotyAtSim_config config = { .latencyMs = 30, .chunkSize = 5 };
+    miotyAtSim_init(&sim, &config);
+    miotyAtSim_bind(&sim, &ctx);
+
+    session recorded;
+    CHECK(miotyAtTrace_start(&trace, &ctx, LOG_PATH));
+    run_session(&ctx, &sim, &recorded);
+    uint32_t records = trace.records;
+    miotyAtTrace_stop(&trace);
+    CHECK(recorded.rc[0] == MIOTYATCLIENT_RETURN_CODE_OK && recorded.rc[1] == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(recorded.rc[2] == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached && recorded.rc[3] == MIOTYATCLIENT_RETURN_CODE_Timeout);
+    CHECK(recorded.rc[4] == MIOTYATCLIENT_RETURN_CODE_OK);
+
+    // header, then the first command and its response in chunks of 5 byte, 30 ms later on the simulator clock
+    uint8_t * log = NULL;
+    size_t size = load_log(&log);
+    CHECK(size > MIOTYATTRACE_HEADER_SIZE && memcmp(log, MIOTYATTRACE_MAGIC, 7) == 0 && log[7] == MIOTYATTRACE_VERSION);
+    uint8_t kind;
+    uint64_t dtUs;
+    uint8_t const * data;
+    size_t len;
+    size_t pos = miotyAtTrace_record(log, size, MIOTYATTRACE_HEADER_SIZE, &kind, &dtUs, &data, &len);
+    CHECK(pos != 0 && kind == MIOTYATTRACE_TX && len == 9 && memcmp(data, "AT-UTPL?\r", 9) == 0);
+    pos = miotyAtTrace_record(log, size, pos, &kind, &dtUs, &data, &len);
+    CHECK(pos != 0 && kind == MIOTYATTRACE_RX && len == 5 && dtUs == 30000);
+    uint32_t n = 2;
+    while (pos != 0 && pos < size) {
+        pos = miotyAtTrace_record(log, size, pos, &kind, &dtUs, &data, &len);
+        n++;
+    }
+    CHECK(pos == size && n == records);
+    free(log);
+
+    // the replay gives the client the recorded results
+    miotyAtReplay replay;
+    session replayed;
+    CHECK(miotyAtReplay_open(&replay, LOG_PATH, 0));
+    miotyAtReplay_bind(&replay, &ctx);
+    run_session(&ctx, NULL, &replayed);
+    CHECK(memcmp(replayed.rc, recorded.rc, sizeof(recorded.rc)) == 0);
+    CHECK(replayed.txPower == recorded.txPower && replayed.packetCounter == recorded.packetCounter);
+    CHECK(memcmp(replayed.eui, recorded.eui, sizeof(recorded.eui)) == 0);
+    CHECK(miotyAtReplay_done(&replay) && replay.txMismatches == 0 && replay.skippedRx == 0);
+    miotyAtReplay_close(&replay);
+
+    // a different command is counted, its recorded response still served
+    uint32_t txPower = 0;
+    CHECK(miotyAtReplay_open(&replay, LOG_PATH, 0));
+    miotyAtReplay_bind(&replay, &ctx);
+    CHECK(miotyAtClientCtx_getOrSetTransmitPower(&ctx, &txPower, true) == MIOTYATCLIENT_RETURN_CODE_OK);
+    CHECK(replay.txMismatches == 1 && !miotyAtReplay_done(&replay));
+    miotyAtReplay_close(&replay);
+
+    remove(LOG_PATH);
+}
+
+int main(void) {
+    test_round_trip();
+    return miotyAtTest_report();
+}
@@ -0,0 +1,373 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Recording and replay of the raw AT traffic of a client context
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "miotyAtTrace.h"
+
+#define VARINT_MAX      10
+#define RECORD_HEAD_MAX (1 + 2 * VARINT_MAX)
+
+static uint64_t now_ns(void);
+static uint8_t put_varint(uint8_t * dest, uint64_t value);
+static size_t get_varint(uint8_t const * src, size_t size, size_t pos, uint64_t * value);
+static void trace_append(miotyAtTrace * trace, void const * data, size_t len);
+static void trace_record(miotyAtTrace * trace, uint8_t kind, miotyAtClient_iovec const * iov, uint8_t iovcnt);
+static uint64_t trace_now_us(miotyAtTrace * trace);
+static void trace_write(void * user, uint8_t * data, uint16_t size);
+static void trace_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt);
+static bool trace_read(void * user, uint8_t * buf, uint8_t * len);
+static bool trace_readn(void * user, uint8_t * buf, size_t cap, size_t * len);
+static void trace_rx(miotyAtTrace * trace, bool ok, uint8_t const * buf, size_t len);
+static uint32_t trace_clock(void * user);
+static bool replay_next(miotyAtReplay * replay, uint8_t * kind, uint8_t const ** data, size_t * len);
+static void replay_wait(miotyAtReplay * replay, uint64_t dueUs);
+static void replay_write(void * user, uint8_t * data, uint16_t size);
+static bool replay_read(void * user, uint8_t * buf, uint8_t * len);
+static bool replay_readn(void * user, uint8_t * buf, size_t cap, size_t * len);
+static uint32_t replay_clock(void * user);
+
+
+bool miotyAtTrace_start(miotyAtTrace * trace, miotyAtClient_ctx * ctx, char const * path) {
+    memset(trace, 0, sizeof(*trace));
+    trace->file = fopen(path, "wb");
+    if (trace->file == NULL)
+        return false;
+    trace->ctx = ctx;
+    trace->transport.write = ctx->write;
+    trace->transport.read = ctx->read;
+    trace->transport.writev = ctx->writev;
+    trace->transport.readn = ctx->readn;
+    trace->transport.clock = ctx->clock;
+    trace->transport.user = ctx->user;
+    if (ctx->clock != NULL)
+        trace->lastMs = ctx->clock(ctx->user);
+    else
+        trace->lastUs = now_ns() / 1000;
+
+    trace_append(trace, MIOTYATTRACE_MAGIC, MIOTYATTRACE_HEADER_SIZE - 1);
+    uint8_t version = MIOTYATTRACE_VERSION;
+    trace_append(trace, &version, 1);
+
+    ctx->write = trace_write;
+    ctx->read = trace_read;
+    ctx->writev = ctx->writev != NULL ? trace_writev : NULL;
+    ctx->readn = ctx->readn != NULL ? trace_readn : NULL;
+    ctx->clock = ctx->clock != NULL ? trace_clock : NULL;
+    ctx->user = trace;
+    return true;
+}
+
+void miotyAtTrace_flush(miotyAtTrace * trace) {
+    if (trace->failed || trace->bufLen == 0)
+        return;
+    if (fwrite(trace->buf, 1, trace->bufLen, trace->file) != trace->bufLen)
+        trace->failed = true;
+    trace->bufLen = 0;
+}
+
+void miotyAtTrace_stop(miotyAtTrace * trace) {
+    miotyAtTrace_flush(trace);
+    fclose(trace->file);
+    miotyAtClient_ctx * ctx = trace->ctx;
+    ctx->write = trace->transport.write;
+    ctx->read = trace->transport.read;
+    ctx->writev = trace->transport.writev;
+    ctx->readn = trace->transport.readn;
+    ctx->clock = trace->transport.clock;
+    ctx->user = trace->transport.user;
+}
+
+size_t miotyAtTrace_record(uint8_t const * log, size_t size, size_t pos, uint8_t * kind, uint64_t * dtUs, uint8_t const ** data, size_t * len) {
+    uint64_t length;
+    if (pos >= size)
+        return 0;
+    *kind = log[pos++];
+    pos = get_varint(log, size, pos, dtUs);
+    if (pos == 0)
+        return 0;
+    pos = get_varint(log, size, pos, &length);
+    if (pos == 0 || length > size - pos)
+        return 0;
+    *data = log + pos;
+    *len = length;
+    return pos + length;
+}
+
+bool miotyAtReplay_open(miotyAtReplay * replay, char const * path, double speed) {
+    memset(replay, 0, sizeof(*replay));
+    replay->speed = speed;
+    FILE * file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size >= MIOTYATTRACE_HEADER_SIZE)
+        replay->log = malloc(size);
+    if (replay->log != NULL && fread(replay->log, 1, size, file) == (size_t)size)
+        replay->size = size;
+    fclose(file);
+
+    if (replay->size == 0 || memcmp(replay->log, MIOTYATTRACE_MAGIC, MIOTYATTRACE_HEADER_SIZE - 1) != 0
+            || replay->log[MIOTYATTRACE_HEADER_SIZE - 1] != MIOTYATTRACE_VERSION) {
+        miotyAtReplay_close(replay);
+        return false;
+    }
+    replay->pos = MIOTYATTRACE_HEADER_SIZE;
+    return true;
+}
+
+void miotyAtReplay_bind(miotyAtReplay * replay, miotyAtClient_ctx * ctx) {
+    miotyAtClientCtx_init(ctx, replay_write, replay_read, replay);
+    miotyAtClientCtx_setReadn(ctx, replay_readn);
+    miotyAtClientCtx_setClock(ctx, replay_clock);
+}
+
+bool miotyAtReplay_done(miotyAtReplay const * replay) {
+    return replay->pos >= replay->size && replay->chunkLeft == 0;
+}
+
+void miotyAtReplay_close(miotyAtReplay * replay) {
+    free(replay->log);
+    replay->log = NULL;
+    replay->size = 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint8_t put_varint(uint8_t * dest, uint64_t value) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        dest[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    dest[n++] = (uint8_t)value;
+    return n;
+}
+
+// returns the position after the varint, 0 if it is truncated
+static size_t get_varint(uint8_t const * src, size_t size, size_t pos, uint64_t * value) {
+    *value = 0;
+    for (uint8_t shift = 0; pos < size && shift < 7 * VARINT_MAX; shift += 7) {
+        uint8_t byte = src[pos++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return pos;
+    }
+    return 0;
+}
+
+static void trace_append(miotyAtTrace * trace, void const * data, size_t len) {
+    if (trace->bufLen + len > sizeof(trace->buf))
+        miotyAtTrace_flush(trace);
+    if (trace->failed)
+        return;
+    if (len > sizeof(trace->buf)) {
+        if (fwrite(data, 1, len, trace->file) != len)
+            trace->failed = true;
+        return;
+    }
+    memcpy(trace->buf + trace->bufLen, data, len);
+    trace->bufLen += len;
+}
+
+static void trace_record(miotyAtTrace * trace, uint8_t kind, miotyAtClient_iovec const * iov, uint8_t iovcnt) {
+    if (trace->failed)
+        return;
+    uint64_t nowUs = trace_now_us(trace);
+    size_t len = 0;
+    for (uint8_t i = 0; i < iovcnt; i++)
+        len += iov[i].size;
+
+    uint8_t head[RECORD_HEAD_MAX];
+    uint8_t headLen = 0;
+    head[headLen++] = kind;
+    headLen += put_varint(head + headLen, nowUs - trace->lastUs);
+    headLen += put_varint(head + headLen, len);
+    trace_append(trace, head, headLen);
+    for (uint8_t i = 0; i < iovcnt; i++)
+        trace_append(trace, iov[i].data, iov[i].size);
+    trace->lastUs = nowUs;
+    trace->records++;
+}
+
+// time of the traced context, so that a replay times out where the recording did (also on a simulated clock)
+static uint64_t trace_now_us(miotyAtTrace * trace) {
+    if (trace->transport.clock == NULL)
+        return now_ns() / 1000;
+    uint32_t nowMs = trace->transport.clock(trace->transport.user);
+    uint64_t nowUs = trace->lastUs + (uint64_t)(uint32_t)(nowMs - trace->lastMs) * 1000;
+    trace->lastMs = nowMs;
+    return nowUs;
+}
+
+static void trace_write(void * user, uint8_t * data, uint16_t size) {
+    miotyAtTrace * trace = user;
+    miotyAtClient_iovec iov = { data, size };
+    trace->transport.write(trace->transport.user, data, size);
+    trace_record(trace, MIOTYATTRACE_TX, &iov, 1);
+}
+
+static void trace_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt) {
+    miotyAtTrace * trace = user;
+    trace->transport.writev(trace->transport.user, iov, iovcnt);
+    trace_record(trace, MIOTYATTRACE_TX, iov, iovcnt);
+}
+
+static bool trace_read(void * user, uint8_t * buf, uint8_t * len) {
+    miotyAtTrace * trace = user;
+    bool ok = trace->transport.read(trace->transport.user, buf, len);
+    trace_rx(trace, ok, buf, *len);
+    return ok;
+}
+
+static bool trace_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    miotyAtTrace * trace = user;
+    bool ok = trace->transport.readn(trace->transport.user, buf, cap, len);
+    trace_rx(trace, ok, buf, *len);
+    return ok;
+}
+
+// empty reads are not recorded, polling would flood the log
+static void trace_rx(miotyAtTrace * trace, bool ok, uint8_t const * buf, size_t len) {
+    miotyAtClient_iovec iov = { buf, ok ? len : 0 };
+    if (!ok)
+        trace_record(trace, MIOTYATTRACE_RX_FAILED, &iov, 1);
+    else if (len > 0)
+        trace_record(trace, MIOTYATTRACE_RX, &iov, 1);
+}
+
+static uint32_t trace_clock(void * user) {
+    miotyAtTrace * trace = user;
+    return trace->transport.clock(trace->transport.user);
+}
+
+// consumes the next record, false at the end of the log
+static bool replay_next(miotyAtReplay * replay, uint8_t * kind, uint8_t const ** data, size_t * len) {
+    uint64_t dtUs;
+    size_t next = miotyAtTrace_record(replay->log, replay->size, replay->pos, kind, &dtUs, data, len);
+    if (next == 0) {
+        replay->pos = replay->size;
+        return false;
+    }
+    replay->pos = next;
+    replay->recordUs += dtUs;
+    replay_wait(replay, replay->recordUs);
+    replay->nowUs = replay->recordUs;
+    return true;
+}
+
+// paced replay: sleeps until the recorded time dueUs, scaled by the speed factor, has come
+static void replay_wait(miotyAtReplay * replay, uint64_t dueUs) {
+    if (replay->speed <= 0)
+        return;
+    if (replay->startNs == 0)
+        replay->startNs = now_ns() - (uint64_t)(replay->nowUs * 1000 / replay->speed);
+    uint64_t dueNs = replay->startNs + (uint64_t)(dueUs * 1000 / replay->speed);
+    uint64_t now = now_ns();
+    if (dueNs > now) {
+        struct timespec ts = { (dueNs - now) / 1000000000u, (dueNs - now) % 1000000000u };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// compares the command with the next recorded one, recorded responses before it were never read
+static void replay_write(void * user, uint8_t * data, uint16_t size) {
+    miotyAtReplay * replay = user;
+    uint8_t kind;
+    uint8_t const * rec;
+    size_t len;
+
+    replay->chunkLeft = 0;
+    replay->stalled = false;
+    while (replay_next(replay, &kind, &rec, &len)) {
+        if (kind == MIOTYATTRACE_TX) {
+            if (len != size || memcmp(rec, data, size) != 0)
+                replay->txMismatches++;
+            return;
+        }
+        replay->skippedRx++;
+    }
+    replay->txMismatches++;
+}
+
+static bool replay_read(void * user, uint8_t * buf, uint8_t * len) {
+    size_t n;
+    bool ok = replay_readn(user, buf, *len, &n);
+    *len = n;
+    return ok;
+}
+
+// returns at most one recorded chunk per call
+static bool replay_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    miotyAtReplay * replay = user;
+    uint8_t kind = MIOTYATTRACE_RX;
+
+    if (replay->chunkLeft == 0) {
+        uint8_t const * rec;
+        size_t recLen;
+        uint64_t dtUs;
+        if (miotyAtTrace_record(replay->log, replay->size, replay->pos, &kind, &dtUs, &rec, &recLen) == 0)
+            return false;
+        // no response before the next command, let the clock run up to it once so the client can time out
+        if (kind == MIOTYATTRACE_TX) {
+            if (replay->stalled)
+                return false;
+            replay->stalled = true;
+            replay_wait(replay, replay->recordUs + dtUs);
+            replay->nowUs = replay->recordUs + dtUs;
+            *len = 0;
+            return true;
+        }
+        replay_next(replay, &kind, &rec, &recLen);
+        if (kind == MIOTYATTRACE_RX_FAILED)
+            return false;
+        replay->chunk = rec;
+        replay->chunkLeft = recLen;
+    }
+
+    size_t n = replay->chunkLeft < cap ? replay->chunkLeft : cap;
+    memcpy(buf, replay->chunk, n);
+    replay->chunk += n;
+    replay->chunkLeft -= n;
+    *len = n;
+    return true;
+}
+
+static uint32_t replay_clock(void * user) {
+    return ((miotyAtReplay *)user)->nowUs / 1000;
+}
@@ -0,0 +1,167 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Recording of the raw AT traffic of a client context to a binary log, and replay of such logs
+ *
+ * Host only (stdio, POSIX clocks). miotyAtTrace_start() wraps the hooks a context is currently using and
+ * appends every write and every non-empty read with a microsecond timestamp to the log. Timestamps follow the
+ * clock hook of the context if it has one (in ms steps), the monotonic clock of the host otherwise. Records are collected
+ * in a fixed buffer and written out when it is full, so the overhead per hook call is a copy. If writing the
+ * log fails, recording stops and the client carries on.
+ *
+ * miotyAtReplay_bind() drives a context from a recorded log instead of a modem: reads return the recorded
+ * chunks in their original sizes, either as fast as possible or paced by the recorded timestamps scaled by a
+ * speed factor. Writes are compared with the recorded commands.
+ *
+ * Log format, integers are little endian base-128 varints:
+ *
+ *     "MATRACE" version=1
+ *     record: kind (MIOTYATTRACE_TX/RX/RX_FAILED), time since the previous record in us, length, data
+ */
+
+#ifndef _AT_TRACE_H
+#define _AT_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATTRACE_MAGIC          "MATRACE"
+#define MIOTYATTRACE_VERSION        1
+#define MIOTYATTRACE_HEADER_SIZE    8
+
+#ifndef MIOTYATTRACE_BUF_SIZE
+#define MIOTYATTRACE_BUF_SIZE       8192
+#endif
+
+// record kinds
+#define MIOTYATTRACE_TX             0       // bytes written to the modem
+#define MIOTYATTRACE_RX             1       // bytes returned by one read
+#define MIOTYATTRACE_RX_FAILED      2       // read hook returned false
+
+// hooks of the traced context, restored by miotyAtTrace_stop()
+typedef struct miotyAtTrace_transport {
+    miotyAtClient_writeHook write;
+    miotyAtClient_readHook read;
+    miotyAtClient_writevHook writev;
+    miotyAtClient_readnHook readn;
+    miotyAtClient_clockHook clock;
+    void * user;
+} miotyAtTrace_transport;
+
+typedef struct miotyAtTrace {
+    miotyAtClient_ctx * ctx;
+    miotyAtTrace_transport transport;
+    FILE * file;
+    bool failed;                // writing the log failed, recording stopped
+    uint64_t lastUs;            // time of the previous record
+    uint32_t lastMs;            // clock hook reading at the previous record
+    uint32_t records;
+    size_t bufLen;
+    uint8_t buf[MIOTYATTRACE_BUF_SIZE];
+} miotyAtTrace;
+
+typedef struct miotyAtReplay {
+    uint8_t * log;
+    size_t size;
+    size_t pos;                 // next record
+    double speed;               // 0 replays as fast as possible
+    uint64_t startNs;           // wall clock at the first read, paced replay only
+    uint64_t recordUs;          // recorded time of the last consumed record
+    uint64_t nowUs;             // time shown by the clock hook
+    uint8_t const * chunk;      // rest of the current RX record
+    size_t chunkLeft;
+    bool stalled;               // the last read found no response to return
+    uint32_t txMismatches;      // writes differing from the recorded command
+    uint32_t skippedRx;         // recorded reads the client never asked for
+} miotyAtReplay;
+
+/**
+ * @brief Start recording the traffic of ctx to a new log at path
+ *
+ * ctx must be set up with its transport hooks and must not have a command pending. Its other settings are kept.
+ *
+ * @return false if the file can't be created
+ */
+bool miotyAtTrace_start(miotyAtTrace * trace, miotyAtClient_ctx * ctx, char const * path);
+
+/**
+ * @brief Write out buffered records
+ */
+void miotyAtTrace_flush(miotyAtTrace * trace);
+
+/**
+ * @brief Flush and close the log and give the context its original hooks back
+ */
+void miotyAtTrace_stop(miotyAtTrace * trace);
+
+/**
+ * @brief Load a recorded log
+ *
+ * @param[in]   speed   1 replays with the recorded timing, 10 ten times faster, 0 without any waiting
+ *
+ * @return false if the file can't be read or is no trace log
+ */
+bool miotyAtReplay_open(miotyAtReplay * replay, char const * path, double speed);
+
+/**
+ * @brief Initialize ctx with hooks and clock serving the recorded traffic
+ *
+ * The clock follows the recorded time, so timeouts happen where they happened during recording. Once the log
+ * is used up, or the client waits for a response that wasn't recorded, reads fail.
+ */
+void miotyAtReplay_bind(miotyAtReplay * replay, miotyAtClient_ctx * ctx);
+
+/**
+ * @brief Whether all records were consumed
+ */
+bool miotyAtReplay_done(miotyAtReplay const * replay);
+
+void miotyAtReplay_close(miotyAtReplay * replay);
+
+/**
+ * @brief Decode the record at pos of a log held in memory
+ *
+ * @param[out]  kind    MIOTYATTRACE_TX/RX/RX_FAILED
+ * @param[out]  dtUs    Time since the previous record
+ * @param[out]  data    Points into log
+ * @param[out]  len     Length of data
+ *
+ * @return position of the next record, 0 at the end of the log or on a truncated record
+ */
+size_t miotyAtTrace_record(uint8_t const * log, size_t size, size_t pos, uint8_t * kind, uint64_t * dtUs, uint8_t const ** data, size_t * len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
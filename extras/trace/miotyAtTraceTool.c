@@ -0,0 +1,144 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Inspects trace logs of miotyAtTrace.c and benchmarks the response parser on recorded traffic
+ *
+ * Build on a Linux host from the repository root:
+ *
+ *     gcc -O2 -Isrc -Iextras/trace extras/trace/miotyAtTraceTool.c extras/trace/miotyAtTrace.c \
+ *         src/miotyAtClient.c src/miotyAtParser.c src/miotyAtCommands.c \
+ *         src/data_tools/string_tools.c src/data_tools/char_tools.c -o miotyAtTraceTool
+ *
+ * Usage:
+ *     miotyAtTraceTool dump <log>              one line per record: time in us, direction, escaped data
+ *     miotyAtTraceTool bench <log> [rounds]    feeds every recorded response, in its recorded chunks, to a
+ *                                              parser set up for the preceding command
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "miotyAtTrace.h"
+#include "miotyAtParser.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// table id of the command written in data, MIOTYATCMD_NONE if unknown
+static uint8_t lookup_cmd(uint8_t const * data, size_t len) {
+    for (uint8_t id = 0; id < MIOTYATCMD_COUNT; id++) {
+        miotyAtCmd const * cmd = &miotyAtCmd_table[id];
+        if (len > cmd->nameLen && memcmp(data, cmd->request, cmd->nameLen) == 0
+                && strchr("?=\r", data[cmd->nameLen]) != NULL)
+            return id;
+    }
+    return MIOTYATCMD_NONE;
+}
+
+static int dump(miotyAtReplay * log) {
+    static char const * const kinds[] = { "TX", "RX", "RX_FAILED" };
+    uint64_t timeUs = 0;
+    size_t pos = log->pos;
+    uint8_t kind;
+    uint64_t dtUs;
+    uint8_t const * data;
+    size_t len;
+
+    while ((pos = miotyAtTrace_record(log->log, log->size, pos, &kind, &dtUs, &data, &len)) != 0) {
+        timeUs += dtUs;
+        printf("%12llu %-9s ", (unsigned long long)timeUs, kind <= MIOTYATTRACE_RX_FAILED ? kinds[kind] : "?");
+        for (size_t i = 0; i < len; i++) {
+            if (data[i] >= 0x20 && data[i] < 0x7F && data[i] != '\\')
+                putchar(data[i]);
+            else
+                printf("\\x%02X", data[i]);
+        }
+        putchar('\n');
+    }
+    return 0;
+}
+
+static int bench(miotyAtReplay * log, unsigned rounds) {
+    static uint8_t data[255];
+    miotyAtParser parser;
+    uint64_t total = 0;
+    size_t responses = 0, chunks = 0, bytes = 0;
+
+    for (unsigned round = 0; round < rounds; round++) {
+        size_t pos = log->pos;
+        bool pending = false;
+        uint8_t kind;
+        uint64_t dtUs;
+        uint8_t const * rec;
+        size_t len;
+
+        while ((pos = miotyAtTrace_record(log->log, log->size, pos, &kind, &dtUs, &rec, &len)) != 0) {
+            if (kind == MIOTYATTRACE_TX) {
+                miotyAtParser_init(&parser, lookup_cmd(rec, len), data, sizeof(data));
+                pending = true;
+            } else if (kind == MIOTYATTRACE_RX && pending) {
+                uint64_t start = now_ns();
+                miotyAtParser_feed(&parser, rec, len);
+                total += now_ns() - start;
+                chunks++;
+                bytes += len;
+                if (miotyAtParser_done(&parser)) {
+                    pending = false;
+                    responses++;
+                }
+            }
+        }
+    }
+    if (bytes == 0) {
+        fprintf(stderr, "no responses recorded\n");
+        return 1;
+    }
+    printf("# responses chunks bytes ns ns/response ns/byte MB/s\n");
+    printf("%zu %zu %zu %llu %.1f %.2f %.2f\n", responses, chunks, bytes, (unsigned long long)total,
+            responses ? (double)total / responses : 0.0, (double)total / bytes, bytes * 1e3 / total);
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    static miotyAtReplay log;
+    if (argc < 3 || (strcmp(argv[1], "dump") != 0 && strcmp(argv[1], "bench") != 0)) {
+        fprintf(stderr, "usage: %s dump|bench <log> [rounds]\n", argv[0]);
+        return 2;
+    }
+    if (!miotyAtReplay_open(&log, argv[2], 0)) {
+        fprintf(stderr, "%s: no trace log\n", argv[2]);
+        return 1;
+    }
+    int ret = strcmp(argv[1], "dump") == 0 ? dump(&log) : bench(&log, argc > 3 ? atoi(argv[3]) : 100);
+    miotyAtReplay_close(&log);
+    return ret;
+}
@@ -0,0 +1,164 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file
+ * \version     1.2.0
+ * \brief       Compression of integer time series: delta encoding, zigzag varints and bit packing.
+ */
+
+
+// SOURCE CODE
+// ***** INCLUDES *********************************************************************************
+#include <string.h>
+#include "codec_tools.h"
+
+// number of significant bits of value
+static uint8_t bit_width(uint32_t value) {
+#if defined(__GNUC__)
+    return value != 0 ? 32 - __builtin_clz(value) : 0;
+#else
+    uint8_t width = 0;
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+#endif
+}
+
+uint8_t codec_varint_encode(uint8_t * dest, uint32_t value) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        dest[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    dest[n++] = (uint8_t)value;
+    return n;
+}
+
+uint8_t codec_varint_decode(uint8_t const * src, size_t size, uint32_t * value) {
+    uint32_t result = 0;
+    for (uint8_t n = 0; n < size && n < CODEC_VARINT_MAX; n++) {
+        result |= (uint32_t)(src[n] & 0x7F) << (7 * n);
+        if (!(src[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+void codec_stream_init(codec_stream * stream, int32_t first) {
+    stream->prev = first;
+}
+
+size_t codec_delta_encode(codec_stream * stream, int32_t const * values, uint8_t count, uint8_t * dest, size_t destSize) {
+    // sizes of both encodings, deltas are computed again while writing instead of buffering them
+    int32_t prev = stream->prev;
+    uint32_t all = 0;
+    size_t varintSize = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t zz = codec_zigzag_encode((int32_t)((uint32_t)values[i] - (uint32_t)prev));
+        prev = values[i];
+        all |= zz;
+        varintSize += (bit_width(zz) + 6) / 7 + (zz == 0);
+    }
+    uint8_t width = bit_width(all);
+    size_t packedSize = ((size_t)count * width + 7) / 8;
+    bool packed = packedSize < varintSize;
+    size_t size = CODEC_BLOCK_HEADER + (packed ? packedSize : varintSize);
+    if (size > destSize)
+        return 0;
+
+    dest[0] = packed ? CODEC_BLOCK_PACKED | width : 0;
+    dest[1] = count;
+    uint8_t * out = dest + CODEC_BLOCK_HEADER;
+    uint64_t bits = 0;
+    uint8_t nBits = 0;
+    prev = stream->prev;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t zz = codec_zigzag_encode((int32_t)((uint32_t)values[i] - (uint32_t)prev));
+        prev = values[i];
+        if (!packed) {
+            out += codec_varint_encode(out, zz);
+            continue;
+        }
+        bits |= (uint64_t)zz << nBits;
+        nBits += width;
+        while (nBits >= 8) {
+            *out++ = (uint8_t)bits;
+            bits >>= 8;
+            nBits -= 8;
+        }
+    }
+    if (nBits != 0)
+        *out++ = (uint8_t)bits;
+    stream->prev = prev;
+    return size;
+}
+
+size_t codec_delta_decode(codec_stream * stream, uint8_t const * src, size_t size, int32_t * values, uint8_t valuesSize, uint8_t * count) {
+    if (size < CODEC_BLOCK_HEADER || src[1] > valuesSize)
+        return 0;
+    bool packed = src[0] & CODEC_BLOCK_PACKED;
+    uint8_t width = src[0] & CODEC_BLOCK_WIDTH;
+    uint8_t n = src[1];
+    if ((packed && width > 32) || (!packed && width != 0))
+        return 0;
+
+    int32_t prev = stream->prev;
+    size_t pos = CODEC_BLOCK_HEADER;
+    if (packed) {
+        size_t end = pos + ((size_t)n * width + 7) / 8;
+        if (end > size)
+            return 0;
+        uint64_t const mask = width == 32 ? UINT32_MAX : ((uint64_t)1 << width) - 1;
+        uint64_t bits = 0;
+        uint8_t nBits = 0;
+        for (uint8_t i = 0; i < n; i++) {
+            while (nBits < width) {
+                bits |= (uint64_t)src[pos++] << nBits;
+                nBits += 8;
+            }
+            prev = (int32_t)((uint32_t)prev + (uint32_t)codec_zigzag_decode((uint32_t)(bits & mask)));
+            values[i] = prev;
+            bits >>= width;
+            nBits -= width;
+        }
+        pos = end;
+    } else {
+        for (uint8_t i = 0; i < n; i++) {
+            uint32_t zz;
+            uint8_t len = codec_varint_decode(src + pos, size - pos, &zz);
+            if (len == 0)
+                return 0;
+            pos += len;
+            prev = (int32_t)((uint32_t)prev + (uint32_t)codec_zigzag_decode(zz));
+            values[i] = prev;
+        }
+    }
+    stream->prev = prev;
+    *count = n;
+    return pos;
+}
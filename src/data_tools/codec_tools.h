@@ -0,0 +1,135 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     1.2.0
+ * \brief       Compression of integer time series: delta encoding, zigzag varints and bit packing.
+ *
+ * Values of a stream are encoded in blocks as the difference to the previous value of the stream,
+ * zigzag mapped to unsigned. A block is either a sequence of base-128 varints (little endian, 7 bit
+ * per byte) or the values bit packed with the width of the largest one, whichever is smaller:
+ *
+ *     byte 0  bit 7: CODEC_BLOCK_PACKED, bits 0-5: bit width of the packed values (0: all differences are 0)
+ *     byte 1  number of values
+ *     varints or packed values, LSB first
+ *
+ * Encoder and decoder each keep a codec_stream and must process the same blocks in the same order.
+ * If blocks can get lost on the way, reset both streams e.g. with every uplink.
+ * The decoder only depends on the C standard library, so this file can be built into the backend as well.
+ */
+
+#ifndef CODEC_TOOLS_H_
+#define CODEC_TOOLS_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CODEC_VARINT_MAX        5       // longest varint of a 32 bit value
+#define CODEC_BLOCK_HEADER      2
+#define CODEC_BLOCK_PACKED      0x80
+#define CODEC_BLOCK_WIDTH       0x3F
+// largest encoding of a block of n values
+#define CODEC_BLOCK_MAX(n)      (CODEC_BLOCK_HEADER + (size_t)(n) * 4)
+
+typedef struct codec_stream {
+    int32_t prev;               // last value encoded or decoded
+} codec_stream;
+
+/**
+ * \brief       Maps signed to unsigned integers, small magnitudes to small numbers: 0, -1, 1, -2 -> 0, 1, 2, 3
+ */
+static inline uint32_t codec_zigzag_encode(int32_t const value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * \brief       Inverse of codec_zigzag_encode().
+ */
+static inline int32_t codec_zigzag_decode(uint32_t const value) {
+    return (int32_t)((value >> 1) ^ (uint32_t)-(int32_t)(value & 1));
+}
+
+/**
+ * \brief       Writes value as base-128 varint.
+ *
+ * \param[out]  dest        Memory location with at least CODEC_VARINT_MAX bytes.
+ * \param       value       Value to encode.
+ *
+ * \return      Number of bytes written.
+ */
+uint8_t codec_varint_encode(uint8_t * dest, uint32_t value);
+
+/**
+ * \brief       Reads a base-128 varint.
+ *
+ * \param[in]   src         Encoded data.
+ * \param       size        Number of bytes available in src.
+ * \param[out]  value       Decoded value.
+ *
+ * \return      Number of bytes read, 0 if the varint is truncated or longer than CODEC_VARINT_MAX.
+ */
+uint8_t codec_varint_decode(uint8_t const * src, size_t size, uint32_t * value);
+
+/**
+ * \brief       Starts a stream, the first value of the first block is encoded relative to first.
+ */
+void codec_stream_init(codec_stream * stream, int32_t first);
+
+/**
+ * \brief       Encodes count values as one block relative to the previous value of stream.
+ *
+ * \param       stream      Stream state, updated to the last value.
+ * \param[in]   values      Values to encode.
+ * \param       count       Number of values.
+ * \param[out]  dest        Memory location of the block.
+ * \param       destSize    Size of dest, CODEC_BLOCK_MAX(count) is always enough.
+ *
+ * \return      Size of the block, 0 if it doesn't fit into destSize (stream is unchanged then).
+ */
+size_t codec_delta_encode(codec_stream * stream, int32_t const * values, uint8_t count, uint8_t * dest, size_t destSize);
+
+/**
+ * \brief       Decodes one block written by codec_delta_encode().
+ *
+ * \param       stream      Stream state, updated to the last value.
+ * \param[in]   src         Encoded data starting with the block.
+ * \param       size        Number of bytes available in src.
+ * \param[out]  values      Decoded values.
+ * \param       valuesSize  Capacity of values.
+ * \param[out]  count       Number of decoded values.
+ *
+ * \return      Size of the block, 0 if it is malformed, truncated or has more than valuesSize values (stream is unchanged then).
+ */
+size_t codec_delta_decode(codec_stream * stream, uint8_t const * src, size_t size, int32_t * values, uint8_t valuesSize, uint8_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODEC_TOOLS_H_ */
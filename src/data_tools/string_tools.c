@@ -31,11 +31,43 @@
 // SOURCE CODE
 // ***** INCLUDES *********************************************************************************
 #include <stddef.h>
+#include <string.h>
 #include "string_tools.h"
 #include "char_tools.h"
 
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
 // ***** DEFINES **********************************************************************************
+
+// 512 byte table, left out on 8-bit AVR targets where it would take up RAM
+#if !defined(__AVR__)
+#define STRING_TOOLS_HEX_LUT
+#endif
+
+// 8 characters per step on little endian targets with native 64 bit integers
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && (UINTPTR_MAX > 0xFFFFFFFFu)
+#define STRING_TOOLS_HEX_SWAR
+#endif
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define STRING_TOOLS_HEX_X86
+#endif
+
+#define HEX_INVALID 0xFF
+
 // ***** DECLARATIONS *****************************************************************************
+
+typedef size_t (*hexEncodeKernel)(uint8_t const * src, size_t nBytes, char * dest);
+typedef size_t (*hexDecodeKernel)(unsigned char const * src, size_t nBytes, uint8_t * dest);
+
+typedef struct hexKernelSet {
+    char const * name;
+    hexEncodeKernel encode;
+    hexDecodeKernel decode;
+} hexKernelSet;
+
 // ***** GLOABL VARIABLES *************************************************************************
 // ***** LOCAL VARIABLES **************************************************************************
 
@@ -47,7 +79,40 @@ static uint32_t const pow10Lut[] = {
         1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
 };
 
+#ifdef STRING_TOOLS_HEX_LUT
+#define HEX_PAIR_ROW(h) \
+        h "0", h "1", h "2", h "3", h "4", h "5", h "6", h "7", \
+        h "8", h "9", h "A", h "B", h "C", h "D", h "E", h "F"
+
+// hexPairLut[b] holds the two characters representing byte b
+static char const hexPairLut[256][2] = {
+        HEX_PAIR_ROW("0"), HEX_PAIR_ROW("1"), HEX_PAIR_ROW("2"), HEX_PAIR_ROW("3"),
+        HEX_PAIR_ROW("4"), HEX_PAIR_ROW("5"), HEX_PAIR_ROW("6"), HEX_PAIR_ROW("7"),
+        HEX_PAIR_ROW("8"), HEX_PAIR_ROW("9"), HEX_PAIR_ROW("A"), HEX_PAIR_ROW("B"),
+        HEX_PAIR_ROW("C"), HEX_PAIR_ROW("D"), HEX_PAIR_ROW("E"), HEX_PAIR_ROW("F"),
+};
+#endif
+
+#ifdef STRING_TOOLS_HEX_X86
+// selected once on first use and published with a single pointer store, so concurrent first calls are safe
+static hexKernelSet const * hexKernels = NULL;
+#endif
+
 // ***** PROTOTYPES *******************************************************************************
+
+static uint8_t hex_char2nibble(unsigned char const c);
+static size_t hex_decode_scalar(unsigned char const * src, size_t nBytes, uint8_t * dest, size_t * errorPos);
+#ifdef STRING_TOOLS_HEX_SWAR
+static size_t hex_decode_swar(unsigned char const * src, size_t nBytes, uint8_t * dest);
+#endif
+#ifdef STRING_TOOLS_HEX_X86
+static hexKernelSet const * hex_kernels(void);
+static size_t hex_encode_sse2(uint8_t const * src, size_t nBytes, char * dest);
+static size_t hex_decode_sse2(unsigned char const * src, size_t nBytes, uint8_t * dest);
+static size_t hex_encode_avx2(uint8_t const * src, size_t nBytes, char * dest);
+static size_t hex_decode_avx2(unsigned char const * src, size_t nBytes, uint8_t * dest);
+#endif
+
 // ***** FUNCTIONS ********************************************************************************
 
 char* string_uint2str_la_zt(uint32_t i, char b[]) {
@@ -131,20 +196,210 @@ char * string_byte2hex_zt(uint8_t const b, char dest[3]) {
 }
 
 uint_fast16_t string_byteArray2hex(uint8_t const * byteArray, uint_fast16_t const nBytes, char * dest, uint_fast16_t const destSize) {
+    return string_bytes2hex(byteArray, nBytes, dest, destSize);
+}
+
+uint8_t string_hex2byteArray(unsigned char const * hexString, uint8_t const hexStringLength, uint8_t * dest, uint8_t destSize){
+    return string_hex2bytes(hexString, hexStringLength, dest, destSize, NULL) ? 1 : 0;
+}
+
+size_t string_bytes2hex(uint8_t const * bytes, size_t const nBytes, char * dest, size_t const destSize) {
     if(destSize < 2 * nBytes) { return 0; }
 
-    for(uint_fast16_t i = 0; i < nBytes; i++) {
-        string_byte2hex(byteArray[i], &dest[i*2]);
+    size_t i = 0;
+#ifdef STRING_TOOLS_HEX_X86
+    i = hex_kernels()->encode(bytes, nBytes, dest);
+#endif
+    for(; i < nBytes; i++) {
+#ifdef STRING_TOOLS_HEX_LUT
+        memcpy(&dest[i*2], hexPairLut[bytes[i]], 2);
+#else
+        string_byte2hex(bytes[i], &dest[i*2]);
+#endif
     }
 
     return 2*nBytes;
 }
 
-uint8_t string_hex2byteArray(unsigned char const * hexString, uint8_t const hexStringLength, uint8_t * dest, uint8_t destSize){
-    if(destSize < hexStringLength/2 || hexStringLength&1) { return 0; }
+bool string_hex2bytes(unsigned char const * hexString, size_t const hexStringLength, uint8_t * dest, size_t const destSize, size_t * errorPos) {
+    size_t const nBytes = hexStringLength / 2;
+    if(hexStringLength & 1) {
+        if(errorPos != NULL) { *errorPos = hexStringLength; }
+        return false;
+    }
+    if(destSize < nBytes) {
+        if(errorPos != NULL) { *errorPos = 2 * destSize; }
+        return false;
+    }
+
+    // fast kernels stop in front of the first block containing an invalid character
+    size_t i = 0;
+#ifdef STRING_TOOLS_HEX_X86
+    i = hex_kernels()->decode(hexString, nBytes, dest);
+#endif
+#ifdef STRING_TOOLS_HEX_SWAR
+    i += hex_decode_swar(hexString + 2*i, nBytes - i, dest + i);
+#endif
+    size_t invalid = hex_decode_scalar(hexString + 2*i, nBytes - i, dest + i, errorPos);
+    if(invalid != 0 && errorPos != NULL) { *errorPos += 2*i; }
 
-    for(uint_fast16_t i = 0; i < destSize; i++) {
-        *(dest+i) = char_hex2uint(*(hexString+2*i))<<4 | char_hex2uint(*(hexString+2*i+1));
+    return invalid == 0;
+}
+
+static uint8_t hex_char2nibble(unsigned char const c) {
+    if(c >= '0' && c <= '9') { return c - '0'; }
+    unsigned char const lower = c | 0x20;
+    if(lower >= 'a' && lower <= 'f') { return lower - 'a' + 10; }
+    return HEX_INVALID;
+}
+
+// returns the number of invalid characters found (0 or 1), decoding stops at the first one
+static size_t hex_decode_scalar(unsigned char const * src, size_t nBytes, uint8_t * dest, size_t * errorPos) {
+    for(size_t i = 0; i < nBytes; i++) {
+        uint8_t const hi = hex_char2nibble(src[2*i]);
+        uint8_t const lo = hex_char2nibble(src[2*i+1]);
+        if(hi == HEX_INVALID || lo == HEX_INVALID) {
+            if(errorPos != NULL) { *errorPos = 2*i + (hi == HEX_INVALID ? 0 : 1); }
+            return 1;
+        }
+        dest[i] = (hi << 4) | lo;
     }
-    return 1;
+    return 0;
+}
+
+#ifdef STRING_TOOLS_HEX_SWAR
+/**
+ * \brief       Decodes 8 characters per step, all byte lanes are kept below 0x100 so no carries cross lanes.
+ *
+ * \return      Number of bytes decoded, stops in front of the first word with an invalid character.
+ */
+static size_t hex_decode_swar(unsigned char const * src, size_t nBytes, uint8_t * dest) {
+    uint64_t const ones = 0x0101010101010101ull;
+    uint64_t const high = 0x8080808080808080ull;
+    size_t i = 0;
+
+    for(; i + 4 <= nBytes; i += 4) {
+        uint64_t v;
+        memcpy(&v, src + 2*i, 8);
+        if(v & high) { break; }
+
+        // high bit of a lane is set if the character is in the range
+        uint64_t const lower = v | (0x20 * ones);
+        uint64_t const digit = (v + (0x80 - '0') * ones) & ~(v + (0x80 - '9' - 1) * ones);
+        uint64_t const alpha = (lower + (0x80 - 'a') * ones) & ~(lower + (0x80 - 'f' - 1) * ones);
+        if(((digit | alpha) & high) != high) { break; }
+
+        uint64_t const nibbles = (v & (0x0F * ones)) + ((alpha & high) >> 7) * 9;
+        uint64_t pairs = ((nibbles << 4) | (nibbles >> 8)) & 0x00FF00FF00FF00FFull;
+        pairs = (pairs | (pairs >> 8)) & 0x0000FFFF0000FFFFull;
+        pairs = (pairs | (pairs >> 16)) & 0x00000000FFFFFFFFull;
+        uint32_t const out = (uint32_t)pairs;
+        memcpy(dest + i, &out, 4);
+    }
+    return i;
+}
+#endif
+
+#ifdef STRING_TOOLS_HEX_X86
+static hexKernelSet const hexKernelsSse2 = { "sse2", hex_encode_sse2, hex_decode_sse2 };
+static hexKernelSet const hexKernelsAvx2 = { "avx2", hex_encode_avx2, hex_decode_avx2 };
+
+// racing first calls select the same set, the set itself is constant
+static hexKernelSet const * hex_kernels(void) {
+    hexKernelSet const * kernels = __atomic_load_n(&hexKernels, __ATOMIC_ACQUIRE);
+    if(kernels != NULL) { return kernels; }
+
+    __builtin_cpu_init();
+    kernels = __builtin_cpu_supports("avx2") ? &hexKernelsAvx2 : &hexKernelsSse2;
+    __atomic_store_n(&hexKernels, kernels, __ATOMIC_RELEASE);
+    return kernels;
+}
+
+char const * string_hexKernelName(void) {
+    return hex_kernels()->name;
+}
+
+// 16 nibbles -> 16 characters
+static inline __m128i hex_nibbles2ascii_sse2(__m128i n) {
+    __m128i const letter = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letter);
+}
+
+// 16 characters -> 16 nibbles, valid is set to all ones in every lane holding a hex character
+static inline __m128i hex_ascii2nibbles_sse2(__m128i v, __m128i * valid) {
+    __m128i const lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i const digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i const alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    *valid = _mm_or_si128(digit, alpha);
+    return _mm_add_epi8(_mm_and_si128(v, _mm_set1_epi8(0x0F)), _mm_and_si128(alpha, _mm_set1_epi8(9)));
+}
+
+// pairs of nibbles -> bytes in the low byte of each 16 bit lane
+static inline __m128i hex_pack_nibbles_sse2(__m128i n) {
+    __m128i const pairs = _mm_or_si128(_mm_slli_epi16(n, 4), _mm_srli_epi16(n, 8));
+    return _mm_and_si128(pairs, _mm_set1_epi16(0x00FF));
+}
+
+static size_t hex_encode_sse2(uint8_t const * src, size_t nBytes, char * dest) {
+    size_t i = 0;
+    for(; i + 8 <= nBytes; i += 8) {
+        __m128i const b = _mm_loadl_epi64((__m128i const *)(src + i));
+        __m128i const hi = _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi8(0x0F));
+        __m128i const lo = _mm_and_si128(b, _mm_set1_epi8(0x0F));
+        _mm_storeu_si128((__m128i *)(dest + 2*i), hex_nibbles2ascii_sse2(_mm_unpacklo_epi8(hi, lo)));
+    }
+    return i;
+}
+
+static size_t hex_decode_sse2(unsigned char const * src, size_t nBytes, uint8_t * dest) {
+    size_t i = 0;
+    for(; i + 8 <= nBytes; i += 8) {
+        __m128i valid;
+        __m128i const n = hex_ascii2nibbles_sse2(_mm_loadu_si128((__m128i const *)(src + 2*i)), &valid);
+        if(_mm_movemask_epi8(valid) != 0xFFFF) { break; }
+        _mm_storel_epi64((__m128i *)(dest + i), _mm_packus_epi16(hex_pack_nibbles_sse2(n), _mm_setzero_si128()));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_encode_avx2(uint8_t const * src, size_t nBytes, char * dest) {
+    size_t i = 0;
+    for(; i + 16 <= nBytes; i += 16) {
+        __m128i const b = _mm_loadu_si128((__m128i const *)(src + i));
+        __m128i const hi = _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi8(0x0F));
+        __m128i const lo = _mm_and_si128(b, _mm_set1_epi8(0x0F));
+        __m256i const n = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(hi, lo)), _mm_unpackhi_epi8(hi, lo), 1);
+        __m256i const letter = _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), _mm256_set1_epi8('A' - '0' - 10));
+        _mm256_storeu_si256((__m256i *)(dest + 2*i), _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), letter));
+    }
+    return i + hex_encode_sse2(src + i, nBytes - i, dest + 2*i);
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2(unsigned char const * src, size_t nBytes, uint8_t * dest) {
+    size_t i = 0;
+    for(; i + 16 <= nBytes; i += 16) {
+        __m256i const v = _mm256_loadu_si256((__m256i const *)(src + 2*i));
+        __m256i const lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i const digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        __m256i const alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+        if(_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1) { break; }
+
+        __m256i const n = _mm256_add_epi8(_mm256_and_si256(v, _mm256_set1_epi8(0x0F)), _mm256_and_si256(alpha, _mm256_set1_epi8(9)));
+        __m256i const pairs = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(n, 4), _mm256_srli_epi16(n, 8)), _mm256_set1_epi16(0x00FF));
+        // packus works per 128 bit lane, gather the two 64 bit results
+        __m256i const packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(pairs, _mm256_setzero_si256()), 0x08);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm256_castsi256_si128(packed));
+    }
+    return i + hex_decode_sse2(src + 2*i, nBytes - i, dest + i);
+}
+#else
+char const * string_hexKernelName(void) {
+#ifdef STRING_TOOLS_HEX_SWAR
+    return "swar";
+#else
+    return "scalar";
+#endif
 }
+#endif
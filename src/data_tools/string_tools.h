@@ -31,6 +31,7 @@
 #define LIB_C_MODULES_STRINGS_STRING_TOOLS_H_
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -110,8 +111,47 @@ void string_byte2hex(uint8_t const b, char dest[2]);
  */
 char* string_byte2hex_zt(uint8_t const b, char dest[3]);
 
+/**
+ * \brief       Transforms a hexadecimal ASCII string to a byte array, see string_hex2bytes().
+ *
+ * \return      1 on success, 0 if the string has an odd length, does not fit into dest or contains invalid characters.
+ */
 uint8_t string_hex2byteArray(unsigned char const * hexString, uint8_t const hexStringLength, uint8_t * dest, uint8_t destSize);
 
+/**
+ * \brief       Byte array to hex ascii char array routine (upper case). No NULL termination!
+ *              Uses a byte to character pair table and SSE2/AVX2 kernels on x86-64 Linux.
+ *
+ * \param[in]   bytes       Bytes to convert
+ * \param[in]   nBytes      Number of bytes
+ * \param[out]  dest        Memory location the ascii hex array will be written to.
+ * \param[in]   destSize    Size of dest, has to be at least 2*nBytes
+ *
+ * \return      Number of characters written, 0 if dest is too small.
+ */
+size_t string_bytes2hex(uint8_t const * bytes, size_t const nBytes, char * dest, size_t const destSize);
+
+/**
+ * \brief       Validating hexadecimal ASCII string to byte array routine, most significant nibble first.
+ *              Decodes 8 characters per step (SWAR) and uses SSE2/AVX2 kernels on x86-64 Linux.
+ *
+ * \param[in]   hexString       The string to be transformed, consisting of the characters: 0123456789ABCDEFabcdef
+ * \param[in]   hexStringLength Length of the hexadecimal string, has to be even
+ * \param[out]  dest            Memory location the bytes will be written to
+ * \param[in]   destSize        Size of dest, has to be at least hexStringLength/2
+ * \param[out]  errorPos        Index of the first invalid character if decoding failed, may be NULL
+ *
+ * \return      True, if the whole string was decoded.
+ *              False, if the string has an odd length, does not fit into dest or contains an invalid character.
+ *              dest is filled up to the invalid character.
+ */
+bool string_hex2bytes(unsigned char const * hexString, size_t const hexStringLength, uint8_t * dest, size_t const destSize, size_t * errorPos);
+
+/**
+ * \brief       Name of the hex codec kernels in use ("avx2", "sse2", "swar" or "scalar").
+ */
+char const * string_hexKernelName(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,99 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Aggregation of small sensor readings into packed MPF uplinks
+ */
+
+#include "miotyAtAggregator.h"
+#include "data_tools/codec_tools.h"
+
+
+void miotyAtAggregator_init(miotyAtAggregator * agg, miotyAtClient_ctx * ctx, uint8_t mpf, uint8_t maxPayload, uint32_t maxLatencyMs) {
+    memset(agg, 0, sizeof(*agg));
+    agg->ctx = ctx;
+    agg->mpf = mpf;
+    agg->maxPayload = maxPayload < MIOTYATAGGREGATOR_HEADER_MAX + MIOTYATAGGREGATOR_RECORD_MAX ?
+            MIOTYATAGGREGATOR_HEADER_MAX + MIOTYATAGGREGATOR_RECORD_MAX : maxPayload;
+    agg->maxLatencyMs = maxLatencyMs;
+}
+
+miotyAtClient_returnCode miotyAtAggregator_add(miotyAtAggregator * agg, uint16_t id, int32_t value, uint32_t nowMs) {
+    uint8_t record[MIOTYATAGGREGATOR_RECORD_MAX];
+    uint32_t unit = nowMs / MIOTYATAGGREGATOR_TIME_UNIT_MS;
+    uint8_t len = codec_varint_encode(record, id);
+    len += codec_varint_encode(record + len, agg->count != 0 ? unit - agg->lastUnit : 0);
+    len += codec_varint_encode(record + len, codec_zigzag_encode(value));
+
+    if (agg->count != 0 && MIOTYATAGGREGATOR_HEADER_MAX + agg->len + len > agg->maxPayload) {
+        miotyAtClient_returnCode ret = miotyAtAggregator_flush(agg, nowMs);
+        if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+            return ret;
+        // first reading of the next batch, without time delta
+        return miotyAtAggregator_add(agg, id, value, nowMs);
+    }
+    if (agg->count == 0)
+        agg->firstMs = nowMs;
+    memcpy(agg->payload + MIOTYATAGGREGATOR_HEADER_MAX + agg->len, record, len);
+    agg->len += len;
+    agg->count++;
+    agg->lastUnit = unit;
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+miotyAtClient_returnCode miotyAtAggregator_run(miotyAtAggregator * agg, uint32_t nowMs) {
+    if (miotyAtAggregator_due(agg, nowMs) != 0)
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+    return miotyAtAggregator_flush(agg, nowMs);
+}
+
+uint32_t miotyAtAggregator_due(miotyAtAggregator const * agg, uint32_t nowMs) {
+    if (agg->count == 0)
+        return UINT32_MAX;
+    uint32_t waited = nowMs - agg->firstMs;
+    return waited >= agg->maxLatencyMs ? 0 : agg->maxLatencyMs - waited;
+}
+
+miotyAtClient_returnCode miotyAtAggregator_flush(miotyAtAggregator * agg, uint32_t nowMs) {
+    if (agg->count == 0)
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+    uint8_t age[CODEC_VARINT_MAX];
+    uint8_t ageLen = codec_varint_encode(age, nowMs / MIOTYATAGGREGATOR_TIME_UNIT_MS - agg->lastUnit);
+    uint8_t * payload = agg->payload + MIOTYATAGGREGATOR_HEADER_MAX - 2 - ageLen;
+    payload[0] = agg->mpf;
+    payload[1] = MIOTYATAGGREGATOR_VERSION;
+    memcpy(payload + 2, age, ageLen);
+    uint8_t len = 2 + ageLen + agg->len;
+
+    miotyAtClient_returnCode ret = miotyAtClientCtx_sendMessageUniMPF(agg->ctx, payload, len, NULL);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    agg->uplinks++;
+    agg->readings += agg->count;
+    agg->bytes += len;
+    agg->count = 0;
+    agg->len = 0;
+    return ret;
+}
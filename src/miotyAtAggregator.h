@@ -0,0 +1,119 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Aggregation of small sensor readings into packed MPF uplinks
+ *
+ * Readings (id, time, value) are encoded as they arrive and collected until either the next one would not fit
+ * into maxPayload bytes or the oldest one has waited maxLatencyMs. Then all of them go out in one
+ * AT-UMPF uplink, so the fixed overhead of an uplink is paid once per batch instead of once per reading.
+ * If sending fails, the batch is kept and sent again by the next flush.
+ *
+ * Payload format, varints are little endian base-128, times in units of MIOTYATAGGREGATOR_TIME_UNIT_MS:
+ *
+ *     MPF field (1), as passed to miotyAtAggregator_init()
+ *     version (1)
+ *     varint  age of the newest reading when the uplink was sent
+ *     per reading, oldest first:
+ *         varint  id
+ *         varint  time since the previous reading (0 for the first)
+ *         varint  value, zigzag encoded
+ */
+
+#ifndef _AT_AGGREGATOR_H
+#define _AT_AGGREGATOR_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATAGGREGATOR_VERSION       1
+
+#ifndef MIOTYATAGGREGATOR_TIME_UNIT_MS
+#define MIOTYATAGGREGATOR_TIME_UNIT_MS  1000
+#endif
+
+// longest encoding of one reading: 3 byte id, 5 byte time delta, 5 byte value
+#define MIOTYATAGGREGATOR_RECORD_MAX    13
+// MPF field, version and the longest age
+#define MIOTYATAGGREGATOR_HEADER_MAX    7
+
+typedef struct miotyAtAggregator {
+    miotyAtClient_ctx * ctx;
+    uint8_t mpf;
+    uint8_t maxPayload;
+    uint32_t maxLatencyMs;
+    uint8_t count;              // readings in the batch
+    uint8_t len;                // encoded size of the readings
+    uint32_t firstMs;           // arrival of the oldest reading
+    uint32_t lastUnit;          // time of the newest reading in MIOTYATAGGREGATOR_TIME_UNIT_MS
+    // readings from MIOTYATAGGREGATOR_HEADER_MAX on, the header is written right in front of them at flush
+    uint8_t payload[255];
+    // statistics
+    uint32_t uplinks;
+    uint32_t readings;
+    uint32_t bytes;             // payload bytes sent
+} miotyAtAggregator;
+
+/**
+ * @brief Initialize agg for the modem of ctx
+ *
+ * @param[in]   mpf             MPF field of the uplinks, byte 0 of every AT-UMPF payload
+ * @param[in]   maxPayload      Largest uplink payload, MIOTYATAGGREGATOR_HEADER_MAX + MIOTYATAGGREGATOR_RECORD_MAX to 255
+ * @param[in]   maxLatencyMs    Longest time a reading waits for its uplink
+ */
+void miotyAtAggregator_init(miotyAtAggregator * agg, miotyAtClient_ctx * ctx, uint8_t mpf, uint8_t maxPayload, uint32_t maxLatencyMs);
+
+/**
+ * @brief Add a reading taken at nowMs, sends the collected ones first if it doesn't fit anymore
+ *
+ * @return result of that uplink, the reading is not added if it failed
+ */
+miotyAtClient_returnCode miotyAtAggregator_add(miotyAtAggregator * agg, uint16_t id, int32_t value, uint32_t nowMs);
+
+/**
+ * @brief Send the collected readings if the oldest one reached maxLatencyMs
+ *
+ * @return result of the uplink, MIOTYATCLIENT_RETURN_CODE_OK if none was due
+ */
+miotyAtClient_returnCode miotyAtAggregator_run(miotyAtAggregator * agg, uint32_t nowMs);
+
+/**
+ * @brief ms until the collected readings are due, UINT32_MAX if there are none
+ */
+uint32_t miotyAtAggregator_due(miotyAtAggregator const * agg, uint32_t nowMs);
+
+/**
+ * @brief Send the collected readings now with AT-UMPF (blocking)
+ */
+miotyAtClient_returnCode miotyAtAggregator_flush(miotyAtAggregator * agg, uint32_t nowMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Attach state of a modem with automatic reattach
+ */
+
+#include "miotyAtAttach.h"
+
+static bool needs_attach(miotyAtAttach const * att, miotyAtClient_returnCode ret);
+static miotyAtClient_returnCode reattach(miotyAtAttach * att, uint32_t nowMs);
+
+
+void miotyAtAttach_init(miotyAtAttach * att, miotyAtClient_ctx * ctx, miotyAtAttach_mode mode, uint8_t const * data) {
+    memset(att, 0, sizeof(*att));
+    att->ctx = ctx;
+    att->mode = mode;
+    if (data != NULL)
+        memcpy(att->data, data, sizeof(att->data));
+    att->state = MIOTYATATTACH_UNKNOWN;
+}
+
+miotyAtClient_returnCode miotyAtAttach_attach(miotyAtAttach * att) {
+    uint8_t msta = att->msta;
+    miotyAtClient_returnCode ret = att->mode == MIOTYATATTACH_OTA ? miotyAtClientCtx_macAttach(att->ctx, att->data, &msta)
+            : miotyAtClientCtx_macAttachLocal(att->ctx, &msta);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_MacAlreadyAttached)
+        ret = MIOTYATCLIENT_RETURN_CODE_OK;
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK) {
+        att->state = MIOTYATATTACH_ATTACHED;
+        att->msta = msta;
+        miotyAtBackoff_reset(&att->backoff);
+    }
+    return ret;
+}
+
+miotyAtClient_returnCode miotyAtAttach_detach(miotyAtAttach * att, uint8_t * data, uint8_t sizeData) {
+    uint8_t msta = MIOTYATATTACH_MSTA_DETACHED;
+    miotyAtClient_returnCode ret = att->mode == MIOTYATATTACH_OTA ? miotyAtClientCtx_macDetach(att->ctx, data, sizeData, &msta)
+            : miotyAtClientCtx_macDetachLocal(att->ctx, &msta);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK || ret == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached) {
+        att->state = MIOTYATATTACH_DETACHED;
+        att->msta = msta;
+    }
+    return ret;
+}
+
+miotyAtClient_returnCode miotyAtAttach_send(miotyAtAttach * att, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter, uint32_t nowMs) {
+    uint8_t capData = sizeData != NULL ? *sizeData : 0;
+    miotyAtClient_returnCode ret = miotyAtClientCtx_send(att->ctx, cmd, msg, sizeMsg, data, sizeData, packetCounter);
+    if (!needs_attach(att, ret)) {
+        if (ret == MIOTYATCLIENT_RETURN_CODE_OK)
+            att->state = MIOTYATATTACH_ATTACHED;
+        return ret;
+    }
+
+    att->state = MIOTYATATTACH_DETACHED;
+    att->msta = MIOTYATATTACH_MSTA_DETACHED;
+    if (reattach(att, nowMs) != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    att->replays++;
+    if (sizeData != NULL)
+        *sizeData = capData;
+    return miotyAtClientCtx_send(att->ctx, cmd, msg, sizeMsg, data, sizeData, packetCounter);
+}
+
+// only an over the air attach brings a network key, a local one relies on the key already set
+static bool needs_attach(miotyAtAttach const * att, miotyAtClient_returnCode ret) {
+    if (ret == MIOTYATCLIENT_RETURN_CODE_MacNetworkKeyNotSet)
+        return att->mode == MIOTYATATTACH_OTA;
+    return ret == MIOTYATCLIENT_RETURN_CODE_MacNodeNotAttached;
+}
+
+static miotyAtClient_returnCode reattach(miotyAtAttach * att, uint32_t nowMs) {
+    if (miotyAtBackoff_waiting(&att->backoff, nowMs))
+        return MIOTYATCLIENT_RETURN_CODE_Busy;
+    miotyAtClient_returnCode ret = miotyAtAttach_attach(att);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK) {
+        att->reattaches++;
+        return ret;
+    }
+    att->failedAttaches++;
+    miotyAtBackoff_failed(&att->backoff, nowMs);
+    return ret;
+}
@@ -0,0 +1,111 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Attach state of a modem with automatic reattach
+ *
+ * miotyAtAttach keeps the MAC state reported by attach and detach and sends uplinks optimistically: the happy
+ * path is one command without any status query. If an uplink fails with MacNodeNotAttached (e.g. after the
+ * modem rebooted), or with MacNetworkKeyNotSet in OTA mode, the node is attached again, locally or over the
+ * air, and the uplink is sent once more. In LOCAL mode a missing network key is returned right away, a local
+ * attach can't provide it. Failed attaches are retried with exponential backoff, in between failing
+ * uplinks return their error without another attach.
+ */
+
+#ifndef _AT_ATTACH_H
+#define _AT_ATTACH_H
+
+#include "miotyAtClient.h"
+#include "miotyAtBackoff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATATTACH_MSTA_DETACHED     0
+
+typedef enum miotyAtAttach_mode {
+    MIOTYATATTACH_LOCAL,        // AT-MALO / AT-MDLO with the stored network key
+    MIOTYATATTACH_OTA,          // AT-MAOA / AT-MDOA over the air
+} miotyAtAttach_mode;
+
+typedef enum miotyAtAttach_state {
+    MIOTYATATTACH_UNKNOWN,      // nothing was sent yet
+    MIOTYATATTACH_ATTACHED,
+    MIOTYATATTACH_DETACHED,
+} miotyAtAttach_state;
+
+typedef struct miotyAtAttach {
+    miotyAtClient_ctx * ctx;
+    uint8_t mode;
+    uint8_t data[4];            // data of AT-MAOA
+    uint8_t state;
+    uint8_t msta;               // MAC state of the last attach or detach
+    miotyAtBackoff backoff;     // of failed reattaches
+    // statistics
+    uint32_t reattaches;        // successful attaches after a failed uplink
+    uint32_t failedAttaches;
+    uint32_t replays;           // uplinks sent again after a reattach
+} miotyAtAttach;
+
+/**
+ * @brief Initialize att for the modem of ctx
+ *
+ * @param[in]   mode    MIOTYATATTACH_LOCAL or MIOTYATATTACH_OTA
+ * @param[in]   data    4 bytes of AT-MAOA for MIOTYATATTACH_OTA, may be NULL for MIOTYATATTACH_LOCAL
+ */
+void miotyAtAttach_init(miotyAtAttach * att, miotyAtClient_ctx * ctx, miotyAtAttach_mode mode, uint8_t const * data);
+
+/**
+ * @brief Attach now regardless of the backoff (blocking)
+ *
+ * MacAlreadyAttached counts as success.
+ */
+miotyAtClient_returnCode miotyAtAttach_attach(miotyAtAttach * att);
+
+/**
+ * @brief Detach (blocking), data and sizeData are sent with AT-MDOA in MIOTYATATTACH_OTA mode
+ */
+miotyAtClient_returnCode miotyAtAttach_detach(miotyAtAttach * att, uint8_t * data, uint8_t sizeData);
+
+/**
+ * @brief Send an uplink as miotyAtClientCtx_send(), reattaching and sending it again if the node is not attached
+ *
+ * @return result of the uplink, or of the first attempt if the reattach failed or its backoff didn't elapse yet
+ */
+miotyAtClient_returnCode miotyAtAttach_send(miotyAtAttach * att, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter, uint32_t nowMs);
+
+/**
+ * @brief Attach state as last seen by att
+ */
+static inline miotyAtAttach_state miotyAtAttach_getState(miotyAtAttach const * att) {
+    return (miotyAtAttach_state)att->state;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
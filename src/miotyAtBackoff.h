@@ -0,0 +1,84 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Exponential backoff of failed attempts, shared by miotyAtQueue and miotyAtAttach
+ *
+ * Time is passed in by the caller in ms, wrap around is allowed.
+ */
+
+#ifndef _AT_BACKOFF_H
+#define _AT_BACKOFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// backoff after the first failed attempt, doubled with every further one
+#ifndef MIOTYATBACKOFF_MIN_MS
+#define MIOTYATBACKOFF_MIN_MS       5000
+#endif
+
+#ifndef MIOTYATBACKOFF_MAX_MS
+#define MIOTYATBACKOFF_MAX_MS       3600000
+#endif
+
+typedef struct miotyAtBackoff {
+    uint32_t delayMs;           // 0 after a successful attempt
+    uint32_t nextMs;            // earliest time of the next attempt
+} miotyAtBackoff;
+
+/**
+ * @brief Check if the next attempt has to wait
+ */
+static inline bool miotyAtBackoff_waiting(miotyAtBackoff const * backoff, uint32_t nowMs) {
+    return backoff->delayMs != 0 && (int32_t)(nowMs - backoff->nextMs) < 0;
+}
+
+/**
+ * @brief Record a failed attempt at nowMs, the delay until the next one doubles up to MIOTYATBACKOFF_MAX_MS
+ */
+static inline void miotyAtBackoff_failed(miotyAtBackoff * backoff, uint32_t nowMs) {
+    backoff->delayMs = backoff->delayMs == 0 ? MIOTYATBACKOFF_MIN_MS
+            : backoff->delayMs >= MIOTYATBACKOFF_MAX_MS / 2 ? MIOTYATBACKOFF_MAX_MS : 2 * backoff->delayMs;
+    backoff->nextMs = nowMs + backoff->delayMs;
+}
+
+/**
+ * @brief Record a successful attempt, the next failure starts over at MIOTYATBACKOFF_MIN_MS
+ */
+static inline void miotyAtBackoff_reset(miotyAtBackoff * backoff) {
+    backoff->delayMs = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
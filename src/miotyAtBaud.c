@@ -0,0 +1,147 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Baudrate negotiation between host and MIOTY™ modem
+ */
+
+#include "miotyAtBaud.h"
+
+static uint32_t const defaultRates[] = { MIOTYATCLIENT_BAUD_CANDIDATES };
+
+static miotyAtClient_returnCode probe(miotyAtClient_ctx * ctx, uint32_t * baudrate, uint32_t * rttMs);
+static miotyAtClient_returnCode set_modem_baud(miotyAtClient_ctx * ctx, uint32_t baudrate);
+static bool set_host_baud(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t baudrate);
+static miotyAtClient_returnCode fall_back(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t from, uint32_t to, uint32_t * rttMs);
+
+
+miotyAtClient_returnCode miotyAtClientCtx_negotiateBaudrate(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t const * rates, uint8_t nRates, miotyAtClient_baudReport * report) {
+    miotyAtClient_baudReport localReport;
+    if (report == NULL)
+        report = &localReport;
+    memset(report, 0, sizeof(*report));
+    // without deadlines a step the modem doesn't answer would block forever
+    if (ctx->clock == NULL)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (rates == NULL) {
+        rates = defaultRates;
+        nRates = sizeof(defaultRates) / sizeof(defaultRates[0]);
+    }
+
+    // rate the modem runs at right now
+    uint32_t current = 0;
+    miotyAtClient_returnCode ret = probe(ctx, &current, &report->rttMs);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    report->baudrate = current;
+
+    for (uint8_t i = 0; i < nRates; i++) {
+        uint32_t next = rates[i];
+        if (next <= current)
+            continue;
+        report->steps++;
+
+        // the modem answers at the old rate and switches afterwards, without answer it may have switched anyway
+        miotyAtClient_returnCode rc = set_modem_baud(ctx, next);
+        if (rc == MIOTYATCLIENT_RETURN_CODE_Timeout) {
+            report->fellBack = true;
+            ret = fall_back(ctx, setBaud, next, current, &report->rttMs);
+            break;
+        }
+        if (rc == MIOTYATCLIENT_RETURN_CODE_ATReadFailed) {
+            ret = rc;
+            break;
+        }
+        // refused at the old rate, which still works, so the next candidate may be supported
+        if (rc != MIOTYATCLIENT_RETURN_CODE_OK) {
+            report->refused++;
+            continue;
+        }
+        if (!set_host_baud(ctx, setBaud, next)) {
+            report->fellBack = true;
+            ret = fall_back(ctx, setBaud, next, current, &report->rttMs);
+            break;
+        }
+
+        uint32_t verified = next;
+        uint32_t rttMs = 0;
+        if (probe(ctx, &verified, &rttMs) != MIOTYATCLIENT_RETURN_CODE_OK || verified != next) {
+            report->fellBack = true;
+            ret = fall_back(ctx, setBaud, next, current, &report->rttMs);
+            break;
+        }
+        current = next;
+        report->baudrate = current;
+        report->rttMs = rttMs;
+    }
+    return ret;
+}
+
+miotyAtClient_returnCode miotyAtClient_negotiateBaudrate(miotyAtClient_baudHook setBaud, uint32_t const * rates, uint8_t nRates, miotyAtClient_baudReport * report) {
+    return miotyAtClientCtx_negotiateBaudrate(miotyAtClient_defaultCtx(), setBaud, rates, nRates, report);
+}
+
+// AT+IPR? round trips, *baudrate receives the rate reported by the modem
+static miotyAtClient_returnCode probe(miotyAtClient_ctx * ctx, uint32_t * baudrate, uint32_t * rttMs) {
+    uint32_t start = ctx->clock(ctx->user);
+    for (uint8_t i = 0; i < MIOTYATCLIENT_BAUD_PROBES; i++) {
+        miotyAtClientCtx_setCallTimeout(ctx, MIOTYATCLIENT_BAUD_TIMEOUT_MS);
+        miotyAtClient_returnCode ret = miotyAtClientCtx_getOrSetBaudrate(ctx, baudrate, false);
+        if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+            return ret;
+    }
+    *rttMs = (ctx->clock(ctx->user) - start) / MIOTYATCLIENT_BAUD_PROBES;
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+static miotyAtClient_returnCode set_modem_baud(miotyAtClient_ctx * ctx, uint32_t baudrate) {
+    miotyAtClientCtx_setCallTimeout(ctx, MIOTYATCLIENT_BAUD_TIMEOUT_MS);
+    return miotyAtClientCtx_getOrSetBaudrate(ctx, &baudrate, true);
+}
+
+// bytes received at the old rate are garbage, so a timed out command is not waited for any longer
+static bool set_host_baud(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t baudrate) {
+    bool ok = setBaud(ctx->user, baudrate);
+    miotyAtClientCtx_rxFlushed(ctx);
+    return ok;
+}
+
+// bring host and modem back to the rate "to" after the step to "from" failed
+static miotyAtClient_returnCode fall_back(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t from, uint32_t to, uint32_t * rttMs) {
+    uint32_t verified = to;
+    set_host_baud(ctx, setBaud, to);
+    if (probe(ctx, &verified, rttMs) == MIOTYATCLIENT_RETURN_CODE_OK && verified == to)
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+
+    // the modem switched, tell it to go back over the new rate
+    if (set_host_baud(ctx, setBaud, from))
+        set_modem_baud(ctx, to);
+    set_host_baud(ctx, setBaud, to);
+    verified = to;
+    miotyAtClient_returnCode ret = probe(ctx, &verified, rttMs);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK && verified != to)
+        ret = MIOTYATCLIENT_RETURN_CODE_ERR;
+    return ret;
+}
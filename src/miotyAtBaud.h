@@ -0,0 +1,101 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Baudrate negotiation between host and MIOTY™ modem
+ *
+ * Steps the modem (AT+IPR) and the host UART up through a list of candidate rates. Every step is verified
+ * with AT+IPR? round trips, on failure both sides fall back to the last rate that worked.
+ */
+
+#ifndef _AT_BAUD_H
+#define _AT_BAUD_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// candidate rates used if none are given, in ascending order
+#ifndef MIOTYATCLIENT_BAUD_CANDIDATES
+#define MIOTYATCLIENT_BAUD_CANDIDATES   9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+#endif
+
+// round trips per verification, the reported RTT is their mean
+#ifndef MIOTYATCLIENT_BAUD_PROBES
+#define MIOTYATCLIENT_BAUD_PROBES       4
+#endif
+
+// latency budget of each command during negotiation
+#ifndef MIOTYATCLIENT_BAUD_TIMEOUT_MS
+#define MIOTYATCLIENT_BAUD_TIMEOUT_MS   200
+#endif
+
+/**
+ * @brief Transport hook switching the host UART to baudrate
+ *
+ * Has to wait until all pending output is sent (e.g. tcdrain()) before switching and should discard pending input.
+ *
+ * @return          false if the host does not support baudrate. The modem has already switched at that point,
+ *                  so candidate lists should only hold rates the host supports.
+ */
+typedef bool (*miotyAtClient_baudHook)(void * user, uint32_t baudrate);
+
+typedef struct miotyAtClient_baudReport {
+    uint32_t baudrate;          // rate in use when negotiation ended
+    uint32_t rttMs;             // mean AT+IPR? round trip at that rate
+    uint8_t steps;              // candidates tried
+    uint8_t refused;            // candidates the modem rejected with an error, skipped without falling back
+    bool fellBack;              // a candidate failed and the link went back to the previous rate
+} miotyAtClient_baudReport;
+
+/**
+ * @brief Negotiate the fastest rate the link sustains
+ *
+ * Needs a clock hook on ctx (miotyAtClientCtx_setClock()), otherwise a failed step cannot be detected.
+ *
+ * @param[in,out]   ctx         Context
+ * @param[in]       setBaud     Hook reconfiguring the host UART, called with the user pointer of ctx
+ * @param[in]       rates       Candidate rates in ascending order, NULL for MIOTYATCLIENT_BAUD_CANDIDATES
+ * @param[in]       nRates      Number of rates
+ * @param[out]      report      Achieved rate and round trip time, may be NULL
+ *
+ * @return          MIOTYATCLIENT_RETURN_CODE_OK if the link works at the reported rate,
+ *                  MIOTYATCLIENT_RETURN_CODE_ArgumentOOR without a clock hook on ctx,
+ *                  MIOTYATCLIENT_RETURN_CODE_ATReadFailed if the read hook failed
+ */
+miotyAtClient_returnCode miotyAtClientCtx_negotiateBaudrate(miotyAtClient_ctx * ctx, miotyAtClient_baudHook setBaud, uint32_t const * rates, uint8_t nRates, miotyAtClient_baudReport * report);
+
+/**
+ * @brief miotyAtClientCtx_negotiateBaudrate() on the default context
+ */
+miotyAtClient_returnCode miotyAtClient_negotiateBaudrate(miotyAtClient_baudHook setBaud, uint32_t const * rates, uint8_t nRates, miotyAtClient_baudReport * report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
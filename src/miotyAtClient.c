@@ -27,23 +27,61 @@
  * \brief       Client side of communication with a MIOTY™ module via AT protocol v2.x.x
  */
 
+
 #include "miotyAtClient.h"
+#include "miotyAtParser.h"
+#include "miotyAtCommands.h"
 #include "data_tools/string_tools.h"
 
-static miotyAtClient_returnCode get_info_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * buffer, uint8_t * sizeBuf);
-static miotyAtClient_returnCode set_info_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * data, uint8_t size_data);
-static miotyAtClient_returnCode get_info_int(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * res);
-static miotyAtClient_returnCode set_info_int(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * info);
-static void write_cmd_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * data, uint8_t sizeData);
-static miotyAtClient_returnCode check_ATresponse(char * response_buf);
-static miotyAtClient_returnCode get_data_ATresponse(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * buffer, uint8_t * sizeBuf, char * response_buf);
-static miotyAtClient_returnCode get_int_data_ATresponse(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * res, char * response_buf);
-static void get_MSTA(uint8_t * response_buf, uint8_t * MSTA);
-static miotyAtClient_returnCode checkATresponseMsg(uint32_t * packetCounter);
-static void internalGetPacketCounter(char * response_buf, uint32_t * packetCounter);
-
-
-miotyAtClient_returnCode miotyAtClient_setDefaults(uint8_t * eui64, uint8_t * ipv6, uint8_t * nwKey, uint8_t * shortAdress, uint8_t * appCryptoKey, uint8_t ulProfile, uint8_t ulMode, uint8_t ulSyncBurst, uint8_t appCryptoMode, uint8_t attached1stBoot){
+#define RESPONSE_NONE   0
+#define RESPONSE_INT    1
+#define RESPONSE_BYTES  2
+
+// adds n to a counter of command id, compiled out without MIOTYATCLIENT_STATS
+#ifdef MIOTYATCLIENT_STATS
+#define STATS_ADD(ctx, id, counter, n)      ((ctx)->stats.cmd[id].counter += (n))
+#else
+#define STATS_ADD(ctx, id, counter, n)      ((void)0)
+#endif
+
+static miotyAtClient_returnCode get_info_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf);
+static miotyAtClient_returnCode set_info_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t size_data);
+static miotyAtClient_returnCode get_info_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * res);
+static miotyAtClient_returnCode set_info_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * info);
+static miotyAtClient_returnCode exec_cmd(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * MSTA);
+static miotyAtClient_returnCode send_message(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter, uint8_t * MSTA);
+static miotyAtClient_returnCode send_message_async(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t response, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+static miotyAtClient_returnCode exec_cmd_async(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+static bool cmd_allows(miotyAtCmd_id cmd, uint8_t type, uint8_t op);
+static uint8_t * cache_value(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, bool valid);
+static void cache_store(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, void const * value, uint8_t size, bool ok);
+static void write_cmd_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData);
+static void write_cmd_request(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd);
+static void write_cmd_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t value);
+static uint8_t format_cmd_prefix(uint8_t * dest, miotyAtCmd_id cmd, uint8_t sizeData);
+static miotyAtClient_returnCode begin_ATcmd(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t response, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser);
+static miotyAtClient_returnCode wait_ATresponse(miotyAtClient_ctx * ctx);
+static void wait_drained(miotyAtClient_ctx * ctx);
+static void finish_ATcmd(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode);
+static void mirror_packet_counter(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode);
+static void begin_idle(miotyAtClient_ctx * ctx);
+static miotyAtClient_returnCode get_ATresponse_code(miotyAtParser * parser);
+static void get_MSTA(miotyAtClient_result * result, uint8_t * MSTA);
+static void internalGetPacketCounter(miotyAtClient_result * result, uint32_t * packetCounter);
+#ifdef MIOTYATCLIENT_STATS
+static void stats_finish(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode);
+#endif
+
+
+void miotyAtClientCtx_init(miotyAtClient_ctx * ctx, miotyAtClient_writeHook write, miotyAtClient_readHook read, void * user) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->write = write;
+    ctx->read = read;
+    ctx->user = user;
+    miotyAtParser_init(&ctx->parser, MIOTYATCMD_NONE, NULL, 0);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_setDefaults(miotyAtClient_ctx * ctx, uint8_t * eui64, uint8_t * ipv6, uint8_t * nwKey, uint8_t * shortAdress, uint8_t * appCryptoKey, uint8_t ulProfile, uint8_t ulMode, uint8_t ulSyncBurst, uint8_t appCryptoMode, uint8_t attached1stBoot){
     uint8_t defaults[64] = {0};
     uint32_t validation = 0xbf07a938;
     memcpy((void* )defaults, (void *)&validation, 4);
@@ -57,417 +95,738 @@ miotyAtClient_returnCode miotyAtClient_setDefaults(uint8_t * eui64, uint8_t * ip
     memcpy((void* )defaults+42, (void* )&appCryptoMode, 1);
     memcpy((void* )defaults+43, (void* )&attached1stBoot, 1);
     memcpy((void* )defaults+48, (void* )appCryptoKey, 16);
-    return set_info_bytes("AT-DEF", 6, defaults, 64);
+    return set_info_bytes(ctx, MIOTYATCMD_DEF, defaults, 64);
 }
 
-miotyAtClient_returnCode miotyAtClient_reset(void) {
-    char cmd[7] = "AT-RST\r";
-    miotyAtClientWrite((uint8_t *)cmd, sizeof(cmd));
-    char response_buf[200];
-    return check_ATresponse( response_buf);
+miotyAtClient_returnCode miotyAtClientCtx_reset(miotyAtClient_ctx * ctx) {
+    return exec_cmd(ctx, MIOTYATCMD_RST, NULL);
 }
 
-miotyAtClient_returnCode miotyAtClient_factoryReset(void) {
-    char cmd[4] = "ATZ\r";
-    miotyAtClientWrite((uint8_t *)cmd, sizeof(cmd));
-    char response_buf[200];
-    return check_ATresponse(response_buf);
+miotyAtClient_returnCode miotyAtClientCtx_factoryReset(miotyAtClient_ctx * ctx) {
+    return exec_cmd(ctx, MIOTYATCMD_Z, NULL);
 }
 
-miotyAtClient_returnCode miotyAtClient_setNetworkKey(uint8_t * nwKey) {
-    return set_info_bytes("AT-MNWK", 7, nwKey, 16);
+miotyAtClient_returnCode miotyAtClientCtx_setNetworkKey(miotyAtClient_ctx * ctx, uint8_t * nwKey) {
+    return set_info_bytes(ctx, MIOTYATCMD_MNWK, nwKey, 16);
 }
 
-miotyAtClient_returnCode miotyAtClient_getOrSetIPv6SubnetMask(uint8_t * ipv6, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetIPv6SubnetMask(miotyAtClient_ctx * ctx, uint8_t * ipv6, bool set) {
     if (set)
-        return set_info_bytes("AT-MIP6", 7, ipv6, 8);
+        return set_info_bytes(ctx, MIOTYATCMD_MIP6, ipv6, 8);
     uint8_t size_bytes = 8;
-    return get_info_bytes("AT-MIP6", 7, ipv6, &size_bytes);
+    return get_info_bytes(ctx, MIOTYATCMD_MIP6, ipv6, &size_bytes);
 }
 
-miotyAtClient_returnCode miotyAtClient_getOrSetEui(uint8_t * eui64, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetEui(miotyAtClient_ctx * ctx, uint8_t * eui64, bool set) {
     if (set)
-        return set_info_bytes("AT-MEUI", 7, eui64, 8);
+        return set_info_bytes(ctx, MIOTYATCMD_MEUI, eui64, 8);
     uint8_t size_bytes = 8;
-    return get_info_bytes("AT-MEUI", 7, eui64, &size_bytes);
+    return get_info_bytes(ctx, MIOTYATCMD_MEUI, eui64, &size_bytes);
 }
 
-miotyAtClient_returnCode miotyAtClient_getOrSetShortAdress(uint8_t * shortAdress, bool set){
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetShortAdress(miotyAtClient_ctx * ctx, uint8_t * shortAdress, bool set){
     if (set)
-        return set_info_bytes("AT-MSAD", 7, shortAdress, 2);
+        return set_info_bytes(ctx, MIOTYATCMD_MSAD, shortAdress, 2);
     uint8_t size_bytes = 2;
-    return get_info_bytes("AT-MSAD", 7, shortAdress, &size_bytes);
+    return get_info_bytes(ctx, MIOTYATCMD_MSAD, shortAdress, &size_bytes);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_getPacketCounter(miotyAtClient_ctx * ctx, uint32_t * counter) {
+    miotyAtClient_packetCounter * pct = &ctx->packetCounter;
+    bool verify = pct->verifyMs != 0 && ctx->clock != NULL && ctx->clock(ctx->user) - pct->syncMs >= pct->verifyMs;
+    if (pct->valid && !verify && !ctx->txn.pending) {
+        ctx->callTimeoutMs = 0;
+        *counter = pct->value;
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+    }
+
+    bool known = pct->valid;
+    uint32_t mirror = pct->value;
+    miotyAtClient_returnCode ret = get_info_int(ctx, MIOTYATCMD_MPCT, counter);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK && known && *counter != mirror)
+        pct->mismatches++;
+    return ret;
 }
 
-miotyAtClient_returnCode miotyAtClient_getPacketCounter(uint32_t * counter) {
-    return get_info_int("AT-MPCT", 7, counter);
+void miotyAtClientCtx_setPacketCounterVerify(miotyAtClient_ctx * ctx, uint32_t intervalMs) {
+    ctx->packetCounter.verifyMs = intervalMs;
 }
 
-miotyAtClient_returnCode miotyAtClient_getOrSetBaudrate(uint32_t * baud, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetBaudrate(miotyAtClient_ctx * ctx, uint32_t * baud, bool set) {
     if (set)
-        return set_info_int("AT+IPR", 6, baud);
-    return get_info_int("AT+IPR", 6, baud);
+        return set_info_int(ctx, MIOTYATCMD_IPR, baud);
+    return get_info_int(ctx, MIOTYATCMD_IPR, baud);
 }
 
 
-miotyAtClient_returnCode miotyAtClient_getOrSetTransmitPower(uint32_t * txPower, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetTransmitPower(miotyAtClient_ctx * ctx, uint32_t * txPower, bool set) {
     if (set)
-        return set_info_int("AT-UTPL", 7, txPower);
-    return get_info_int("AT-UTPL", 7, txPower);
+        return set_info_int(ctx, MIOTYATCMD_UTPL, txPower);
+    return get_info_int(ctx, MIOTYATCMD_UTPL, txPower);
 }
 
-miotyAtClient_returnCode miotyAtClient_uplinkMode(uint32_t * ulMode, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_uplinkMode(miotyAtClient_ctx * ctx, uint32_t * ulMode, bool set) {
     if (set)
-        return set_info_int("AT-UM", 5, ulMode);
-    return get_info_int("AT-UM", 5, ulMode);
+        return set_info_int(ctx, MIOTYATCMD_UM, ulMode);
+    return get_info_int(ctx, MIOTYATCMD_UM, ulMode);
 }
 
-miotyAtClient_returnCode miotyAtClient_uplinkSyncBurst(uint32_t * ulSyncBurst, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_uplinkSyncBurst(miotyAtClient_ctx * ctx, uint32_t * ulSyncBurst, bool set) {
     if (set)
-        return set_info_int("AT-US", 5, ulSyncBurst);
-    return get_info_int("AT-US", 5, ulSyncBurst);
+        return set_info_int(ctx, MIOTYATCMD_US, ulSyncBurst);
+    return get_info_int(ctx, MIOTYATCMD_US, ulSyncBurst);
 }
 
-miotyAtClient_returnCode miotyAtClient_uplinkProfile(uint32_t * ulProfile, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_uplinkProfile(miotyAtClient_ctx * ctx, uint32_t * ulProfile, bool set) {
     if (set)
-        return set_info_int("AT-UP", 5, ulProfile);
-    return get_info_int("AT-UP", 5, ulProfile);
+        return set_info_int(ctx, MIOTYATCMD_UP, ulProfile);
+    return get_info_int(ctx, MIOTYATCMD_UP, ulProfile);
 }
 
-miotyAtClient_returnCode miotyAtClient_appCryptoMode(uint32_t * appCryptoMode, bool set) {
+miotyAtClient_returnCode miotyAtClientCtx_appCryptoMode(miotyAtClient_ctx * ctx, uint32_t * appCryptoMode, bool set) {
     if (set)
-        return set_info_int("AT-ACM", 6, appCryptoMode);
-    return get_info_int("AT-ACM", 6, appCryptoMode);
+        return set_info_int(ctx, MIOTYATCMD_ACM, appCryptoMode);
+    return get_info_int(ctx, MIOTYATCMD_ACM, appCryptoMode);
 }
 
-miotyAtClient_returnCode miotyAtClient_setAppCryptoKey(uint8_t * appCryptoKey) {
-    return set_info_bytes("AT-ACK", 6, appCryptoKey, 16);
+miotyAtClient_returnCode miotyAtClientCtx_setAppCryptoKey(miotyAtClient_ctx * ctx, uint8_t * appCryptoKey) {
+    return set_info_bytes(ctx, MIOTYATCMD_ACK, appCryptoKey, 16);
 }
 
-miotyAtClient_returnCode get_info_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * buffer, uint8_t * sizeBuf) {
-    char cmd[sizeCmd+2];
-    strcpy(cmd, AT_cmd);
-    cmd[sizeCmd] = '?';
-    cmd[sizeCmd+1] = '\r';
-    miotyAtClientWrite((uint8_t *)cmd, sizeof(cmd));
-    char response_buf[200];
-    return get_data_ATresponse( AT_cmd, sizeCmd, buffer, sizeBuf, response_buf);
+miotyAtClient_returnCode miotyAtClientCtx_getBytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_BYTES, MIOTYATCMD_OP_GET))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    return get_info_bytes(ctx, cmd, buffer, sizeBuf);
 }
 
-miotyAtClient_returnCode set_info_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * data, uint8_t sizeData) {
-    write_cmd_bytes( AT_cmd, sizeCmd, data, sizeData);
-    char response_buf[200];
-    return check_ATresponse( response_buf);
+miotyAtClient_returnCode miotyAtClientCtx_setBytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_BYTES, MIOTYATCMD_OP_SET))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (miotyAtCmd_table[cmd].size != 0 && sizeData != miotyAtCmd_table[cmd].size)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+    return set_info_bytes(ctx, cmd, data, sizeData);
 }
 
-static void internalGetPacketCounter(char * response_buf, uint32_t * packetCounter){
-    char * pos = strstr(response_buf, "-MPCT:");
-    if( (pos != NULL) && (packetCounter != NULL) ) {
-        *packetCounter = atoi((pos+6));
-    }
+miotyAtClient_returnCode miotyAtClientCtx_getInt(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * value) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_INT, MIOTYATCMD_OP_GET))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    return get_info_int(ctx, cmd, value);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_setInt(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t value) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_INT, MIOTYATCMD_OP_SET))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    return set_info_int(ctx, cmd, &value);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_send(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_BYTES, MIOTYATCMD_OP_SEND))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (miotyAtCmd_table[cmd].size != 0 && sizeMsg != miotyAtCmd_table[cmd].size)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+    return send_message(ctx, cmd, msg, sizeMsg, data, sizeData, packetCounter, NULL);
+}
+
+static bool cmd_allows(miotyAtCmd_id cmd, uint8_t type, uint8_t op) {
+    return cmd < MIOTYATCMD_COUNT && miotyAtCmd_table[cmd].type == type && (miotyAtCmd_table[cmd].ops & op);
 }
 
+miotyAtClient_returnCode get_info_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf) {
+    uint8_t size = miotyAtCmd_table[cmd].size;
+    uint8_t * cached = cache_value(ctx, cmd, true);
+    if (cached != NULL && !ctx->txn.pending) {
+        // served without a command, the budget set for this call must not carry over to the next one
+        ctx->callTimeoutMs = 0;
+        memcpy(buffer, cached, *sizeBuf < size ? *sizeBuf : size);
+        bool fits = *sizeBuf >= size;
+        *sizeBuf = size;
+        return fits ? MIOTYATCLIENT_RETURN_CODE_OK : MIOTYATCLIENT_RETURN_CODE_BufferSizeInsufficient;
+    }
 
-static miotyAtClient_returnCode checkATresponseMsg(uint32_t * packetCounter){
-    char response_buf[200];
-    miotyAtClient_returnCode ret = check_ATresponse( response_buf);
+    wait_drained(ctx);
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, RESPONSE_BYTES, buffer, *sizeBuf, NULL, NULL);
     if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    internalGetPacketCounter(response_buf, packetCounter);
+    write_cmd_request(ctx, cmd);
+    ret = wait_ATresponse(ctx);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK || ret == MIOTYATCLIENT_RETURN_CODE_BufferSizeInsufficient)
+        *sizeBuf = ctx->txn.result.sizeData;
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK && *sizeBuf == size)
+        cache_store(ctx, cmd, buffer, size, true);
+    return ret;
+}
 
+miotyAtClient_returnCode set_info_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData) {
+    miotyAtClient_returnCode ret = send_message(ctx, cmd, data, sizeData, NULL, NULL, NULL, NULL);
+    if (cmd == MIOTYATCMD_DEF && ret != MIOTYATCLIENT_RETURN_CODE_Busy)
+        miotyAtClientCtx_invalidateCache(ctx);
+    else if (ret != MIOTYATCLIENT_RETURN_CODE_Busy)
+        cache_store(ctx, cmd, data, sizeData, ret == MIOTYATCLIENT_RETURN_CODE_OK && sizeData == miotyAtCmd_table[cmd].size);
     return ret;
 }
 
-miotyAtClient_returnCode miotyAtClient_sendMessageUniTransparent(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-TU", 5, msg, sizeMsg);
-    return checkATresponseMsg(packetCounter);
+static void internalGetPacketCounter(miotyAtClient_result * result, uint32_t * packetCounter){
+    if( result->hasPacketCounter && (packetCounter != NULL) ) {
+        *packetCounter = result->packetCounter;
+    }
 }
 
-miotyAtClient_returnCode miotyAtClient_sendMessageUniMPF(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-UMPF", 7, msg, sizeMsg);
-    return checkATresponseMsg(packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniTransparent(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_TU, msg, sizeMsg, NULL, NULL, packetCounter, NULL);
 }
 
-miotyAtClient_returnCode miotyAtClient_sendMessageUni(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-U", 4, msg, sizeMsg);
-    return checkATresponseMsg(packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniMPF(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_UMPF, msg, sizeMsg, NULL, NULL, packetCounter, NULL);
 }
 
-miotyAtClient_returnCode miotyAtClient_sendMessageBidiTransparent(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-TB", 5, msg, sizeMsg);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = get_data_ATresponse( "AT-TB", 5, data, size_data, response_buf);
-    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
-        return ret;
-    internalGetPacketCounter(response_buf, packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUni(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_U, msg, sizeMsg, NULL, NULL, packetCounter, NULL);
+}
 
-    return ret;
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiTransparent(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_TB, msg, sizeMsg, data, size_data, packetCounter, NULL);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiMPF(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_BMPF, msg, sizeMsg, data, size_data, packetCounter, NULL);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidi(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return send_message(ctx, MIOTYATCMD_B, msg, sizeMsg, data, size_data, packetCounter, NULL);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macDetach(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t sizeData, uint8_t * MSTA) {
+    return send_message(ctx, MIOTYATCMD_MDOA, data, sizeData, NULL, NULL, NULL, MSTA);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macAttach(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t * MSTA) {
+    return send_message(ctx, MIOTYATCMD_MAOA, data, 4, NULL, NULL, NULL, MSTA);
 }
 
+miotyAtClient_returnCode get_info_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * res) {
+    uint8_t * cached = cache_value(ctx, cmd, true);
+    if (cached != NULL && !ctx->txn.pending) {
+        ctx->callTimeoutMs = 0;
+        memcpy(res, cached, sizeof(*res));
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+    }
 
-miotyAtClient_returnCode miotyAtClient_sendMessageBidiMPF(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-BMPF", 7, msg, sizeMsg);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = get_data_ATresponse( "AT-BMPF", 7, data, size_data, response_buf);
+    wait_drained(ctx);
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, RESPONSE_INT, NULL, 0, NULL, NULL);
     if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    internalGetPacketCounter(response_buf, packetCounter);
+    write_cmd_request(ctx, cmd);
+    ret = wait_ATresponse(ctx);
+    if (ret == MIOTYATCLIENT_RETURN_CODE_OK && (ctx->txn.fields & MIOTYATPARSER_FIELD_VALUE)) {
+        *res = ctx->txn.result.value;
+        cache_store(ctx, cmd, res, sizeof(*res), true);
+    }
+    return ret;
+}
 
+miotyAtClient_returnCode set_info_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * info) {
+    wait_drained(ctx);
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, RESPONSE_NONE, NULL, 0, NULL, NULL);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    write_cmd_int(ctx, cmd, *info);
+    ret = wait_ATresponse(ctx);
+    cache_store(ctx, cmd, info, sizeof(*info), ret == MIOTYATCLIENT_RETURN_CODE_OK);
     return ret;
 }
 
+miotyAtClient_returnCode miotyAtClientCtx_macAttachLocal(miotyAtClient_ctx * ctx, uint8_t * MSTA) {
+    return exec_cmd(ctx, MIOTYATCMD_MALO, MSTA);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macDetachLocal(miotyAtClient_ctx * ctx, uint8_t * MSTA) {
+    return exec_cmd(ctx, MIOTYATCMD_MDLO, MSTA);
+}
+
+static void get_MSTA(miotyAtClient_result * result, uint8_t * MSTA) {
+    if( result->hasMSTA && (MSTA != NULL) )
+        *MSTA = result->MSTA;
+}
 
-miotyAtClient_returnCode miotyAtClient_sendMessageBidi(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
-    write_cmd_bytes( "AT-B", 4, msg, sizeMsg);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = get_data_ATresponse( "AT-B", 4, data, size_data, response_buf);
+static miotyAtClient_returnCode exec_cmd(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * MSTA) {
+    wait_drained(ctx);
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, RESPONSE_NONE, NULL, 0, NULL, NULL);
     if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    internalGetPacketCounter(response_buf, packetCounter);
+    write_cmd_request(ctx, cmd);
+    ret = wait_ATresponse(ctx);
+    // a reset may have happened even if its response got lost
+    if (cmd == MIOTYATCMD_RST || cmd == MIOTYATCMD_Z)
+        miotyAtClientCtx_invalidateCache(ctx);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    get_MSTA(&ctx->txn.result, MSTA);
 
     return ret;
 }
 
-miotyAtClient_returnCode miotyAtClient_macDetach(uint8_t * data, uint8_t sizeData, uint8_t * MSTA) {
-    write_cmd_bytes( "AT-MDOA", 7, data, sizeData);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = check_ATresponse( response_buf);
-    if ( ret != MIOTYATCLIENT_RETURN_CODE_OK)
+static miotyAtClient_returnCode send_message(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter, uint8_t * MSTA) {
+    uint8_t response = data != NULL ? RESPONSE_BYTES : RESPONSE_NONE;
+    wait_drained(ctx);
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, response, data, data != NULL ? *size_data : 0, NULL, NULL);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    get_MSTA(response_buf, MSTA);
+    write_cmd_bytes(ctx, cmd, msg, sizeMsg);
+    ret = wait_ATresponse(ctx);
+    if (data != NULL && (ret == MIOTYATCLIENT_RETURN_CODE_OK || ret == MIOTYATCLIENT_RETURN_CODE_BufferSizeInsufficient))
+        *size_data = ctx->txn.result.sizeData;
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    internalGetPacketCounter(&ctx->txn.result, packetCounter);
+    get_MSTA(&ctx->txn.result, MSTA);
 
     return ret;
 }
 
-miotyAtClient_returnCode miotyAtClient_macAttach(uint8_t * data, uint8_t * MSTA) {
-    write_cmd_bytes( "AT-MAOA", 7, data, 4);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = check_ATresponse( response_buf);
-    if ( ret != MIOTYATCLIENT_RETURN_CODE_OK)
-        return ret;
-    get_MSTA(response_buf, MSTA);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniTransparentAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_TU, msg, sizeMsg, RESPONSE_NONE, NULL, 0, cb, cbUser, handle);
+}
 
-    return ret;
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniMPFAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_UMPF, msg, sizeMsg, RESPONSE_NONE, NULL, 0, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_U, msg, sizeMsg, RESPONSE_NONE, NULL, 0, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiTransparentAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_TB, msg, sizeMsg, RESPONSE_BYTES, data, sizeData, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiMPFAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_BMPF, msg, sizeMsg, RESPONSE_BYTES, data, sizeData, cb, cbUser, handle);
 }
 
-miotyAtClient_returnCode get_info_int(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * res) {
-    char cmd[sizeCmd+2];
-    strcpy(cmd, AT_cmd);
-    cmd[sizeCmd] = '?';
-    cmd[sizeCmd+1] = '\r';
-    miotyAtClientWrite((uint8_t *)cmd, sizeof(cmd));
-    char response_buf[200];
-    return get_int_data_ATresponse( AT_cmd, sizeCmd, res, response_buf);
-}
-
-miotyAtClient_returnCode set_info_int(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * info) {
-    char buf[12] = {0};
-    uint16_t len_info =  string_uint2str_la_zt(*info, buf) - buf;
-    char cmd[sizeCmd+2+len_info];
-    strcpy(cmd, AT_cmd);
-    cmd[sizeCmd] = '=';
-    strcpy(cmd+sizeCmd+1, buf);
-    cmd[sizeCmd+1+len_info] = '\r';
-    miotyAtClientWrite((uint8_t *)cmd, sizeof(cmd));
-    char response_buf[200];
-    return check_ATresponse( response_buf);
-}
-
-miotyAtClient_returnCode miotyAtClient_macAttachLocal(uint8_t * MSTA) {
-    miotyAtClientWrite("AT-MALO\r", 8);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = check_ATresponse( response_buf);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_B, msg, sizeMsg, RESPONSE_BYTES, data, sizeData, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macAttachAsync(miotyAtClient_ctx * ctx, uint8_t * data, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_MAOA, data, 4, RESPONSE_NONE, NULL, 0, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macDetachAsync(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return send_message_async(ctx, MIOTYATCMD_MDOA, data, sizeData, RESPONSE_NONE, NULL, 0, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macAttachLocalAsync(miotyAtClient_ctx * ctx, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return exec_cmd_async(ctx, MIOTYATCMD_MALO, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_macDetachLocalAsync(miotyAtClient_ctx * ctx, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    return exec_cmd_async(ctx, MIOTYATCMD_MDLO, cb, cbUser, handle);
+}
+
+miotyAtClient_returnCode miotyAtClientCtx_sendAsync(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    if (!cmd_allows(cmd, MIOTYATCMD_TYPE_BYTES, MIOTYATCMD_OP_SEND))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (miotyAtCmd_table[cmd].size != 0 && sizeMsg != miotyAtCmd_table[cmd].size)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+    uint8_t response = data != NULL ? RESPONSE_BYTES : RESPONSE_NONE;
+    return send_message_async(ctx, cmd, msg, sizeMsg, response, data, sizeData, cb, cbUser, handle);
+}
+
+static miotyAtClient_returnCode send_message_async(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t response, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, response, data, sizeData, cb, cbUser);
     if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    get_MSTA(response_buf, MSTA);
-
+    if (handle != NULL)
+        *handle = ctx->txn.result.handle;
+    write_cmd_bytes(ctx, cmd, msg, sizeMsg);
     return ret;
 }
 
-miotyAtClient_returnCode miotyAtClient_macDetachLocal(uint8_t * MSTA) {
-    miotyAtClientWrite("AT-MDLO\r", 8);
-    char response_buf[200];
-    miotyAtClient_returnCode ret = check_ATresponse( response_buf);
+static miotyAtClient_returnCode exec_cmd_async(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle) {
+    miotyAtClient_returnCode ret = begin_ATcmd(ctx, cmd, RESPONSE_NONE, NULL, 0, cb, cbUser);
     if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
         return ret;
-    get_MSTA(response_buf, MSTA);
-
+    if (handle != NULL)
+        *handle = ctx->txn.result.handle;
+    write_cmd_request(ctx, cmd);
     return ret;
 }
 
-static void get_MSTA(uint8_t * response_buf, uint8_t * MSTA) {
-    char * pos = strstr(response_buf, "-MSTA:");
-    if( pos!=NULL )
-        *MSTA = atoi(pos+6);
-}
-
-// \todo check for sizeData>19
-// converts uint8_t data to hexadecimal string representation
-static void write_cmd_bytes(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * data, uint8_t sizeData) {
-    uint8_t digits = (sizeData)>9? 1 : 0;
-    uint8_t const dataStringSize = 2*sizeData;
-    // \todo check malloc
-    char dataString[dataStringSize];
-    string_byteArray2hex(data, sizeData, dataString, dataStringSize);
-    char cmd[sizeCmd+sizeof(dataString)+5+digits];
-    strcpy(cmd, AT_cmd);
-    cmd[sizeCmd] = '=';
-    string_uint2str_la_zt(sizeData, cmd+sizeCmd+1);
-    cmd[sizeCmd+2+digits] = 0x09;
-    strcpy(cmd+sizeCmd+digits+3, dataString);
-    cmd[sizeCmd+dataStringSize+digits+3] = 0x1A;
-    cmd[sizeCmd+dataStringSize+digits+4] = '\r';
-    
-    miotyAtClientWrite((uint8_t *) cmd, sizeof(cmd));
-}
-
-static miotyAtClient_returnCode get_int_data_ATresponse(uint8_t * AT_cmd, uint8_t sizeCmd, uint32_t * res, char * response_buf) {
-    uint8_t pos=0;
-    miotyAtClient_returnCode return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-    while(1) {
-        uint8_t buf[30];
-        uint8_t len = 30;
-        if(miotyAtClientRead(buf, &len) == true) {
-        
-            for (uint8_t i=0; i<len; i++) {
-                if(isalpha(buf[i]))
-                    buf[i] = toupper(buf[i]);
-                response_buf[i+pos] = buf[i];
-            }
-            pos += len;
-            response_buf[pos] = '\0';
-            if (strstr(response_buf, "\r\n0\r\n") || strstr(response_buf, "0\r\n")==response_buf) {
-                return_code = MIOTYATCLIENT_RETURN_CODE_OK;
-                char * pos = strstr(response_buf, AT_cmd+2);
-                char * end_pos = NULL;
-                pos += sizeCmd-1;
-                *res = atoi(pos);
-                break;
-            } else if (strstr(response_buf, "\r\n1\r\n")) {
-                char * err_pos = strstr(response_buf, "-MNFO:");
-                if (err_pos == NULL)
-                    err_pos = strstr(response_buf, "-MERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-                    break;
-                }
-                err_pos += 6;
-                return_code = atoi(err_pos);
-                break;
-            } else if (strstr(response_buf, "\r\n2\r\n")) {
-                char * err_pos = strstr(response_buf, "AT!ERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ATErr;
-                    break;
-                }
-                err_pos += 7;
-                return_code = atoi(err_pos) + 16;
-                break;
-            }
-        } else {
-            return MIOTYATCLIENT_RETURN_CODE_ATReadFailed;
-        }
+bool miotyAtClientCtx_pending(miotyAtClient_ctx * ctx) {
+    return ctx->txn.pending;
+}
+
+void miotyAtClientCtx_abort(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode) {
+    if (ctx->txn.pending)
+        finish_ATcmd(ctx, returnCode);
+    else
+        ctx->txn.draining = false;
+}
+
+bool miotyAtClientCtx_poll(miotyAtClient_ctx * ctx) {
+    if (!ctx->txn.pending && !ctx->txn.draining && ctx->urcCount == 0)
+        return false;
+    size_t len = sizeof(ctx->rxBuf);
+    bool ok;
+    if (ctx->txn.pending)
+        STATS_ADD(ctx, ctx->txn.cmd, reads, 1);
+    if (ctx->readn != NULL) {
+        ok = ctx->readn(ctx->user, ctx->rxBuf, len, &len);
+    } else {
+        uint8_t chunk = len > 0xFF ? 0xFF : len;
+        ok = ctx->read(ctx->user, ctx->rxBuf, &chunk);
+        len = chunk;
+    }
+    if (!ok) {
+        ctx->txn.draining = false;
+        if (ctx->txn.pending)
+            finish_ATcmd(ctx, MIOTYATCLIENT_RETURN_CODE_ATReadFailed);
+        return false;
+    }
+    if (len > 0)
+        miotyAtClientCtx_feed(ctx, ctx->rxBuf, len);
+    return miotyAtClientCtx_checkDeadline(ctx);
+}
+
+bool miotyAtClientCtx_checkDeadline(miotyAtClient_ctx * ctx) {
+    miotyAtClient_txn * txn = &ctx->txn;
+    if ((txn->pending || txn->draining) && txn->hasDeadline && (int32_t)(ctx->clock(ctx->user) - txn->deadline) >= 0) {
+        if (txn->pending)
+            finish_ATcmd(ctx, MIOTYATCLIENT_RETURN_CODE_Timeout);
+        else
+            txn->draining = false;
+    }
+    return txn->pending;
+}
+
+bool miotyAtClientCtx_draining(miotyAtClient_ctx * ctx) {
+    return ctx->txn.draining;
+}
+
+void miotyAtClientCtx_rxFlushed(miotyAtClient_ctx * ctx) {
+    if (ctx->txn.draining) {
+        ctx->txn.draining = false;
+        begin_idle(ctx);
+    }
+}
+
+void miotyAtClientCtx_setClock(miotyAtClient_ctx * ctx, miotyAtClient_clockHook clock) {
+    ctx->clock = clock;
+}
+
+void miotyAtClientCtx_setTimeout(miotyAtClient_ctx * ctx, uint32_t timeoutMs) {
+    ctx->timeoutMs = timeoutMs;
+}
+
+void miotyAtClientCtx_setCallTimeout(miotyAtClient_ctx * ctx, uint32_t timeoutMs) {
+    ctx->callTimeoutMs = timeoutMs;
+}
+
+size_t miotyAtClientCtx_feed(miotyAtClient_ctx * ctx, uint8_t const * buf, size_t len) {
+    size_t used = 0;
+    if (ctx->txn.draining) {
+        // the late response of a timed out command, it must not complete the next one
+        used = miotyAtParser_feed(&ctx->parser, buf, len);
+        if (!miotyAtParser_done(&ctx->parser))
+            return len;
+        ctx->txn.draining = false;
+        ctx->txn.fields = ctx->parser.fields;
+        mirror_packet_counter(ctx, get_ATresponse_code(&ctx->parser));
+        if (ctx->urcCount == 0)
+            return used;
+    } else if (ctx->txn.pending) {
+        used = miotyAtParser_feed(&ctx->parser, buf, len);
+        STATS_ADD(ctx, ctx->txn.cmd, bytesRead, used);
+        if (miotyAtParser_done(&ctx->parser))
+            finish_ATcmd(ctx, get_ATresponse_code(&ctx->parser));
+        // the completion callback may have submitted the next command already
+        if (ctx->txn.pending || ctx->urcCount == 0)
+            return used;
+    } else if (ctx->urcCount == 0) {
+        return len;
     }
-    return return_code;
-}
-
-static miotyAtClient_returnCode get_data_ATresponse(uint8_t * AT_cmd, uint8_t sizeCmd, uint8_t * buffer, uint8_t * sizeBuf, char * response_buf) {
-    uint8_t pos=0;
-    miotyAtClient_returnCode return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-    while(1) {
-        uint8_t buf[30];
-        uint8_t len = 30;
-        if(miotyAtClientRead(buf, &len)) {
-            for (uint8_t i=0; i<len; i++) {
-                if(isalpha(buf[i]))
-                    buf[i] = toupper(buf[i]);
-                response_buf[i+pos] = buf[i];
-            }
-            pos += len;
-            response_buf[pos+1] = '\0';
-            if (strstr(response_buf, "\r\n0\r\n") || strstr(response_buf, "0\r\n")==response_buf) {
-                return_code = MIOTYATCLIENT_RETURN_CODE_OK;
-                char * pos = strstr(response_buf, AT_cmd+2);
-                pos += sizeCmd;
-                pos = *pos!='\t'? pos+1 : pos;
-                pos++;
-                uint8_t * end_pos = strstr(pos, "\032\r"); // \todo better way?
-                uint32_t len_data = (*sizeBuf)*2;
-                if (end_pos != 0){
-                    len_data = (char *)end_pos - pos;
-                    *sizeBuf = len_data/2;
-                }
-                string_hex2byteArray(pos, len_data, buffer, *sizeBuf);
-                break;
-            } else if (strstr(response_buf, "\r\n1\r\n")) {
-                char * err_pos = strstr(response_buf, "-MNFO:");
-                if (err_pos == NULL)
-                    err_pos = strstr(response_buf, "-MERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-                    break;
-                }
-                err_pos += 6;
-                return_code = atoi(err_pos);
-                break;
-            } else if (strstr(response_buf, "\r\n2\r\n")) {
-                char * err_pos = strstr(response_buf, "AT!ERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ATErr;
-                    break;
-                }
-                err_pos += 7;
-                return_code = atoi(err_pos) + 16;
-                break;
-            }
-        } else {
-            return MIOTYATCLIENT_RETURN_CODE_ATReadFailed;
-        }
+    if (!ctx->parser.idle)
+        begin_idle(ctx);
+    miotyAtParser_feed(&ctx->parser, buf + used, len - used);
+    return len;
+}
+
+void miotyAtClientCtx_setUrcTable(miotyAtClient_ctx * ctx, miotyAtParser_urc const * urc, uint8_t count) {
+    ctx->urc = urc;
+    ctx->urcCount = urc != NULL ? count : 0;
+    if (!ctx->txn.pending && !ctx->txn.draining)
+        begin_idle(ctx);
+    else
+        miotyAtParser_setUrc(&ctx->parser, ctx->urc, ctx->urcCount);
+}
+
+void miotyAtClientCtx_enableCache(miotyAtClient_ctx * ctx, bool enable) {
+    ctx->cache.enabled = enable;
+    ctx->cache.valid = 0;
+}
+
+void miotyAtClientCtx_invalidateCache(miotyAtClient_ctx * ctx) {
+    ctx->cache.valid = 0;
+    ctx->packetCounter.valid = false;
+}
+
+// cache entry of cmd, NULL if the cache is disabled, cmd is not cached or (with valid=true) its value is unknown
+static uint8_t * cache_value(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, bool valid) {
+    uint8_t slot = miotyAtCmd_cacheSlot[cmd];
+    if (!ctx->cache.enabled || slot == 0)
+        return NULL;
+    if (valid && !(ctx->cache.valid & (1UL << (slot-1))))
+        return NULL;
+    return ctx->cache.value[slot-1];
+}
+
+// stores the value of cmd if ok, otherwise drops it
+static void cache_store(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, void const * value, uint8_t size, bool ok) {
+    uint8_t * entry = cache_value(ctx, cmd, false);
+    if (entry == NULL)
+        return;
+    uint8_t slot = miotyAtCmd_cacheSlot[cmd];
+    if (ok && size <= MIOTYATCMD_CACHE_VALUE_SIZE) {
+        memcpy(entry, value, size);
+        ctx->cache.valid |= 1UL << (slot-1);
+    } else {
+        ctx->cache.valid &= ~(1UL << (slot-1));
     }
-    return return_code;
-}
-
-static miotyAtClient_returnCode check_ATresponse(char * response_buf) {
-    uint8_t pos=0;
-    miotyAtClient_returnCode return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-    while(1) {
-        uint8_t buf[30];
-        uint8_t len = 30;
-        if(miotyAtClientRead(buf, &len)) {
-            for (uint8_t i=0; i<len; i++) {
-                if(isalpha(buf[i]))
-                    buf[i] = toupper(buf[i]);
-                response_buf[i+pos] = buf[i];
-            }
-            pos += len;
-            response_buf[pos+1] = '\0';
-            if (strstr(response_buf, "\r\n0\r\n") || strstr(response_buf, "0\r\n")==response_buf) {
-                return_code = MIOTYATCLIENT_RETURN_CODE_OK;
-                break;
-            } else if (strstr(response_buf, "\r\n1\r\n")) {
-                char * err_pos = strstr(response_buf, "-MNFO:");
-                if (err_pos == NULL)
-                    err_pos = strstr(response_buf, "-MERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ERR;
-                    break;
-                }
-                err_pos += 6;
-                return_code = atoi(err_pos);
-                break;
-            } else if (strstr(response_buf, "\r\n2\r\n")) {
-                char * err_pos = strstr(response_buf, "AT!ERR:");
-                if (err_pos == NULL) {
-                    return_code = MIOTYATCLIENT_RETURN_CODE_ATErr;
-                    break;
-                }
-                err_pos += 7;
-                return_code = atoi(err_pos) + 16;
-                break;
-            }
-        } else {
-            return MIOTYATCLIENT_RETURN_CODE_ATReadFailed;
-        }
+}
+
+void miotyAtClientCtx_setWritev(miotyAtClient_ctx * ctx, miotyAtClient_writevHook writev) {
+    ctx->writev = writev;
+}
+
+void miotyAtClientCtx_setReadn(miotyAtClient_ctx * ctx, miotyAtClient_readnHook readn) {
+    ctx->readn = readn;
+}
+
+// formats "AT-xxx=<len>\t" to dest, returns its length (at most MIOTYATCLIENT_CMD_PREFIX_SIZE)
+static uint8_t format_cmd_prefix(uint8_t * dest, miotyAtCmd_id cmd, uint8_t sizeData) {
+    uint8_t sizeCmd = miotyAtCmd_table[cmd].nameLen;
+    memcpy(dest, miotyAtCmd_table[cmd].request, sizeCmd);
+    dest[sizeCmd] = '=';
+    uint8_t * pos = (uint8_t *)string_uint2str_la_zt(sizeData, (char *)dest+sizeCmd+1);
+    *pos++ = '\t';
+    return pos - dest;
+}
+
+// formats "AT-xxx=<len>\t<hex>\x1A\r" in one pass, either into the TX buffer or as segments for the writev hook.
+// A payload whose hex does not fit into the TX buffer is written in several calls of the write hook.
+static void write_cmd_bytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData) {
+    static uint8_t const suffix[2] = { 0x1A, '\r' };
+
+    if (ctx->writev != NULL && 2 * (size_t)sizeData <= sizeof(ctx->txBuf)) {
+        uint8_t prefix[MIOTYATCLIENT_CMD_PREFIX_SIZE];
+        miotyAtClient_iovec iov[3];
+        iov[0].data = prefix;
+        iov[0].size = format_cmd_prefix(prefix, cmd, sizeData);
+        iov[1].data = ctx->txBuf;
+        iov[1].size = string_bytes2hex(data, sizeData, (char *)ctx->txBuf, sizeof(ctx->txBuf));
+        iov[2].data = suffix;
+        iov[2].size = sizeof(suffix);
+        ctx->writev(ctx->user, iov, 3);
+        STATS_ADD(ctx, cmd, bytesWritten, iov[0].size + iov[1].size + iov[2].size);
+        return;
+    }
+
+    uint8_t * const end = ctx->txBuf + sizeof(ctx->txBuf);
+    uint8_t * pos = ctx->txBuf;
+    pos += format_cmd_prefix(pos, cmd, sizeData);
+    while (sizeData > 0) {
+        uint8_t n = (end - pos) / 2 < sizeData ? (end - pos) / 2 : sizeData;
+        pos += string_bytes2hex(data, n, (char *)pos, end - pos);
+        data += n;
+        sizeData -= n;
+        if (sizeData == 0 && (size_t)(end - pos) >= sizeof(suffix))
+            break;
+        ctx->write(ctx->user, ctx->txBuf, pos - ctx->txBuf);
+        STATS_ADD(ctx, cmd, bytesWritten, pos - ctx->txBuf);
+        pos = ctx->txBuf;
+    }
+    memcpy(pos, suffix, sizeof(suffix));
+    pos += sizeof(suffix);
+    ctx->write(ctx->user, ctx->txBuf, pos - ctx->txBuf);
+    STATS_ADD(ctx, cmd, bytesWritten, pos - ctx->txBuf);
+}
+
+// precomputed "AT-xxx?\r" or "AT-xxx\r" straight from the command table
+static void write_cmd_request(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd) {
+    ctx->write(ctx->user, (uint8_t *)miotyAtCmd_table[cmd].request, miotyAtCmd_table[cmd].requestLen);
+    STATS_ADD(ctx, cmd, bytesWritten, miotyAtCmd_table[cmd].requestLen);
+}
+
+// "AT-xxx=<value>\r"
+static void write_cmd_int(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t value) {
+    uint8_t sizeCmd = miotyAtCmd_table[cmd].nameLen;
+    memcpy(ctx->txBuf, miotyAtCmd_table[cmd].request, sizeCmd);
+    ctx->txBuf[sizeCmd] = '=';
+    uint8_t * pos = (uint8_t *)string_uint2str_la_zt(value, (char *)ctx->txBuf+sizeCmd+1);
+    *pos++ = '\r';
+    ctx->write(ctx->user, ctx->txBuf, pos - ctx->txBuf);
+    STATS_ADD(ctx, cmd, bytesWritten, pos - ctx->txBuf);
+}
+
+// prepares parser and transaction for the response of the command about to be written
+static miotyAtClient_returnCode begin_ATcmd(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t response, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser) {
+    miotyAtClient_txn * txn = &ctx->txn;
+    if (txn->pending)
+        return MIOTYATCLIENT_RETURN_CODE_Busy;
+    if (txn->draining) {
+        miotyAtClientCtx_checkDeadline(ctx);
+        if (txn->draining)
+            return MIOTYATCLIENT_RETURN_CODE_Busy;
+    }
+
+    miotyAtParser_init(&ctx->parser, response != RESPONSE_NONE ? cmd : MIOTYATCMD_NONE, data, sizeData);
+    miotyAtParser_setUrc(&ctx->parser, ctx->urc, ctx->urcCount);
+
+    memset(&txn->result, 0, sizeof(txn->result));
+    if (++ctx->lastHandle == 0)
+        ++ctx->lastHandle;
+    txn->result.handle = ctx->lastHandle;
+    txn->result.data = data;
+    txn->cmd = cmd;
+    txn->response = response;
+    txn->cb = cb;
+    txn->cbUser = cbUser;
+
+    uint32_t timeoutMs = miotyAtCmd_timeout(&miotyAtCmd_table[cmd]);
+    if (ctx->callTimeoutMs != 0)
+        timeoutMs = ctx->callTimeoutMs;
+    else if (ctx->timeoutMs != 0)
+        timeoutMs = ctx->timeoutMs;
+    ctx->callTimeoutMs = 0;
+    txn->hasDeadline = ctx->clock != NULL;
+    if (txn->hasDeadline)
+        txn->deadline = ctx->clock(ctx->user) + timeoutMs;
+
+    STATS_ADD(ctx, cmd, calls, 1);
+#ifdef MIOTYATCLIENT_STATS
+    if (ctx->clock != NULL)
+        ctx->stats.startMs = ctx->clock(ctx->user);
+#endif
+    txn->pending = true;
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+static miotyAtClient_returnCode wait_ATresponse(miotyAtClient_ctx * ctx) {
+    while (miotyAtClientCtx_poll(ctx));
+    return ctx->txn.result.returnCode;
+}
+
+// blocking calls wait for the late response of a timed out command instead of failing with Busy
+static void wait_drained(miotyAtClient_ctx * ctx) {
+    while (ctx->txn.draining)
+        miotyAtClientCtx_poll(ctx);
+}
+
+static void finish_ATcmd(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode) {
+    miotyAtClient_txn * txn = &ctx->txn;
+    miotyAtParser * parser = &ctx->parser;
+    miotyAtClient_result * result = &txn->result;
+
+    if (returnCode == MIOTYATCLIENT_RETURN_CODE_OK && txn->response == RESPONSE_BYTES) {
+        if (parser->invalidHex)
+            returnCode = MIOTYATCLIENT_RETURN_CODE_ATUnexpectedChar;
+        else if (parser->dataLen > parser->dataCap)
+            returnCode = MIOTYATCLIENT_RETURN_CODE_BufferSizeInsufficient;
+        result->sizeData = parser->dataLen > 0xFF ? 0xFF : parser->dataLen;
     }
-    return return_code;
+    result->returnCode = returnCode;
+    result->hasPacketCounter = (parser->fields & MIOTYATPARSER_FIELD_MPCT) != 0;
+    result->packetCounter = parser->mpct;
+    result->hasMSTA = (parser->fields & MIOTYATPARSER_FIELD_MSTA) != 0;
+    result->MSTA = parser->msta;
+    result->value = parser->value;
+    txn->fields = parser->fields;
+    txn->pending = false;
+    mirror_packet_counter(ctx, returnCode);
+    if (returnCode == MIOTYATCLIENT_RETURN_CODE_Timeout && txn->hasDeadline) {
+        // keep parsing the response for its final result code, without writing into the caller's buffer any more
+        uint32_t drainMs = miotyAtCmd_timeout(&miotyAtCmd_table[txn->cmd]);
+        txn->draining = true;
+        txn->deadline = ctx->clock(ctx->user) + (drainMs > MIOTYATCLIENT_DRAIN_MS ? drainMs : MIOTYATCLIENT_DRAIN_MS);
+        parser->data = NULL;
+        parser->dataCap = 0;
+    }
+#ifdef MIOTYATCLIENT_STATS
+    stats_finish(ctx, returnCode);
+#endif
+
+    if (txn->cb != NULL) {
+        // the callback may already submit the next command, which reuses the transaction
+        miotyAtClient_result copy = *result;
+        txn->cb(ctx, &copy, txn->cbUser);
+    }
+}
+
+// keeps the packet counter mirror in step with what the modem reports and drops it whenever that is in doubt
+static void mirror_packet_counter(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode) {
+    miotyAtClient_packetCounter * pct = &ctx->packetCounter;
+    miotyAtCmd_id cmd = ctx->txn.cmd;
+    bool known = true;
+    if (ctx->txn.fields & MIOTYATPARSER_FIELD_MPCT)
+        pct->value = ctx->parser.mpct;
+    else if (cmd == MIOTYATCMD_MPCT && returnCode == MIOTYATCLIENT_RETURN_CODE_OK && (ctx->txn.fields & MIOTYATPARSER_FIELD_VALUE))
+        pct->value = ctx->parser.value;
+    else
+        known = false;
+
+    if (known) {
+        pct->valid = true;
+        if (ctx->clock != NULL)
+            pct->syncMs = ctx->clock(ctx->user);
+    } else if ((miotyAtCmd_table[cmd].ops & MIOTYATCMD_OP_SEND) || cmd == MIOTYATCMD_RST || cmd == MIOTYATCMD_Z
+            || cmd == MIOTYATCMD_DEF || cmd == MIOTYATCMD_MALO || cmd == MIOTYATCMD_MDLO) {
+        pct->valid = false;
+    }
+}
+
+// parser state in between commands, the result of the last command stays in the transaction
+static void begin_idle(miotyAtClient_ctx * ctx) {
+    miotyAtParser_initIdle(&ctx->parser);
+    miotyAtParser_setUrc(&ctx->parser, ctx->urc, ctx->urcCount);
+}
+
+static miotyAtClient_returnCode get_ATresponse_code(miotyAtParser * parser) {
+    switch (parser->resultCode) {
+    case MIOTYATPARSER_RESULT_OK:
+        return MIOTYATCLIENT_RETURN_CODE_OK;
+    case MIOTYATPARSER_RESULT_MACERR:
+        if (parser->fields & MIOTYATPARSER_FIELD_MNFO)
+            return parser->mnfo;
+        if (parser->fields & MIOTYATPARSER_FIELD_MERR)
+            return parser->merr;
+        return MIOTYATCLIENT_RETURN_CODE_ERR;
+    default:
+        if (parser->fields & MIOTYATPARSER_FIELD_ATERR)
+            return parser->atErr + 16;
+        return MIOTYATCLIENT_RETURN_CODE_ATErr;
+    }
+}
+
+#ifdef MIOTYATCLIENT_STATS
+void miotyAtClientCtx_getStats(miotyAtClient_ctx * ctx, miotyAtClient_stats * snapshot) {
+    memcpy(snapshot, &ctx->stats, sizeof(*snapshot));
+}
+
+void miotyAtClientCtx_resetStats(miotyAtClient_ctx * ctx) {
+    memset(ctx->stats.cmd, 0, sizeof(ctx->stats.cmd));
+}
+
+// latency and return code of the command that just completed
+static void stats_finish(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode) {
+    miotyAtClient_cmdStats * stats = &ctx->stats.cmd[ctx->txn.cmd];
+    stats->returnCodes[returnCode < MIOTYATCLIENT_STATS_RETURN_CODES ? returnCode : MIOTYATCLIENT_STATS_RETURN_CODES-1]++;
+    if (ctx->clock == NULL)
+        return;
+    uint32_t latencyMs = ctx->clock(ctx->user) - ctx->stats.startMs;
+    uint8_t bucket = 0;
+    while (bucket < MIOTYATCLIENT_STATS_LATENCY_BUCKETS-1 && latencyMs >= (1UL << bucket))
+        bucket++;
+    stats->latency[bucket]++;
+    stats->latencyMsSum += latencyMs;
 }
+#endif
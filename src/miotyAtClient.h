@@ -32,6 +32,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include "miotyAtParser.h"
+#include "miotyAtCommands.h"
 
 #ifndef _AT_CLIENT_H
 #define _AT_CLIENT_H
@@ -62,14 +64,272 @@ typedef enum miotyAtClient_returnCode {
     MIOTYATCLIENT_RETURN_CODE_ATCommandNotKnown,
     MIOTYATCLIENT_RETURN_CODE_ATParamOOB, //parameter out of bounds
     MIOTYATCLIENT_RETURN_CODE_ATDataSizeMismatch, // 20
-    MIOTYATCLIENT_RETURN_CODE_ATUnexpectedChar,
+    MIOTYATCLIENT_RETURN_CODE_ATUnexpectedChar, // also reported for a non-hex character in the payload of a response
     MIOTYATCLIENT_RETURN_CODE_ATArgInvalid, // 22
     MIOTYATCLIENT_RETURN_CODE_ATReadFailed,
+    MIOTYATCLIENT_RETURN_CODE_Busy, // 24 not in protocol, another command is still pending on the context
+    MIOTYATCLIENT_RETURN_CODE_Timeout, // not in protocol, no final result code before the deadline
+    MIOTYATCLIENT_RETURN_CODE_StorageFailed, // 26 not in protocol, the storage of an add-on (e.g. miotyAtQueue) failed
 } miotyAtClient_returnCode;
 
+/*
+ * Receive buffer of a context. The read hook is offered at most 255 bytes of it per call,
+ * a readn hook the whole buffer. Linux hosts have a kernel serial driver buffering whole responses,
+ * so the default there is a few KiB, enough for the largest response in one read.
+ */
+#ifndef MIOTYATCLIENT_RX_CHUNK_SIZE
+#if defined(__linux__)
+#define MIOTYATCLIENT_RX_CHUNK_SIZE     4096
+#else
+#define MIOTYATCLIENT_RX_CHUNK_SIZE     30
+#endif
+#endif
+
+// longest "AT-xxxx=<len>\t" in front of a hex payload
+#define MIOTYATCLIENT_CMD_PREFIX_SIZE   12
+
+/*
+ * TX buffer of a context. The default holds a command with the largest payload of 255 byte (524 byte
+ * of RAM per context), on AVR it is smaller and longer payloads are written in several calls.
+ */
+#ifndef MIOTYATCLIENT_TX_BUF_SIZE
+#if defined(__AVR__)
+#define MIOTYATCLIENT_TX_BUF_SIZE       64
+#else
+#define MIOTYATCLIENT_TX_BUF_SIZE       (MIOTYATCLIENT_CMD_PREFIX_SIZE + 2 * 255 + 2)
+#endif
+#endif
+#if MIOTYATCLIENT_TX_BUF_SIZE < 20
+#error "MIOTYATCLIENT_TX_BUF_SIZE must hold at least an integer setter (20 byte)"
+#endif
+
+/*
+ * Default latency budget of each command class in ms, from writing the command to the final result code.
+ * Only enforced if a clock hook is set, see miotyAtClientCtx_setClock().
+ */
+#ifndef MIOTYATCLIENT_TIMEOUT_CONFIG_MS
+#define MIOTYATCLIENT_TIMEOUT_CONFIG_MS     1000    // get/set of parameters, local attach/detach
+#endif
+#ifndef MIOTYATCLIENT_TIMEOUT_RESET_MS
+#define MIOTYATCLIENT_TIMEOUT_RESET_MS      5000    // AT-RST, ATZ
+#endif
+#ifndef MIOTYATCLIENT_TIMEOUT_UPLINK_MS
+#define MIOTYATCLIENT_TIMEOUT_UPLINK_MS     10000   // uni-directional uplinks
+#endif
+#ifndef MIOTYATCLIENT_TIMEOUT_BIDI_MS
+#define MIOTYATCLIENT_TIMEOUT_BIDI_MS       30000   // bi-directional uplinks including the downlink window
+#endif
+#ifndef MIOTYATCLIENT_TIMEOUT_ATTACH_MS
+#define MIOTYATCLIENT_TIMEOUT_ATTACH_MS     30000   // over the air attach/detach
+#endif
+
+/*
+ * Shortest time in ms the late response of a timed out command is waited for before the next command may
+ * be submitted, the default of the command class applies if it is longer
+ */
+#ifndef MIOTYATCLIENT_DRAIN_MS
+#define MIOTYATCLIENT_DRAIN_MS              1000
+#endif
+
+/**
+ * @brief Transport hook writing size bytes of data to the MIOTY™ modem
+ */
+typedef void (*miotyAtClient_writeHook)(void * user, uint8_t * data, uint16_t size);
+
+/**
+ * @brief Transport hook reading at most *len bytes from the MIOTY™ modem into buf, *len is set to the number of bytes read
+ *
+ * @return false if reading failed
+ */
+typedef bool (*miotyAtClient_readHook)(void * user, uint8_t * buf, uint8_t * len);
+
+/**
+ * @brief Optional transport hook reading at most cap bytes from the MIOTY™ modem straight into the receive buffer
+ *
+ * If set, it replaces the read hook. *len is set to the number of bytes read.
+ *
+ * @return false if reading failed
+ */
+typedef bool (*miotyAtClient_readnHook)(void * user, uint8_t * buf, size_t cap, size_t * len);
+
+/**
+ * @brief Segment of a command handed to the writev hook
+ */
+typedef struct miotyAtClient_iovec {
+    uint8_t const * data;
+    uint16_t size;
+} miotyAtClient_iovec;
+
+/**
+ * @brief Optional transport hook writing the segments iov[0..iovcnt-1] to the MIOTY™ modem in order
+ *
+ * If set, commands with a payload are handed over as prefix, hex payload and suffix without joining them first.
+ */
+typedef void (*miotyAtClient_writevHook)(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt);
+
+/**
+ * @brief Clock hook returning a monotonic time in ms, wrap around is allowed
+ */
+typedef uint32_t (*miotyAtClient_clockHook)(void * user);
+
+typedef struct miotyAtClient_ctx miotyAtClient_ctx;
+
+/**
+ * @brief Handle of a command submitted with one of the *Async functions, never 0
+ */
+typedef uint32_t miotyAtClient_handle;
+
+/**
+ * @brief Outcome of a command, passed to the completion callback
+ */
+typedef struct miotyAtClient_result {
+    miotyAtClient_handle handle;
+    miotyAtClient_returnCode returnCode;
+    bool hasPacketCounter;
+    uint32_t packetCounter;     // -MPCT: of the response
+    bool hasMSTA;
+    uint8_t MSTA;               // -MSTA: of the response
+    uint32_t value;             // value of an integer response
+    uint8_t * data;             // buffer passed on submission, holds the downlink data
+    uint8_t sizeData;           // number of bytes received in data
+} miotyAtClient_result;
+
+/**
+ * @brief Callback invoked once a command submitted with one of the *Async functions completed
+ *
+ * The callback may submit the next command on ctx.
+ */
+typedef void (*miotyAtClient_completionCb)(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser);
+
+typedef struct miotyAtClient_txn {
+    bool pending;
+    uint8_t cmd;
+    uint8_t response;
+    uint8_t fields;             // MIOTYATPARSER_FIELD_* of the response
+    bool hasDeadline;
+    uint32_t deadline;          // of the pending command or of draining
+    bool draining;              // a timed out command may still answer, its bytes are swallowed
+    miotyAtClient_completionCb cb;
+    void * cbUser;
+    miotyAtClient_result result;
+} miotyAtClient_txn;
+
+typedef struct miotyAtClient_packetCounter {
+    bool valid;
+    uint32_t value;
+    uint32_t syncMs;            // clock when the modem last reported the value
+    uint32_t verifyMs;          // interval of reads with AT-MPCT, 0: never
+    uint32_t mismatches;        // reads with AT-MPCT that differed from the mirror
+} miotyAtClient_packetCounter;
+
+typedef struct miotyAtClient_cache {
+    bool enabled;
+    uint32_t valid;             // bit per cache slot
+    uint8_t value[MIOTYATCMD_CACHE_SLOTS][MIOTYATCMD_CACHE_VALUE_SIZE];
+} miotyAtClient_cache;
+
+#ifdef MIOTYATCLIENT_STATS
+/*
+ * Latency buckets of the command statistics, bucket n counts latencies below 2^n ms,
+ * the last one everything above.
+ */
+#ifndef MIOTYATCLIENT_STATS_LATENCY_BUCKETS
+#define MIOTYATCLIENT_STATS_LATENCY_BUCKETS     16
+#endif
+// return codes counted individually, higher codes share the last entry
+#define MIOTYATCLIENT_STATS_RETURN_CODES        32
+
+/**
+ * @brief Counters of one AT command, see miotyAtClientCtx_getStats()
+ */
+typedef struct miotyAtClient_cmdStats {
+    uint32_t calls;             // commands submitted to the modem (cache hits and Busy rejections excluded)
+    uint32_t bytesWritten;      // bytes handed to the write/writev hook
+    uint32_t bytesRead;         // response bytes consumed by the parser
+    uint32_t reads;             // calls of the read hook
+    uint32_t latencyMsSum;      // sum of all latencies, requires a clock hook
+    uint32_t latency[MIOTYATCLIENT_STATS_LATENCY_BUCKETS];
+    uint32_t returnCodes[MIOTYATCLIENT_STATS_RETURN_CODES];
+} miotyAtClient_cmdStats;
+
+typedef struct miotyAtClient_stats {
+    uint32_t startMs;           // submission time of the pending command
+    miotyAtClient_cmdStats cmd[MIOTYATCMD_COUNT];
+} miotyAtClient_stats;
+#endif
+
+/**
+ * @brief Client context of one MIOTY™ modem
+ *
+ * Carries the transport hooks, the user pointer passed to them and all buffers and state of
+ * the connection. Several contexts can be used side by side to drive several modems. The
+ * members are internal, use miotyAtClientCtx_init() to set up a context.
+ */
+struct miotyAtClient_ctx {
+    miotyAtClient_writeHook write;
+    miotyAtClient_readHook read;
+    miotyAtClient_writevHook writev;
+    miotyAtClient_readnHook readn;
+    void * user;
+    miotyAtClient_clockHook clock;
+    uint32_t timeoutMs;
+    uint32_t callTimeoutMs;
+    miotyAtParser parser;
+    miotyAtClient_txn txn;
+    miotyAtClient_handle lastHandle;
+    miotyAtClient_cache cache;
+    miotyAtClient_packetCounter packetCounter;
+    miotyAtParser_urc const * urc;
+    uint8_t urcCount;
+#ifdef MIOTYATCLIENT_STATS
+    miotyAtClient_stats stats;
+#endif
+    uint8_t rxBuf[MIOTYATCLIENT_RX_CHUNK_SIZE];
+    uint8_t txBuf[MIOTYATCLIENT_TX_BUF_SIZE];
+};
+
+/*
+ * Transport hooks of the default context, to be implemented by the user if the
+ * miotyAtClient_* functions without context are used.
+ */
 void miotyAtClientWrite(uint8_t *, uint16_t);
 bool miotyAtClientRead(uint8_t *, uint8_t *);
 
+/*
+ * Optional writev hook of the default context, only used if the library is built with MIOTYATCLIENT_DEFAULT_WRITEV.
+ */
+void miotyAtClientWritev(miotyAtClient_iovec const *, uint8_t);
+
+/*
+ * Optional readn hook of the default context, only used if the library is built with MIOTYATCLIENT_DEFAULT_READN.
+ */
+bool miotyAtClientReadn(uint8_t *, size_t, size_t *);
+
+/**
+ * @brief Initialize a client context
+ *
+ * @param[out]  ctx     Context to initialize
+ * @param[in]   write   Hook writing to the modem of this context
+ * @param[in]   read    Hook reading from the modem of this context
+ * @param[in]   user    Pointer passed to the hooks, e.g. the UART handle
+ */
+void miotyAtClientCtx_init(miotyAtClient_ctx * ctx, miotyAtClient_writeHook write, miotyAtClient_readHook read, void * user);
+
+/**
+ * @brief Set the optional writev hook of ctx, NULL writes every command as one buffer
+ */
+void miotyAtClientCtx_setWritev(miotyAtClient_ctx * ctx, miotyAtClient_writevHook writev);
+
+/**
+ * @brief Set the optional readn hook of ctx, NULL reads through the read hook in chunks of at most 255 bytes
+ */
+void miotyAtClientCtx_setReadn(miotyAtClient_ctx * ctx, miotyAtClient_readnHook readn);
+
+/**
+ * @brief Context used by the miotyAtClient_* functions, bound to miotyAtClientWrite() and miotyAtClientRead()
+ */
+miotyAtClient_ctx * miotyAtClient_defaultCtx(void);
+
 
 /**
  * @brief Soft reset of the MIOTY™ modem. Persistent fields shall keep their current value.
@@ -165,7 +425,9 @@ miotyAtClient_returnCode miotyAtClient_getOrSetTransmitPower(uint32_t * txPower,
 miotyAtClient_returnCode miotyAtClient_getOrSetBaudrate(uint32_t * baud, bool set);
 
 /**
- * @brief Send AT command to get the current packet counter (AT-MPCT)
+ * @brief Get the current packet counter
+ *
+ * Served from the packet counter mirror of the context if it is known, otherwise read with AT-MPCT.
  *
  * @param[out]   counter         Pointer to store the packet counter
  *
@@ -223,6 +485,62 @@ miotyAtClient_returnCode miotyAtClient_appCryptoMode(uint32_t * appCyrptoMode, b
  */
 miotyAtClient_returnCode miotyAtClient_setAppCryptoKey(uint8_t * appCryptoKey);
 
+/*!
+ * \brief Read a byte array parameter of the command table (e.g. MIOTYATCMD_MEUI)
+ *
+ * \param[in]       cmd             Command with value type MIOTYATCMD_TYPE_BYTES that allows MIOTYATCMD_OP_GET
+ * \param[out]      buffer          Buffer receiving the value
+ * \param[in,out]   sizeBuf         Size of buffer, returns the size of the value
+ *
+ * \return          miotyAtClient_returnCode    indicating success/error of AT_cmd execution, ArgumentOOR if cmd does not allow this
+ */
+miotyAtClient_returnCode miotyAtClient_getBytes(miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf);
+
+/*!
+ * \brief Write a byte array parameter of the command table
+ *
+ * \param[in]       cmd             Command with value type MIOTYATCMD_TYPE_BYTES that allows MIOTYATCMD_OP_SET
+ * \param[in]       data            Value
+ * \param[in]       sizeData        Size of data, must match the fixed size of cmd if it has one
+ *
+ * \return          miotyAtClient_returnCode    indicating success/error of AT_cmd execution, ArgumentOOR if cmd does not allow this
+ */
+miotyAtClient_returnCode miotyAtClient_setBytes(miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData);
+
+/*!
+ * \brief Read an integer parameter of the command table (e.g. MIOTYATCMD_UTPL)
+ *
+ * \param[in]       cmd             Command with value type MIOTYATCMD_TYPE_INT that allows MIOTYATCMD_OP_GET
+ * \param[out]      value           Value
+ *
+ * \return          miotyAtClient_returnCode    indicating success/error of AT_cmd execution, ArgumentOOR if cmd does not allow this
+ */
+miotyAtClient_returnCode miotyAtClient_getInt(miotyAtCmd_id cmd, uint32_t * value);
+
+/*!
+ * \brief Write an integer parameter of the command table
+ *
+ * \param[in]       cmd             Command with value type MIOTYATCMD_TYPE_INT that allows MIOTYATCMD_OP_SET
+ * \param[in]       value           Value
+ *
+ * \return          miotyAtClient_returnCode    indicating success/error of AT_cmd execution, ArgumentOOR if cmd does not allow this
+ */
+miotyAtClient_returnCode miotyAtClient_setInt(miotyAtCmd_id cmd, uint32_t value);
+
+/*!
+ * \brief Send a message with an uplink command of the command table (e.g. MIOTYATCMD_UMPF)
+ *
+ * \param[in]       cmd             Command that allows MIOTYATCMD_OP_SEND
+ * \param[in]       msg             Payload
+ * \param[in]       sizeMsg         Size of msg
+ * \param[out]      data            Buffer for the downlink of bi-directional commands, NULL if none is expected
+ * \param[in,out]   sizeData        Size of data, returns the size of the downlink
+ * \param[out]      packetCounter   Packet counter of the uplink, may be NULL
+ *
+ * \return          miotyAtClient_returnCode    indicating success/error of AT_cmd execution, ArgumentOOR if cmd does not allow this
+ */
+miotyAtClient_returnCode miotyAtClient_send(miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter);
+
 /*!
  * \brief Send uni-directional message (AT-UMPF)
  *
@@ -334,6 +652,234 @@ miotyAtClient_returnCode miotyAtClient_macAttachLocal(uint8_t * MSTA);
  */
 miotyAtClient_returnCode miotyAtClient_macDetachLocal(uint8_t * MSTA);
 
+
+/*
+ * Context variants of the functions above, operating on the modem behind ctx.
+ */
+miotyAtClient_returnCode miotyAtClientCtx_reset(miotyAtClient_ctx * ctx);
+miotyAtClient_returnCode miotyAtClientCtx_factoryReset(miotyAtClient_ctx * ctx);
+miotyAtClient_returnCode miotyAtClientCtx_setDefaults(miotyAtClient_ctx * ctx, uint8_t * eui64, uint8_t * ipv6, uint8_t * nwKey, uint8_t * shortAdress, uint8_t * appCryptoKey, uint8_t ulProfile, uint8_t ulMode, uint8_t ulSyncBurst, uint8_t appCryptoMode, uint8_t attached1stBoot);
+miotyAtClient_returnCode miotyAtClientCtx_setNetworkKey(miotyAtClient_ctx * ctx, uint8_t * nwKey);
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetIPv6SubnetMask(miotyAtClient_ctx * ctx, uint8_t * ipv6, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetEui(miotyAtClient_ctx * ctx, uint8_t * eui64, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetShortAdress(miotyAtClient_ctx * ctx, uint8_t * shortAdress, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetTransmitPower(miotyAtClient_ctx * ctx, uint32_t * txPower, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_getOrSetBaudrate(miotyAtClient_ctx * ctx, uint32_t * baud, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_getPacketCounter(miotyAtClient_ctx * ctx, uint32_t * counter);
+miotyAtClient_returnCode miotyAtClientCtx_uplinkMode(miotyAtClient_ctx * ctx, uint32_t * ulMode, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_uplinkSyncBurst(miotyAtClient_ctx * ctx, uint32_t * ulSyncBurst, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_uplinkProfile(miotyAtClient_ctx * ctx, uint32_t * ulProfile, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_appCryptoMode(miotyAtClient_ctx * ctx, uint32_t * appCyrptoMode, bool set);
+miotyAtClient_returnCode miotyAtClientCtx_setAppCryptoKey(miotyAtClient_ctx * ctx, uint8_t * appCryptoKey);
+miotyAtClient_returnCode miotyAtClientCtx_getBytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf);
+miotyAtClient_returnCode miotyAtClientCtx_setBytes(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData);
+miotyAtClient_returnCode miotyAtClientCtx_getInt(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t * value);
+miotyAtClient_returnCode miotyAtClientCtx_setInt(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint32_t value);
+miotyAtClient_returnCode miotyAtClientCtx_send(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniMPF(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUni(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiMPF(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidi(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniTransparent(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiTransparent(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter);
+miotyAtClient_returnCode miotyAtClientCtx_macAttach(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t * MSTA);
+miotyAtClient_returnCode miotyAtClientCtx_macDetach(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t sizeData, uint8_t * MSTA);
+miotyAtClient_returnCode miotyAtClientCtx_macAttachLocal(miotyAtClient_ctx * ctx, uint8_t * MSTA);
+miotyAtClient_returnCode miotyAtClientCtx_macDetachLocal(miotyAtClient_ctx * ctx, uint8_t * MSTA);
+
+/*
+ * Asynchronous API
+ *
+ * The *Async functions write the command and return right away with MIOTYATCLIENT_RETURN_CODE_OK and a
+ * handle, or with MIOTYATCLIENT_RETURN_CODE_Busy if a command is still pending on ctx or ctx is draining
+ * the late response of a timed out command (see Deadlines). The response is
+ * processed by miotyAtClientCtx_poll() or by handing received bytes to miotyAtClientCtx_feed(), the
+ * completion callback is invoked from there. For polling, the read hook must not block and report
+ * success with *len=0 if no data is available.
+ *
+ * Bi-directional variants take the size of data as value, the number of received bytes is reported in
+ * miotyAtClient_result.sizeData.
+ */
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniMPFAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageUniTransparentAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiMPFAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_sendMessageBidiTransparentAsync(miotyAtClient_ctx * ctx, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_macAttachAsync(miotyAtClient_ctx * ctx, uint8_t * data, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_macDetachAsync(miotyAtClient_ctx * ctx, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_macAttachLocalAsync(miotyAtClient_ctx * ctx, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+miotyAtClient_returnCode miotyAtClientCtx_macDetachLocalAsync(miotyAtClient_ctx * ctx, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+
+/**
+ * @brief Send msg with any command of MIOTYATCMD_TABLE allowing MIOTYATCMD_OP_SEND, e.g. MIOTYATCMD_B
+ *
+ * For layers choosing the uplink type at runtime. data receives the downlink of bi-directional commands,
+ * NULL if none is expected.
+ *
+ * @return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR if cmd can't send messages, otherwise as the other *Async functions
+ */
+miotyAtClient_returnCode miotyAtClientCtx_sendAsync(miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t sizeData, miotyAtClient_completionCb cb, void * cbUser, miotyAtClient_handle * handle);
+
+/**
+ * @brief Read once from the modem and process the received bytes
+ *
+ * Without a pending command, it only reads if a URC table is set.
+ *
+ * @param[in,out]   ctx     Context
+ *
+ * @return          true while a command is still pending on ctx
+ */
+bool miotyAtClientCtx_poll(miotyAtClient_ctx * ctx);
+
+/**
+ * @brief Process bytes received from the modem, alternative to miotyAtClientCtx_poll() for event driven transports
+ *
+ * @param[in,out]   ctx     Context
+ * @param[in]       buf     Received bytes
+ * @param[in]       len     Number of bytes in buf
+ *
+ * @return          Number of bytes processed, bytes following the final result code of a command are not processed
+ *                  unless a URC table is set and no new command was submitted from the completion callback
+ */
+size_t miotyAtClientCtx_feed(miotyAtClient_ctx * ctx, uint8_t const * buf, size_t len);
+
+/**
+ * @brief Check if a command is pending on ctx
+ */
+bool miotyAtClientCtx_pending(miotyAtClient_ctx * ctx);
+
+/**
+ * @brief End the pending command of ctx with returnCode, e.g. MIOTYATCLIENT_RETURN_CODE_ATReadFailed if the transport broke
+ *
+ * The completion callback is invoked as for any other outcome. Does nothing if no command is pending,
+ * but ends draining (see Deadlines).
+ */
+void miotyAtClientCtx_abort(miotyAtClient_ctx * ctx, miotyAtClient_returnCode returnCode);
+
+/*
+ * Deadlines
+ *
+ * Once a clock hook is set, every command ends with MIOTYATCLIENT_RETURN_CODE_Timeout if its final result
+ * code did not arrive within its latency budget. The budget is, in this order, the one set for the call
+ * with miotyAtClientCtx_setCallTimeout(), the one set for the context with miotyAtClientCtx_setTimeout(),
+ * or the default of the command class (MIOTYATCLIENT_TIMEOUT_*_MS). Deadlines are checked by
+ * miotyAtClientCtx_poll(), so a blocking read hook has to return (with *len=0) within a bounded time.
+ *
+ * The modem may still answer a timed out command. Until that final result code arrives, ctx drains: received
+ * bytes are swallowed (URCs are still dispatched) and new commands are rejected with
+ * MIOTYATCLIENT_RETURN_CODE_Busy, blocking calls wait for the drain to end instead. Draining also ends
+ * after the longer of MIOTYATCLIENT_DRAIN_MS and the default of the command class, if the read hook fails,
+ * with miotyAtClientCtx_abort() or with miotyAtClientCtx_rxFlushed().
+ */
+
+/**
+ * @brief Set the clock hook of ctx, NULL disables deadlines
+ */
+void miotyAtClientCtx_setClock(miotyAtClient_ctx * ctx, miotyAtClient_clockHook clock);
+
+/**
+ * @brief Set the latency budget in ms for all commands on ctx, 0 restores the defaults of the command classes
+ */
+void miotyAtClientCtx_setTimeout(miotyAtClient_ctx * ctx, uint32_t timeoutMs);
+
+/**
+ * @brief Set the latency budget in ms for the next command on ctx only
+ */
+void miotyAtClientCtx_setCallTimeout(miotyAtClient_ctx * ctx, uint32_t timeoutMs);
+
+/**
+ * @brief End the pending command with MIOTYATCLIENT_RETURN_CODE_Timeout if its deadline passed, end draining once its time is up
+ *
+ * Needed only if responses are processed with miotyAtClientCtx_feed() instead of miotyAtClientCtx_poll().
+ *
+ * @return          true while a command is still pending on ctx
+ */
+bool miotyAtClientCtx_checkDeadline(miotyAtClient_ctx * ctx);
+
+/**
+ * @brief Check if ctx is draining the late response of a timed out command
+ */
+bool miotyAtClientCtx_draining(miotyAtClient_ctx * ctx);
+
+/**
+ * @brief End draining after the application discarded all bytes received from the modem (e.g. flushed the UART)
+ */
+void miotyAtClientCtx_rxFlushed(miotyAtClient_ctx * ctx);
+
+/*
+ * Configuration cache
+ *
+ * With the cache enabled, reads of the parameters in MIOTYATCMD_CACHE_TABLE (EUI, IPv6 subnet mask, short
+ * address, transmit power, uplink mode/sync burst/profile, app crypto mode) are served locally once
+ * the value is known. Successful sets write through, a failed set drops the value. Reset, factory reset and
+ * AT-DEF drop all values. Changes the client does not see (e.g. a spontaneous reboot of the modem) require
+ * miotyAtClientCtx_invalidateCache().
+ *
+ * Independent of the cache, every context mirrors the packet counter of its modem. It is taken from the -MPCT:
+ * field of every response and from AT-MPCT, so miotyAtClientCtx_getPacketCounter() only asks the modem if
+ * the value is unknown. Reset, factory reset, AT-DEF, attach and detach drop it, as does a send that
+ * doesn't report the counter (e.g. a timeout, where the modem may have sent the message anyway).
+ */
+
+/**
+ * @brief Enable or disable the configuration cache of ctx, both drop all cached values
+ */
+void miotyAtClientCtx_enableCache(miotyAtClient_ctx * ctx, bool enable);
+
+/**
+ * @brief Drop all cached values of ctx and its packet counter mirror, the next read of each parameter goes to the modem
+ */
+void miotyAtClientCtx_invalidateCache(miotyAtClient_ctx * ctx);
+
+/**
+ * @brief Read the packet counter from the modem if the mirror wasn't updated for intervalMs, 0 disables it
+ *
+ * Requires the clock hook. Differences to the mirror are counted in ctx->packetCounter.mismatches.
+ */
+void miotyAtClientCtx_setPacketCounterVerify(miotyAtClient_ctx * ctx, uint32_t intervalMs);
+
+/*
+ * Unsolicited result codes
+ *
+ * Lines the modem sends on its own, e.g. on events, are looked up by their key in a table of
+ * miotyAtParser_urc entries and passed to the callback of the matching entry. They are recognized in between
+ * commands as well as within a response, where they don't disturb the pending command. In between commands,
+ * received bytes are processed by miotyAtClientCtx_poll() or miotyAtClientCtx_feed() as during a command.
+ * Callbacks run from there and must not issue blocking commands on ctx.
+ */
+
+/**
+ * @brief Set the URC table of ctx, NULL removes it
+ *
+ * @param[in]   urc     Entries, has to stay valid while it is set
+ * @param[in]   count   Number of entries
+ */
+void miotyAtClientCtx_setUrcTable(miotyAtClient_ctx * ctx, miotyAtParser_urc const * urc, uint8_t count);
+
+#ifdef MIOTYATCLIENT_STATS
+/*
+ * Command statistics
+ *
+ * Built with MIOTYATCLIENT_STATS, every context counts per AT command the submissions, bytes written and read,
+ * read hook calls, the latency from submission to the final result code and the distribution of return codes.
+ * Bytes per read call and latency per byte tell serial bandwidth apart from processing time in the modem.
+ * Without the define neither the counters nor these functions exist and the client carries no overhead.
+ */
+
+/**
+ * @brief Copy the statistics of ctx to snapshot
+ *
+ * Must not race with a command completing on ctx, e.g. call it from the same thread or with the UART interrupt masked.
+ */
+void miotyAtClientCtx_getStats(miotyAtClient_ctx * ctx, miotyAtClient_stats * snapshot);
+
+/**
+ * @brief Reset all statistics of ctx to zero
+ */
+void miotyAtClientCtx_resetStats(miotyAtClient_ctx * ctx);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,199 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Default context of the MIOTY™ AT client, bound to miotyAtClientWrite() and miotyAtClientRead()
+ */
+
+#include "miotyAtClient.h"
+
+static void default_write(void * user, uint8_t * data, uint16_t size);
+static bool default_read(void * user, uint8_t * buf, uint8_t * len);
+#ifdef MIOTYATCLIENT_DEFAULT_WRITEV
+static void default_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt);
+#endif
+#ifdef MIOTYATCLIENT_DEFAULT_READN
+static bool default_readn(void * user, uint8_t * buf, size_t cap, size_t * len);
+#endif
+
+static miotyAtClient_ctx defaultCtx;
+static bool defaultCtxInitialized = false;
+
+
+miotyAtClient_ctx * miotyAtClient_defaultCtx(void) {
+    if (!defaultCtxInitialized) {
+        miotyAtClientCtx_init(&defaultCtx, default_write, default_read, NULL);
+#ifdef MIOTYATCLIENT_DEFAULT_WRITEV
+        miotyAtClientCtx_setWritev(&defaultCtx, default_writev);
+#endif
+#ifdef MIOTYATCLIENT_DEFAULT_READN
+        miotyAtClientCtx_setReadn(&defaultCtx, default_readn);
+#endif
+        defaultCtxInitialized = true;
+    }
+    return &defaultCtx;
+}
+
+static void default_write(void * user, uint8_t * data, uint16_t size) {
+    (void)user;
+    miotyAtClientWrite(data, size);
+}
+
+static bool default_read(void * user, uint8_t * buf, uint8_t * len) {
+    (void)user;
+    return miotyAtClientRead(buf, len);
+}
+
+#ifdef MIOTYATCLIENT_DEFAULT_WRITEV
+static void default_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt) {
+    miotyAtClientWritev(iov, iovcnt);
+}
+#endif
+
+#ifdef MIOTYATCLIENT_DEFAULT_READN
+static bool default_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    return miotyAtClientReadn(buf, cap, len);
+}
+#endif
+
+miotyAtClient_returnCode miotyAtClient_reset(void) {
+    return miotyAtClientCtx_reset(miotyAtClient_defaultCtx());
+}
+
+miotyAtClient_returnCode miotyAtClient_factoryReset(void) {
+    return miotyAtClientCtx_factoryReset(miotyAtClient_defaultCtx());
+}
+
+miotyAtClient_returnCode miotyAtClient_setDefaults(uint8_t * eui64, uint8_t * ipv6, uint8_t * nwKey, uint8_t * shortAdress, uint8_t * appCryptoKey, uint8_t ulProfile, uint8_t ulMode, uint8_t ulSyncBurst, uint8_t appCryptoMode, uint8_t attached1stBoot) {
+    return miotyAtClientCtx_setDefaults(miotyAtClient_defaultCtx(), eui64, ipv6, nwKey, shortAdress, appCryptoKey, ulProfile, ulMode, ulSyncBurst, appCryptoMode, attached1stBoot);
+}
+
+miotyAtClient_returnCode miotyAtClient_setNetworkKey(uint8_t * nwKey) {
+    return miotyAtClientCtx_setNetworkKey(miotyAtClient_defaultCtx(), nwKey);
+}
+
+miotyAtClient_returnCode miotyAtClient_getOrSetIPv6SubnetMask(uint8_t * ipv6, bool set) {
+    return miotyAtClientCtx_getOrSetIPv6SubnetMask(miotyAtClient_defaultCtx(), ipv6, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_getOrSetEui(uint8_t * eui64, bool set) {
+    return miotyAtClientCtx_getOrSetEui(miotyAtClient_defaultCtx(), eui64, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_getOrSetShortAdress(uint8_t * shortAdress, bool set) {
+    return miotyAtClientCtx_getOrSetShortAdress(miotyAtClient_defaultCtx(), shortAdress, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_getOrSetTransmitPower(uint32_t * txPower, bool set) {
+    return miotyAtClientCtx_getOrSetTransmitPower(miotyAtClient_defaultCtx(), txPower, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_getOrSetBaudrate(uint32_t * baud, bool set) {
+    return miotyAtClientCtx_getOrSetBaudrate(miotyAtClient_defaultCtx(), baud, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_getPacketCounter(uint32_t * counter) {
+    return miotyAtClientCtx_getPacketCounter(miotyAtClient_defaultCtx(), counter);
+}
+
+miotyAtClient_returnCode miotyAtClient_uplinkMode(uint32_t * ulMode, bool set) {
+    return miotyAtClientCtx_uplinkMode(miotyAtClient_defaultCtx(), ulMode, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_uplinkSyncBurst(uint32_t * ulSyncBurst, bool set) {
+    return miotyAtClientCtx_uplinkSyncBurst(miotyAtClient_defaultCtx(), ulSyncBurst, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_uplinkProfile(uint32_t * ulProfile, bool set) {
+    return miotyAtClientCtx_uplinkProfile(miotyAtClient_defaultCtx(), ulProfile, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_appCryptoMode(uint32_t * appCyrptoMode, bool set) {
+    return miotyAtClientCtx_appCryptoMode(miotyAtClient_defaultCtx(), appCyrptoMode, set);
+}
+
+miotyAtClient_returnCode miotyAtClient_setAppCryptoKey(uint8_t * appCryptoKey) {
+    return miotyAtClientCtx_setAppCryptoKey(miotyAtClient_defaultCtx(), appCryptoKey);
+}
+
+miotyAtClient_returnCode miotyAtClient_getBytes(miotyAtCmd_id cmd, uint8_t * buffer, uint8_t * sizeBuf) {
+    return miotyAtClientCtx_getBytes(miotyAtClient_defaultCtx(), cmd, buffer, sizeBuf);
+}
+
+miotyAtClient_returnCode miotyAtClient_setBytes(miotyAtCmd_id cmd, uint8_t * data, uint8_t sizeData) {
+    return miotyAtClientCtx_setBytes(miotyAtClient_defaultCtx(), cmd, data, sizeData);
+}
+
+miotyAtClient_returnCode miotyAtClient_getInt(miotyAtCmd_id cmd, uint32_t * value) {
+    return miotyAtClientCtx_getInt(miotyAtClient_defaultCtx(), cmd, value);
+}
+
+miotyAtClient_returnCode miotyAtClient_setInt(miotyAtCmd_id cmd, uint32_t value) {
+    return miotyAtClientCtx_setInt(miotyAtClient_defaultCtx(), cmd, value);
+}
+
+miotyAtClient_returnCode miotyAtClient_send(miotyAtCmd_id cmd, uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * sizeData, uint32_t * packetCounter) {
+    return miotyAtClientCtx_send(miotyAtClient_defaultCtx(), cmd, msg, sizeMsg, data, sizeData, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageUniMPF(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageUniMPF(miotyAtClient_defaultCtx(), msg, sizeMsg, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageUni(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageUni(miotyAtClient_defaultCtx(), msg, sizeMsg, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageBidiMPF(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageBidiMPF(miotyAtClient_defaultCtx(), msg, sizeMsg, data, size_data, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageBidi(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageBidi(miotyAtClient_defaultCtx(), msg, sizeMsg, data, size_data, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageUniTransparent(uint8_t * msg, uint8_t sizeMsg, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageUniTransparent(miotyAtClient_defaultCtx(), msg, sizeMsg, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_sendMessageBidiTransparent(uint8_t * msg, uint8_t sizeMsg, uint8_t * data, uint8_t * size_data, uint32_t * packetCounter) {
+    return miotyAtClientCtx_sendMessageBidiTransparent(miotyAtClient_defaultCtx(), msg, sizeMsg, data, size_data, packetCounter);
+}
+
+miotyAtClient_returnCode miotyAtClient_macAttach(uint8_t * data, uint8_t * MSTA) {
+    return miotyAtClientCtx_macAttach(miotyAtClient_defaultCtx(), data, MSTA);
+}
+
+miotyAtClient_returnCode miotyAtClient_macDetach(uint8_t * data, uint8_t sizeData, uint8_t * MSTA) {
+    return miotyAtClientCtx_macDetach(miotyAtClient_defaultCtx(), data, sizeData, MSTA);
+}
+
+miotyAtClient_returnCode miotyAtClient_macAttachLocal(uint8_t * MSTA) {
+    return miotyAtClientCtx_macAttachLocal(miotyAtClient_defaultCtx(), MSTA);
+}
+
+miotyAtClient_returnCode miotyAtClient_macDetachLocal(uint8_t * MSTA) {
+    return miotyAtClientCtx_macDetachLocal(miotyAtClient_defaultCtx(), MSTA);
+}
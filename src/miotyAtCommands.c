@@ -0,0 +1,57 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Table of the AT commands of a MIOTY™ modem (AT protocol v2.x.x)
+ */
+
+#include "miotyAtCommands.h"
+#include "miotyAtClient.h"
+
+#define MIOTYATCMD_TABLE_ENTRY(id, name, type, size, ops, timeout) \
+    [MIOTYATCMD_##id] = { \
+        name MIOTYATCMD_SUFFIX_##type, \
+        sizeof(name) - 1, \
+        sizeof(name MIOTYATCMD_SUFFIX_##type) - 1, \
+        MIOTYATCMD_TYPE_##type, \
+        size, \
+        ops, \
+        MIOTYATCMD_TIMEOUT_##timeout, \
+    },
+
+#define MIOTYATCMD_CACHE_SLOT_ENTRY(id) [MIOTYATCMD_##id] = MIOTYATCMD_CACHE_##id + 1,
+#define MIOTYATCMD_TIMEOUT_MS_ENTRY(timeout) [MIOTYATCMD_TIMEOUT_##timeout] = MIOTYATCLIENT_TIMEOUT_##timeout##_MS,
+
+miotyAtCmd const miotyAtCmd_table[MIOTYATCMD_COUNT] = {
+    MIOTYATCMD_TABLE(MIOTYATCMD_TABLE_ENTRY)
+};
+
+uint8_t const miotyAtCmd_cacheSlot[MIOTYATCMD_COUNT] = {
+    MIOTYATCMD_CACHE_TABLE(MIOTYATCMD_CACHE_SLOT_ENTRY)
+};
+
+uint32_t const miotyAtCmd_timeoutMs[MIOTYATCMD_TIMEOUT_CLASSES] = {
+    MIOTYATCMD_TIMEOUT_TABLE(MIOTYATCMD_TIMEOUT_MS_ENTRY)
+};
@@ -0,0 +1,164 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Table of the AT commands of a MIOTY™ modem (AT protocol v2.x.x)
+ *
+ * Every command is described once in MIOTYATCMD_TABLE. The enum of command ids and the constant
+ * descriptor table miotyAtCmd_table are generated from it, the client only refers to commands by id.
+ */
+
+#ifndef _AT_COMMANDS_H
+#define _AT_COMMANDS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// value type of a command
+#define MIOTYATCMD_TYPE_NONE    0   // no argument, executed with "\r"
+#define MIOTYATCMD_TYPE_INT     1   // decimal value
+#define MIOTYATCMD_TYPE_BYTES   2   // "<len>\t<hex>\x1A"
+
+// allowed operations of a command
+#define MIOTYATCMD_OP_GET       0x01    // "AT-xxx?\r"
+#define MIOTYATCMD_OP_SET       0x02    // "AT-xxx=<value>\r"
+#define MIOTYATCMD_OP_EXEC      0x04    // "AT-xxx\r"
+#define MIOTYATCMD_OP_SEND      0x08    // message with payload, response carries packet counter / MSTA / downlink
+
+// request bytes stored with the command name: query for commands with a value, plain execution otherwise
+#define MIOTYATCMD_SUFFIX_NONE  "\r"
+#define MIOTYATCMD_SUFFIX_INT   "?\r"
+#define MIOTYATCMD_SUFFIX_BYTES "?\r"
+
+// longest request, "AT-UMPF?\r" plus terminating zero
+#define MIOTYATCMD_REQUEST_SIZE 10
+
+/*
+ * X(id, name, type, fixed size in bytes (0: variable), allowed operations, timeout class)
+ */
+#define MIOTYATCMD_TABLE(X) \
+    X(DEF,  "AT-DEF",  BYTES, 64, MIOTYATCMD_OP_SET,                      CONFIG) \
+    X(RST,  "AT-RST",  NONE,  0,  MIOTYATCMD_OP_EXEC,                     RESET)  \
+    X(Z,    "ATZ",     NONE,  0,  MIOTYATCMD_OP_EXEC,                     RESET)  \
+    X(MNWK, "AT-MNWK", BYTES, 16, MIOTYATCMD_OP_SET,                      CONFIG) \
+    X(MIP6, "AT-MIP6", BYTES, 8,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(MEUI, "AT-MEUI", BYTES, 8,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(MSAD, "AT-MSAD", BYTES, 2,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(MPCT, "AT-MPCT", INT,   0,  MIOTYATCMD_OP_GET,                      CONFIG) \
+    X(IPR,  "AT+IPR",  INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(UTPL, "AT-UTPL", INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(UM,   "AT-UM",   INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(US,   "AT-US",   INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(UP,   "AT-UP",   INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(ACM,  "AT-ACM",  INT,   0,  MIOTYATCMD_OP_GET | MIOTYATCMD_OP_SET,  CONFIG) \
+    X(ACK,  "AT-ACK",  BYTES, 16, MIOTYATCMD_OP_SET,                      CONFIG) \
+    X(TU,   "AT-TU",   BYTES, 0,  MIOTYATCMD_OP_SEND,                     UPLINK) \
+    X(UMPF, "AT-UMPF", BYTES, 0,  MIOTYATCMD_OP_SEND,                     UPLINK) \
+    X(U,    "AT-U",    BYTES, 0,  MIOTYATCMD_OP_SEND,                     UPLINK) \
+    X(TB,   "AT-TB",   BYTES, 0,  MIOTYATCMD_OP_SEND,                     BIDI)   \
+    X(BMPF, "AT-BMPF", BYTES, 0,  MIOTYATCMD_OP_SEND,                     BIDI)   \
+    X(B,    "AT-B",    BYTES, 0,  MIOTYATCMD_OP_SEND,                     BIDI)   \
+    X(MAOA, "AT-MAOA", BYTES, 4,  MIOTYATCMD_OP_SEND,                     ATTACH) \
+    X(MDOA, "AT-MDOA", BYTES, 0,  MIOTYATCMD_OP_SEND,                     ATTACH) \
+    X(MALO, "AT-MALO", NONE,  0,  MIOTYATCMD_OP_EXEC,                     CONFIG) \
+    X(MDLO, "AT-MDLO", NONE,  0,  MIOTYATCMD_OP_EXEC,                     CONFIG)
+
+/*
+ * Parameters that only change through the client (set, reset, factory reset, AT-DEF) and may be cached.
+ * The baudrate is left out, its reads verify the link after a rate change.
+ */
+#define MIOTYATCMD_CACHE_TABLE(X) \
+    X(MIP6) X(MEUI) X(MSAD) X(UTPL) X(UM) X(US) X(UP) X(ACM)
+
+// largest cached value in bytes
+#define MIOTYATCMD_CACHE_VALUE_SIZE 8
+
+/*
+ * Timeout classes of MIOTYATCMD_TABLE, the budget of each is MIOTYATCLIENT_TIMEOUT_<class>_MS
+ */
+#define MIOTYATCMD_TIMEOUT_TABLE(X) \
+    X(CONFIG) X(RESET) X(UPLINK) X(BIDI) X(ATTACH)
+
+#define MIOTYATCMD_ENUM_ENTRY(id, name, type, size, ops, timeout) MIOTYATCMD_##id,
+#define MIOTYATCMD_CACHE_ENUM_ENTRY(id) MIOTYATCMD_CACHE_##id,
+#define MIOTYATCMD_TIMEOUT_ENUM_ENTRY(timeout) MIOTYATCMD_TIMEOUT_##timeout,
+
+typedef enum miotyAtCmd_id {
+    MIOTYATCMD_TABLE(MIOTYATCMD_ENUM_ENTRY)
+    MIOTYATCMD_COUNT,
+    MIOTYATCMD_NONE = 0xFF, // no command, e.g. the response carries no value
+} miotyAtCmd_id;
+
+typedef struct miotyAtCmd {
+    char request[MIOTYATCMD_REQUEST_SIZE];  // name followed by MIOTYATCMD_SUFFIX_<type>
+    uint8_t nameLen;
+    uint8_t requestLen;
+    uint8_t type;
+    uint8_t size;
+    uint8_t ops;
+    uint8_t timeout;            // MIOTYATCMD_TIMEOUT_*, a class instead of ms keeps the table small, on AVR it lives in RAM
+} miotyAtCmd;
+
+// cache slots, one per entry of MIOTYATCMD_CACHE_TABLE
+enum {
+    MIOTYATCMD_CACHE_TABLE(MIOTYATCMD_CACHE_ENUM_ENTRY)
+    MIOTYATCMD_CACHE_SLOTS,
+};
+
+enum {
+    MIOTYATCMD_TIMEOUT_TABLE(MIOTYATCMD_TIMEOUT_ENUM_ENTRY)
+    MIOTYATCMD_TIMEOUT_CLASSES,
+};
+
+extern miotyAtCmd const miotyAtCmd_table[MIOTYATCMD_COUNT];
+
+// cache slot + 1 of every command, 0 if the command is not cached
+extern uint8_t const miotyAtCmd_cacheSlot[MIOTYATCMD_COUNT];
+
+// default latency budget in ms of every timeout class
+extern uint32_t const miotyAtCmd_timeoutMs[MIOTYATCMD_TIMEOUT_CLASSES];
+
+/**
+ * @brief Response field of a command, i.e. its name without the leading "AT" (e.g. "-MEUI", "+IPR")
+ */
+static inline char const * miotyAtCmd_field(miotyAtCmd const * cmd) {
+    return cmd->request + 2;
+}
+
+/**
+ * @brief Default latency budget of a command in ms
+ */
+static inline uint32_t miotyAtCmd_timeout(miotyAtCmd const * cmd) {
+    return miotyAtCmd_timeoutMs[cmd->timeout];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Declarative configuration of a MIOTY™ modem
+ */
+
+#include <stddef.h>
+#include "miotyAtConfig.h"
+
+typedef struct config_field {
+    miotyAtCmd_id cmd;
+    uint8_t offset;
+} config_field;
+
+#define CONFIG_FIELD_ENTRY(id, member, cmd) \
+    [MIOTYATCLIENT_CONFIG_##id] = { MIOTYATCMD_##cmd, offsetof(miotyAtClient_config, member) },
+
+static config_field const fields[MIOTYATCLIENT_CONFIG_FIELDS] = {
+    MIOTYATCLIENT_CONFIG_TABLE(CONFIG_FIELD_ENTRY)
+};
+
+static bool field_differs(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, uint8_t field, miotyAtClient_configReport * report, bool * known);
+static miotyAtClient_returnCode write_field(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, uint8_t field);
+static miotyAtClient_returnCode write_defaults(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, miotyAtClient_configReport * report);
+static uint8_t count_fields(uint32_t flags);
+
+
+miotyAtClient_returnCode miotyAtClientCtx_applyConfig(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, miotyAtClient_configReport * report) {
+    miotyAtClient_configReport localReport;
+    if (report == NULL)
+        report = &localReport;
+    memset(report, 0, sizeof(*report));
+
+    // read the current state once, remember the fields that have to be written and those known to differ
+    uint32_t pending = 0;
+    uint32_t changed = 0;
+    for (uint8_t i = 0; i < MIOTYATCLIENT_CONFIG_FIELDS; i++) {
+        if (!(config->fields & (1UL << i)))
+            continue;
+        bool known;
+        if (field_differs(ctx, config, i, report, &known)) {
+            pending |= 1UL << i;
+            if (known)
+                changed |= 1UL << i;
+        } else {
+            report->status[i] = MIOTYATCLIENT_CONFIG_STATUS_UNCHANGED;
+        }
+    }
+
+    // AT-DEF + factory reset costs two transactions, whatever number of fields it covers. Set-only fields
+    // (network key, app crypto key) are written either way, so only fields read back as different count.
+    if (config->allowDefaults && (config->fields & MIOTYATCLIENT_CONFIG_DEFAULTS) == MIOTYATCLIENT_CONFIG_DEFAULTS
+            && count_fields(changed & MIOTYATCLIENT_CONFIG_DEFAULTS) > 2) {
+        miotyAtClient_returnCode rc = write_defaults(ctx, config, report);
+        for (uint8_t i = 0; i < MIOTYATCLIENT_CONFIG_FIELDS; i++) {
+            if (!(pending & MIOTYATCLIENT_CONFIG_DEFAULTS & (1UL << i)))
+                continue;
+            if (rc == MIOTYATCLIENT_RETURN_CODE_OK)
+                report->status[i] = MIOTYATCLIENT_CONFIG_STATUS_DEFAULTS;
+            else if (report->returnCode[i] == MIOTYATCLIENT_RETURN_CODE_OK)
+                report->returnCode[i] = rc;
+        }
+        // the factory reset may have changed the fields outside of AT-DEF as well
+        if (rc == MIOTYATCLIENT_RETURN_CODE_OK)
+            pending = config->fields & ~MIOTYATCLIENT_CONFIG_DEFAULTS;
+    }
+
+    miotyAtClient_returnCode ret = MIOTYATCLIENT_RETURN_CODE_OK;
+    for (uint8_t i = 0; i < MIOTYATCLIENT_CONFIG_FIELDS; i++) {
+        if (!(pending & (1UL << i)))
+            continue;
+        miotyAtClient_returnCode rc = write_field(ctx, config, i);
+        report->writes++;
+        if (report->returnCode[i] == MIOTYATCLIENT_RETURN_CODE_OK)
+            report->returnCode[i] = rc;
+        report->status[i] = rc == MIOTYATCLIENT_RETURN_CODE_OK ? MIOTYATCLIENT_CONFIG_STATUS_WRITTEN : MIOTYATCLIENT_CONFIG_STATUS_FAILED;
+        if (ret == MIOTYATCLIENT_RETURN_CODE_OK)
+            ret = rc;
+    }
+    return ret;
+}
+
+miotyAtClient_returnCode miotyAtClient_applyConfig(miotyAtClient_config const * config, miotyAtClient_configReport * report) {
+    return miotyAtClientCtx_applyConfig(miotyAtClient_defaultCtx(), config, report);
+}
+
+// true if the field has to be written, i.e. it differs, cannot be read or reading failed. *known is set
+// only if the field was read back and compared, a failed read is recorded in the report.
+static bool field_differs(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, uint8_t field, miotyAtClient_configReport * report, bool * known) {
+    miotyAtCmd const * cmd = &miotyAtCmd_table[fields[field].cmd];
+    uint8_t const * value = (uint8_t const *)config + fields[field].offset;
+    *known = false;
+    if (!(cmd->ops & MIOTYATCMD_OP_GET))
+        return true;
+
+    report->reads++;
+    miotyAtClient_returnCode rc;
+    if (cmd->type == MIOTYATCMD_TYPE_INT) {
+        // differs unless the response carries the value
+        uint32_t current;
+        memcpy(&current, value, sizeof(current));
+        current = ~current;
+        rc = miotyAtClientCtx_getInt(ctx, fields[field].cmd, &current);
+        if (rc != MIOTYATCLIENT_RETURN_CODE_OK) {
+            report->returnCode[field] = rc;
+            return true;
+        }
+        *known = true;
+        return memcmp(&current, value, sizeof(current)) != 0;
+    }
+    uint8_t current[MIOTYATCMD_CACHE_VALUE_SIZE];
+    uint8_t size = cmd->size;
+    if (size > sizeof(current))
+        return true;
+    rc = miotyAtClientCtx_getBytes(ctx, fields[field].cmd, current, &size);
+    if (rc == MIOTYATCLIENT_RETURN_CODE_OK && size != cmd->size)
+        rc = MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+    if (rc != MIOTYATCLIENT_RETURN_CODE_OK) {
+        report->returnCode[field] = rc;
+        return true;
+    }
+    *known = true;
+    return memcmp(current, value, size) != 0;
+}
+
+static miotyAtClient_returnCode write_field(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, uint8_t field) {
+    miotyAtCmd const * cmd = &miotyAtCmd_table[fields[field].cmd];
+    uint8_t const * value = (uint8_t const *)config + fields[field].offset;
+    if (cmd->type == MIOTYATCMD_TYPE_INT) {
+        uint32_t intValue;
+        memcpy(&intValue, value, sizeof(intValue));
+        return miotyAtClientCtx_setInt(ctx, fields[field].cmd, intValue);
+    }
+    return miotyAtClientCtx_setBytes(ctx, fields[field].cmd, (uint8_t *)value, cmd->size);
+}
+
+static miotyAtClient_returnCode write_defaults(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, miotyAtClient_configReport * report) {
+    report->writes++;
+    miotyAtClient_returnCode ret = miotyAtClientCtx_setDefaults(ctx, (uint8_t *)config->eui64, (uint8_t *)config->ipv6,
+            (uint8_t *)config->nwKey, (uint8_t *)config->shortAdress, (uint8_t *)config->appCryptoKey, config->ulProfile,
+            config->ulMode, config->ulSyncBurst, config->appCryptoMode, config->attached1stBoot);
+    if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+        return ret;
+    report->writes++;
+    ret = miotyAtClientCtx_factoryReset(ctx);
+    report->usedDefaults = ret == MIOTYATCLIENT_RETURN_CODE_OK;
+    return ret;
+}
+
+static uint8_t count_fields(uint32_t flags) {
+    uint8_t n = 0;
+    for (; flags != 0; flags &= flags - 1)
+        n++;
+    return n;
+}
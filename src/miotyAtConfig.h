@@ -0,0 +1,129 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Declarative configuration of a MIOTY™ modem
+ *
+ * A miotyAtClient_config describes the wanted state of the modem parameters. miotyAtClientCtx_applyConfig()
+ * reads the current state once, writes only the parameters that differ and reports the outcome per field.
+ * If the config covers every parameter of AT-DEF and that is cheaper, the whole config is written as
+ * defaults with one AT-DEF followed by a factory reset.
+ */
+
+#ifndef _AT_CONFIG_H
+#define _AT_CONFIG_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fields of miotyAtClient_config, X(id, member, command)
+ */
+#define MIOTYATCLIENT_CONFIG_TABLE(X) \
+    X(EUI,              eui64,          MEUI) \
+    X(IPV6,             ipv6,           MIP6) \
+    X(SHORT_ADDRESS,    shortAdress,    MSAD) \
+    X(NETWORK_KEY,      nwKey,          MNWK) \
+    X(APP_CRYPTO_KEY,   appCryptoKey,   ACK)  \
+    X(TX_POWER,         txPower,        UTPL) \
+    X(UL_MODE,          ulMode,         UM)   \
+    X(UL_SYNC_BURST,    ulSyncBurst,    US)   \
+    X(UL_PROFILE,       ulProfile,      UP)   \
+    X(APP_CRYPTO_MODE,  appCryptoMode,  ACM)
+
+#define MIOTYATCLIENT_CONFIG_ENUM_ENTRY(id, member, cmd) MIOTYATCLIENT_CONFIG_##id,
+
+typedef enum miotyAtClient_configField {
+    MIOTYATCLIENT_CONFIG_TABLE(MIOTYATCLIENT_CONFIG_ENUM_ENTRY)
+    MIOTYATCLIENT_CONFIG_FIELDS,
+} miotyAtClient_configField;
+
+// flag of a field in miotyAtClient_config.fields
+#define MIOTYATCLIENT_CONFIG_FLAG(id)   (1UL << MIOTYATCLIENT_CONFIG_##id)
+
+// fields written by AT-DEF
+#define MIOTYATCLIENT_CONFIG_DEFAULTS   (MIOTYATCLIENT_CONFIG_FLAG(EUI) | MIOTYATCLIENT_CONFIG_FLAG(IPV6) | \
+                                         MIOTYATCLIENT_CONFIG_FLAG(SHORT_ADDRESS) | MIOTYATCLIENT_CONFIG_FLAG(NETWORK_KEY) | \
+                                         MIOTYATCLIENT_CONFIG_FLAG(APP_CRYPTO_KEY) | MIOTYATCLIENT_CONFIG_FLAG(UL_MODE) | \
+                                         MIOTYATCLIENT_CONFIG_FLAG(UL_SYNC_BURST) | MIOTYATCLIENT_CONFIG_FLAG(UL_PROFILE) | \
+                                         MIOTYATCLIENT_CONFIG_FLAG(APP_CRYPTO_MODE))
+
+typedef struct miotyAtClient_config {
+    uint32_t fields;            // MIOTYATCLIENT_CONFIG_FLAG() of every member to apply
+    bool allowDefaults;         // allow AT-DEF + factory reset if cheaper (factory reset also resets MAC state)
+    uint8_t attached1stBoot;    // only written with AT-DEF
+
+    uint8_t eui64[8];
+    uint8_t ipv6[8];
+    uint8_t shortAdress[2];
+    uint8_t nwKey[16];          // cannot be read back, always written
+    uint8_t appCryptoKey[16];   // cannot be read back, always written
+    uint32_t txPower;
+    uint32_t ulMode;
+    uint32_t ulSyncBurst;
+    uint32_t ulProfile;
+    uint32_t appCryptoMode;
+} miotyAtClient_config;
+
+typedef enum miotyAtClient_configStatus {
+    MIOTYATCLIENT_CONFIG_STATUS_SKIPPED,    // not in miotyAtClient_config.fields
+    MIOTYATCLIENT_CONFIG_STATUS_UNCHANGED,  // modem already had the value
+    MIOTYATCLIENT_CONFIG_STATUS_WRITTEN,    // written with its own command
+    MIOTYATCLIENT_CONFIG_STATUS_DEFAULTS,   // written with AT-DEF
+    MIOTYATCLIENT_CONFIG_STATUS_FAILED,     // write failed, see returnCode
+} miotyAtClient_configStatus;
+
+typedef struct miotyAtClient_configReport {
+    uint8_t status[MIOTYATCLIENT_CONFIG_FIELDS];                        // miotyAtClient_configStatus
+    miotyAtClient_returnCode returnCode[MIOTYATCLIENT_CONFIG_FIELDS];  // first error of the field: read, AT-DEF or write
+    uint8_t reads;              // read transactions
+    uint8_t writes;             // write transactions
+    bool usedDefaults;
+} miotyAtClient_configReport;
+
+/**
+ * @brief Bring the modem behind ctx to the state described by config with as few transactions as possible
+ *
+ * @param[in,out]   ctx         Context
+ * @param[in]       config      Wanted state
+ * @param[out]      report      Outcome per field, may be NULL
+ *
+ * @return          MIOTYATCLIENT_RETURN_CODE_OK if every field was applied, otherwise the first error
+ */
+miotyAtClient_returnCode miotyAtClientCtx_applyConfig(miotyAtClient_ctx * ctx, miotyAtClient_config const * config, miotyAtClient_configReport * report);
+
+/**
+ * @brief miotyAtClientCtx_applyConfig() on the default context
+ */
+miotyAtClient_returnCode miotyAtClient_applyConfig(miotyAtClient_config const * config, miotyAtClient_configReport * report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
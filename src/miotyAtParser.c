@@ -0,0 +1,251 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Incremental parser for responses of a MIOTY™ modem (AT protocol v2.x.x)
+ */
+
+#include <string.h>
+#include "miotyAtParser.h"
+
+enum {
+    STATE_LINE_START,
+    STATE_KEY,
+    STATE_INT,
+    STATE_BYTES_LEN,
+    STATE_BYTES_HEX,
+    STATE_URC,
+    STATE_SKIP_LINE,
+};
+
+#define NIBBLE_NONE 0xFF
+
+static bool key_equals(miotyAtParser const * parser, char const * key, uint8_t keyLen);
+static void resolve_field(miotyAtParser * parser);
+static bool end_line(miotyAtParser * parser);
+static miotyAtParser_urc const * find_urc(miotyAtParser const * parser);
+static uint8_t hex_nibble(uint8_t c);
+
+
+void miotyAtParser_init(miotyAtParser * parser, uint8_t cmd, uint8_t * data, uint16_t dataCap) {
+    parser->cmd = cmd < MIOTYATCMD_COUNT ? cmd : MIOTYATCMD_NONE;
+    parser->data = data;
+    parser->dataCap = data != NULL ? dataCap : 0;
+
+    parser->resultCode = MIOTYATPARSER_RESULT_PENDING;
+    parser->fields = 0;
+    parser->mnfo = 0;
+    parser->merr = 0;
+    parser->atErr = 0;
+    parser->mpct = 0;
+    parser->msta = 0;
+    parser->value = 0;
+    parser->dataLen = 0;
+    parser->invalidHex = false;
+
+    parser->state = STATE_LINE_START;
+    parser->keyLen = 0;
+    parser->nibble = NIBBLE_NONE;
+    parser->target = NULL;
+
+    parser->urc = NULL;
+    parser->urcCount = 0;
+    parser->idle = false;
+    parser->urcMatch = NULL;
+}
+
+void miotyAtParser_initIdle(miotyAtParser * parser) {
+    miotyAtParser_init(parser, MIOTYATCMD_NONE, NULL, 0);
+    parser->idle = true;
+}
+
+void miotyAtParser_setUrc(miotyAtParser * parser, miotyAtParser_urc const * urc, uint8_t count) {
+    parser->urc = urc;
+    parser->urcCount = urc != NULL ? count : 0;
+}
+
+size_t miotyAtParser_feed(miotyAtParser * parser, uint8_t const * buf, size_t len) {
+    size_t i = 0;
+    while (i < len && parser->resultCode == MIOTYATPARSER_RESULT_PENDING) {
+        uint8_t c = buf[i++];
+        bool eol = (c == '\r' || c == '\n');
+
+        switch (parser->state) {
+        case STATE_LINE_START:
+            if (eol)
+                break;
+            parser->keyLen = 0;
+            parser->state = STATE_KEY;
+            // fall through
+        case STATE_KEY:
+            if (eol) {
+                end_line(parser);
+            } else if (c == ':') {
+                resolve_field(parser);
+            } else if (parser->keyLen < MIOTYATPARSER_KEY_SIZE) {
+                parser->key[parser->keyLen++] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+            } else {
+                parser->state = STATE_SKIP_LINE;
+            }
+            break;
+        case STATE_INT:
+            if (c >= '0' && c <= '9') {
+                *parser->target = *parser->target * 10 + (c - '0');
+            } else if (eol) {
+                parser->state = STATE_LINE_START;
+            } else if (c != ' ') {
+                parser->state = STATE_SKIP_LINE;
+            }
+            break;
+        case STATE_BYTES_LEN:
+            if (c == '\t') {
+                parser->state = STATE_BYTES_HEX;
+            } else if (eol) {
+                parser->state = STATE_LINE_START;
+            } else if (c != ' ' && (c < '0' || c > '9')) {
+                parser->state = STATE_SKIP_LINE;
+            }
+            break;
+        case STATE_BYTES_HEX:
+            if (c == 0x1A) {
+                parser->state = STATE_SKIP_LINE;
+            } else if (eol) {
+                parser->state = STATE_LINE_START;
+            } else {
+                uint8_t n = hex_nibble(c);
+                if (n == NIBBLE_NONE) {
+                    // like string_hex2bytes(), a payload with anything but hex digits is rejected
+                    parser->invalidHex = true;
+                    break;
+                }
+                if (parser->nibble == NIBBLE_NONE) {
+                    parser->nibble = n;
+                    break;
+                }
+                if (parser->dataLen < parser->dataCap)
+                    parser->data[parser->dataLen] = (parser->nibble << 4) | n;
+                parser->dataLen++;
+                parser->nibble = NIBBLE_NONE;
+            }
+            break;
+        case STATE_URC:
+            if (eol) {
+                parser->state = STATE_LINE_START;
+                parser->urcMatch->cb(parser->urcMatch, parser->urcText, parser->urcLen);
+            } else if ((c != ' ' || parser->urcLen != 0) && parser->urcLen < MIOTYATPARSER_URC_SIZE) {
+                parser->urcText[parser->urcLen++] = c;
+            }
+            break;
+        case STATE_SKIP_LINE:
+        default:
+            if (eol)
+                parser->state = STATE_LINE_START;
+            break;
+        }
+    }
+    return i;
+}
+
+static bool key_equals(miotyAtParser const * parser, char const * key, uint8_t keyLen) {
+    return parser->keyLen == keyLen && memcmp(parser->key, key, keyLen) == 0;
+}
+
+static void resolve_field(miotyAtParser * parser) {
+    uint8_t field = 0;
+    parser->target = NULL;
+    parser->state = STATE_INT;
+
+    miotyAtCmd const * cmd = parser->cmd != MIOTYATCMD_NONE ? &miotyAtCmd_table[parser->cmd] : NULL;
+    if (parser->idle) {
+        // fields below belong to responses
+    } else if (cmd != NULL && key_equals(parser, miotyAtCmd_field(cmd), cmd->nameLen - 2)) {
+        field = MIOTYATPARSER_FIELD_VALUE;
+        if (cmd->type == MIOTYATCMD_TYPE_BYTES) {
+            parser->dataLen = 0;
+            parser->nibble = NIBBLE_NONE;
+            parser->state = STATE_BYTES_LEN;
+        } else {
+            parser->target = &parser->value;
+        }
+    } else if (key_equals(parser, "-MNFO", 5)) {
+        field = MIOTYATPARSER_FIELD_MNFO;
+        parser->target = &parser->mnfo;
+    } else if (key_equals(parser, "-MERR", 5)) {
+        field = MIOTYATPARSER_FIELD_MERR;
+        parser->target = &parser->merr;
+    } else if (key_equals(parser, "AT!ERR", 6)) {
+        field = MIOTYATPARSER_FIELD_ATERR;
+        parser->target = &parser->atErr;
+    } else if (key_equals(parser, "-MPCT", 5)) {
+        field = MIOTYATPARSER_FIELD_MPCT;
+        parser->target = &parser->mpct;
+    } else if (key_equals(parser, "-MSTA", 5)) {
+        field = MIOTYATPARSER_FIELD_MSTA;
+        parser->target = &parser->msta;
+    }
+    if (field == 0) {
+        parser->urcMatch = find_urc(parser);
+        parser->urcLen = 0;
+        parser->state = parser->urcMatch != NULL ? STATE_URC : STATE_SKIP_LINE;
+        return;
+    }
+
+    if (parser->target != NULL)
+        *parser->target = 0;
+    parser->fields |= field;
+}
+
+// a line without ':' is either a final result code, an unsolicited line without text or something we do not care about (e.g. an echo)
+static bool end_line(miotyAtParser * parser) {
+    parser->state = STATE_LINE_START;
+    miotyAtParser_urc const * urc = find_urc(parser);
+    if (urc != NULL) {
+        urc->cb(urc, parser->urcText, 0);
+        return false;
+    }
+    if (parser->idle || parser->keyLen != 1 || parser->key[0] < '0' || parser->key[0] > '2')
+        return false;
+    parser->resultCode = parser->key[0] - '0';
+    return true;
+}
+
+// entry of the current key in the URC table, NULL if there is none
+static miotyAtParser_urc const * find_urc(miotyAtParser const * parser) {
+    for (uint8_t i = 0; i < parser->urcCount; i++) {
+        size_t keyLen = strlen(parser->urc[i].key);
+        if (keyLen <= MIOTYATPARSER_KEY_SIZE && key_equals(parser, parser->urc[i].key, (uint8_t)keyLen))
+            return &parser->urc[i];
+    }
+    return NULL;
+}
+
+static uint8_t hex_nibble(uint8_t c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return NIBBLE_NONE;
+}
@@ -0,0 +1,169 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Incremental parser for responses of a MIOTY™ modem (AT protocol v2.x.x)
+ *
+ * The parser consumes the bytes of a response exactly once, as they are read from the modem.
+ * It keeps track of line boundaries, the final result code (0/1/2), the fields -MNFO:, -MERR:,
+ * AT!ERR:, -MPCT:, -MSTA: and the response field of the pending command. Hex payloads of that
+ * field are decoded straight into the caller's buffer, a non-hex character in them sets invalidHex.
+ *
+ * Lines whose key is in an optional table of unsolicited result codes (URCs) are passed to the callback
+ * of their entry instead, both in between and during responses. During a response, the fields above
+ * take precedence over the table.
+ */
+
+#ifndef _AT_PARSER_H
+#define _AT_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "miotyAtCommands.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATPARSER_KEY_SIZE      8
+
+// longest text of an unsolicited line passed to its callback, longer lines are cut off
+#ifndef MIOTYATPARSER_URC_SIZE
+#define MIOTYATPARSER_URC_SIZE      64
+#endif
+
+// flags in miotyAtParser.fields
+#define MIOTYATPARSER_FIELD_MNFO    0x01
+#define MIOTYATPARSER_FIELD_MERR    0x02
+#define MIOTYATPARSER_FIELD_ATERR   0x04
+#define MIOTYATPARSER_FIELD_MPCT    0x08
+#define MIOTYATPARSER_FIELD_MSTA    0x10
+#define MIOTYATPARSER_FIELD_VALUE   0x20
+
+typedef enum miotyAtParser_resultCode {
+    MIOTYATPARSER_RESULT_OK,        // "0"
+    MIOTYATPARSER_RESULT_MACERR,    // "1", details in -MNFO: / -MERR:
+    MIOTYATPARSER_RESULT_ATERR,     // "2", details in AT!ERR:
+    MIOTYATPARSER_RESULT_PENDING,   // no final result code received yet
+} miotyAtParser_resultCode;
+
+typedef struct miotyAtParser_urc miotyAtParser_urc;
+
+/**
+ * @brief Callback of an unsolicited line with the text following "<key>:" (leading spaces removed, not terminated)
+ */
+typedef void (*miotyAtParser_urcCb)(miotyAtParser_urc const * urc, uint8_t const * text, uint8_t len);
+
+struct miotyAtParser_urc {
+    char const * key;           // key in upper case including a leading '-' or '+', e.g. "-MDLR"
+    miotyAtParser_urcCb cb;
+    void * user;
+};
+
+typedef struct miotyAtParser {
+    // pending command (index into miotyAtCmd_table) whose response field is parsed
+    uint8_t cmd;
+    uint8_t * data;
+    uint16_t dataCap;
+
+    // parsed response
+    uint8_t resultCode;
+    uint8_t fields;
+    uint32_t mnfo;
+    uint32_t merr;
+    uint32_t atErr;
+    uint32_t mpct;
+    uint32_t msta;
+    uint32_t value;
+    uint16_t dataLen;
+    bool invalidHex;            // the hex payload of the response field held a non-hex character
+
+    // line state
+    uint8_t state;
+    uint8_t keyLen;
+    uint8_t nibble;
+    uint32_t * target;
+    char key[MIOTYATPARSER_KEY_SIZE];
+
+    // unsolicited result codes
+    miotyAtParser_urc const * urc;
+    uint8_t urcCount;
+    bool idle;                  // no response expected, only unsolicited lines are parsed
+    miotyAtParser_urc const * urcMatch;
+    uint8_t urcLen;
+    uint8_t urcText[MIOTYATPARSER_URC_SIZE];
+} miotyAtParser;
+
+/**
+ * @brief Prepare the parser for the response of a new AT command
+ *
+ * @param[out]  parser      Parser to initialize
+ * @param[in]   cmd         Command whose response field is parsed, MIOTYATCMD_NONE if the value is not needed
+ * @param[out]  data        Buffer receiving the decoded bytes of the field (only for MIOTYATCMD_TYPE_BYTES)
+ * @param[in]   dataCap     Size of data
+ */
+void miotyAtParser_init(miotyAtParser * parser, uint8_t cmd, uint8_t * data, uint16_t dataCap);
+
+/**
+ * @brief Prepare the parser for the lines in between responses
+ *
+ * Only unsolicited lines are handled, final result codes and fields are ignored. The parser never gets done.
+ */
+void miotyAtParser_initIdle(miotyAtParser * parser);
+
+/**
+ * @brief Set the table of unsolicited result codes, miotyAtParser_init() clears it
+ *
+ * @param[in]   urc         Entries looked up by key, has to stay valid while it is set
+ * @param[in]   count       Number of entries
+ */
+void miotyAtParser_setUrc(miotyAtParser * parser, miotyAtParser_urc const * urc, uint8_t count);
+
+/**
+ * @brief Feed bytes received from the modem into the parser
+ *
+ * Parsing stops right after the final result code, bytes following it are not consumed.
+ *
+ * @param[in,out]   parser  Parser
+ * @param[in]       buf     Received bytes
+ * @param[in]       len     Number of bytes in buf
+ *
+ * @return          Number of bytes consumed
+ */
+size_t miotyAtParser_feed(miotyAtParser * parser, uint8_t const * buf, size_t len);
+
+/**
+ * @brief Check if the final result code has been received
+ */
+static inline bool miotyAtParser_done(miotyAtParser const * parser) {
+    return parser->resultCode != MIOTYATPARSER_RESULT_PENDING;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
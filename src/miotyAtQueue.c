@@ -0,0 +1,240 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Persistent store-and-forward queue of uplinks
+ */
+
+#include "miotyAtQueue.h"
+
+#define ALIGN_UP(n)     (((n) + MIOTYATQUEUE_ALIGN - 1) & ~(uint32_t)(MIOTYATQUEUE_ALIGN - 1))
+
+typedef struct record {
+    uint8_t state;
+    uint8_t cmd;
+    uint8_t size;
+    uint32_t seq;
+} record;
+
+static bool read_record(miotyAtQueue const * queue, uint32_t offset, record * rec);
+static uint32_t record_end(uint32_t offset, uint8_t size);
+static uint32_t page_start(miotyAtQueue const * queue, uint32_t offset);
+static uint32_t next_page(miotyAtQueue const * queue, uint32_t offset);
+static bool erased(miotyAtQueue const * queue, uint32_t offset, uint32_t end);
+static bool set_state(miotyAtQueue * queue, uint8_t state);
+static void advance_head(miotyAtQueue * queue);
+static uint16_t crc16(uint16_t crc, uint8_t const * data, uint32_t size);
+static uint16_t get_u16(uint8_t const * src);
+static uint32_t get_u32(uint8_t const * src);
+
+
+bool miotyAtQueue_open(miotyAtQueue * queue, miotyAtQueue_storage const * storage) {
+    memset(queue, 0, sizeof(*queue));
+    queue->storage = *storage;
+    uint32_t pageSize = storage->pageSize;
+    if (pageSize % MIOTYATQUEUE_ALIGN != 0 || pageSize < ALIGN_UP(MIOTYATQUEUE_HEADER_SIZE + 255)
+            || storage->size % pageSize != 0 || storage->size / pageSize < 2)
+        return false;
+
+    // the newest record ends the log, the oldest queued one is its head
+    bool any = false;
+    bool anyQueued = false;
+    uint32_t headSeq = 0;
+    for (uint32_t page = 0; page < storage->size; page += pageSize) {
+        uint32_t offset = page;
+        record rec;
+        while (offset < page + pageSize && read_record(queue, offset, &rec)) {
+            uint32_t end = record_end(offset, rec.size);
+            if (!any || rec.seq >= queue->nextSeq) {
+                queue->nextSeq = rec.seq + 1;
+                queue->tail = end;
+                any = true;
+            }
+            if (rec.state == MIOTYATQUEUE_STATE_QUEUED) {
+                if (!anyQueued || rec.seq < headSeq) {
+                    headSeq = rec.seq;
+                    queue->head = offset;
+                    anyQueued = true;
+                }
+                queue->count++;
+            }
+            offset = end;
+        }
+    }
+
+    // a record cut short by a power cut leaves programmed bytes after the end of the log
+    if (queue->tail % pageSize != 0 && !erased(queue, queue->tail, page_start(queue, queue->tail) + pageSize))
+        queue->tail = next_page(queue, queue->tail);
+    queue->tail %= storage->size;
+    if (queue->count == 0)
+        queue->head = queue->tail;
+    return true;
+}
+
+miotyAtClient_returnCode miotyAtQueue_push(miotyAtQueue * queue, miotyAtCmd_id cmd, uint8_t const * data, uint8_t size) {
+    if (cmd >= MIOTYATCMD_COUNT || !(miotyAtCmd_table[cmd].ops & MIOTYATCMD_OP_SEND))
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    miotyAtQueue_storage const * storage = &queue->storage;
+    uint32_t tail = queue->tail;
+    if (tail % storage->pageSize != 0 && record_end(tail, size) > page_start(queue, tail) + storage->pageSize)
+        tail = next_page(queue, tail);
+    if (tail % storage->pageSize == 0) {
+        // a page is reused once all of its records are sent
+        if (queue->count != 0 && page_start(queue, queue->head) == tail)
+            return MIOTYATCLIENT_RETURN_CODE_BufferSizeInsufficient;
+        if (!storage->erase(storage->user, tail))
+            return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+    }
+    if (queue->count == 0)
+        queue->head = tail;
+    queue->tail = tail;
+
+    uint8_t header[MIOTYATQUEUE_HEADER_SIZE] = {
+        MIOTYATQUEUE_MAGIC & 0xFF, MIOTYATQUEUE_MAGIC >> 8, MIOTYATQUEUE_STATE_QUEUED, cmd, size, 0xFF, 0, 0,
+        (uint8_t)queue->nextSeq, (uint8_t)(queue->nextSeq >> 8), (uint8_t)(queue->nextSeq >> 16), (uint8_t)(queue->nextSeq >> 24),
+    };
+    uint16_t crc = crc16(0xFFFF, header + 8, 4);
+    crc = crc16(crc, header + 3, 2);
+    crc = crc16(crc, data, size);
+    header[6] = (uint8_t)crc;
+    header[7] = (uint8_t)(crc >> 8);
+
+    // payload first, the header makes the record valid
+    if (!storage->program(storage->user, tail + MIOTYATQUEUE_HEADER_SIZE, data, size)
+            || !storage->program(storage->user, tail, header, sizeof(header)))
+        return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+    if (storage->sync != NULL && !storage->sync(storage->user, tail, MIOTYATQUEUE_HEADER_SIZE + size))
+        return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+
+    queue->tail = record_end(tail, size) % storage->size;
+    queue->nextSeq++;
+    queue->count++;
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+miotyAtClient_returnCode miotyAtQueue_drain(miotyAtQueue * queue, miotyAtClient_ctx * ctx, uint32_t nowMs) {
+    while (queue->count != 0) {
+        if (miotyAtBackoff_waiting(&queue->backoff, nowMs))
+            return MIOTYATCLIENT_RETURN_CODE_Busy;
+        record rec;
+        if (!read_record(queue, queue->head, &rec))
+            return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+
+        // sent straight from storage, downlinks of bi-directional commands are discarded
+        uint8_t * payload = (uint8_t *)queue->storage.base + queue->head + MIOTYATQUEUE_HEADER_SIZE;
+        miotyAtClient_returnCode ret = miotyAtClientCtx_send(ctx, (miotyAtCmd_id)rec.cmd, payload, rec.size, NULL, NULL, NULL);
+        if (ret == MIOTYATCLIENT_RETURN_CODE_Busy)
+            return ret;
+        if (ret == MIOTYATCLIENT_RETURN_CODE_OK) {
+            queue->sent++;
+            miotyAtBackoff_reset(&queue->backoff);
+            if (!set_state(queue, MIOTYATQUEUE_STATE_SENT))
+                return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+        } else if (ret == MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch || ret == MIOTYATCLIENT_RETURN_CODE_ArgumentOOR) {
+            queue->dropped++;
+            if (!set_state(queue, MIOTYATQUEUE_STATE_DROPPED))
+                return MIOTYATCLIENT_RETURN_CODE_StorageFailed;
+        } else {
+            queue->retries++;
+            miotyAtBackoff_failed(&queue->backoff, nowMs);
+            return ret;
+        }
+        advance_head(queue);
+    }
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+// checks magic, bounds and CRC of the record at offset
+static bool read_record(miotyAtQueue const * queue, uint32_t offset, record * rec) {
+    uint8_t const * header = queue->storage.base + offset;
+    uint32_t pageEnd = page_start(queue, offset) + queue->storage.pageSize;
+    if (offset + MIOTYATQUEUE_HEADER_SIZE > pageEnd || get_u16(header) != MIOTYATQUEUE_MAGIC)
+        return false;
+    rec->state = header[2];
+    rec->cmd = header[3];
+    rec->size = header[4];
+    rec->seq = get_u32(header + 8);
+    if (record_end(offset, rec->size) > pageEnd || rec->cmd >= MIOTYATCMD_COUNT)
+        return false;
+    uint16_t crc = crc16(0xFFFF, header + 8, 4);
+    crc = crc16(crc, header + 3, 2);
+    crc = crc16(crc, header + MIOTYATQUEUE_HEADER_SIZE, rec->size);
+    return crc == get_u16(header + 6);
+}
+
+static uint32_t record_end(uint32_t offset, uint8_t size) {
+    return offset + ALIGN_UP(MIOTYATQUEUE_HEADER_SIZE + (uint32_t)size);
+}
+
+static uint32_t page_start(miotyAtQueue const * queue, uint32_t offset) {
+    return offset - offset % queue->storage.pageSize;
+}
+
+static uint32_t next_page(miotyAtQueue const * queue, uint32_t offset) {
+    return (page_start(queue, offset) + queue->storage.pageSize) % queue->storage.size;
+}
+
+static bool erased(miotyAtQueue const * queue, uint32_t offset, uint32_t end) {
+    for (; offset < end; offset++) {
+        if (queue->storage.base[offset] != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+static bool set_state(miotyAtQueue * queue, uint8_t state) {
+    miotyAtQueue_storage const * storage = &queue->storage;
+    if (!storage->program(storage->user, queue->head + 2, &state, 1))
+        return false;
+    return storage->sync == NULL || storage->sync(storage->user, queue->head + 2, 1);
+}
+
+// moves head to the next record, which starts the next page if this one has no more
+static void advance_head(miotyAtQueue * queue) {
+    record rec;
+    read_record(queue, queue->head, &rec);
+    uint32_t next = record_end(queue->head, rec.size) % queue->storage.size;
+    if (next != queue->tail && (next % queue->storage.pageSize == 0 || !read_record(queue, next, &rec)))
+        next = next_page(queue, queue->head);
+    queue->head = next;
+    queue->count--;
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t const * data, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t get_u16(uint8_t const * src) {
+    return src[0] | (uint16_t)src[1] << 8;
+}
+
+static uint32_t get_u32(uint8_t const * src) {
+    return src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
@@ -0,0 +1,134 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Persistent store-and-forward queue of uplinks
+ *
+ * Uplinks are appended to a log in persistent storage and sent in order by miotyAtQueue_drain(). A failed
+ * uplink stays at the head of the queue and is retried with exponential backoff, so nothing is lost while the
+ * node is detached or out of coverage, and nothing is lost or reordered by a crash or power cut either.
+ *
+ * The storage is split into pages that are erased as a whole, records never cross a page. It has to be
+ * readable through a pointer (a memory mapped file, or flash on most MCUs), so uplinks are sent straight
+ * from storage without copying them. Writes go through the program hook, which may only clear bits of
+ * erased bytes, as NOR flash does. miotyAtQueueFile.h provides storage on a memory mapped file for Linux.
+ *
+ * Record layout, aligned to MIOTYATQUEUE_ALIGN bytes:
+ *
+ *     magic (2)    MIOTYATQUEUE_MAGIC, little endian
+ *     state (1)    MIOTYATQUEUE_STATE_*, bits are only cleared
+ *     cmd (1)      sending command, miotyAtCmd_id
+ *     size (1)     payload size
+ *     reserved (1)
+ *     crc (2)      CRC-16/CCITT of seq, cmd, size and payload, little endian
+ *     seq (4)      sequence number, little endian
+ *     payload
+ *
+ * A record is valid once its header is written after the payload, so a record cut short by a power cut
+ * fails its CRC and is ignored. miotyAtQueue_open() scans the record headers of all pages once to find the
+ * oldest unsent record and the end of the log.
+ */
+
+#ifndef _AT_QUEUE_H
+#define _AT_QUEUE_H
+
+#include "miotyAtClient.h"
+#include "miotyAtBackoff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATQUEUE_MAGIC          0x514D
+#define MIOTYATQUEUE_HEADER_SIZE    12
+#define MIOTYATQUEUE_ALIGN          4
+
+#define MIOTYATQUEUE_STATE_QUEUED   0xFE
+#define MIOTYATQUEUE_STATE_SENT     0xFC
+#define MIOTYATQUEUE_STATE_DROPPED  0xF8    // failed with an error that a retry won't fix
+
+typedef struct miotyAtQueue_storage {
+    uint8_t const * base;       // storage contents
+    uint32_t size;              // multiple of pageSize
+    uint32_t pageSize;          // multiple of MIOTYATQUEUE_ALIGN, at least one largest record
+    bool (*program)(void * user, uint32_t offset, void const * data, uint32_t size);
+    bool (*erase)(void * user, uint32_t offset);            // sets the page at offset to 0xFF
+    bool (*sync)(void * user, uint32_t offset, uint32_t size);  // makes writes durable, may be NULL
+    void * user;
+} miotyAtQueue_storage;
+
+typedef struct miotyAtQueue {
+    miotyAtQueue_storage storage;
+    uint32_t head;              // offset of the oldest queued record, equals tail if the queue is empty
+    uint32_t tail;              // offset of the next record
+    uint32_t nextSeq;
+    uint32_t count;             // queued records
+    miotyAtBackoff backoff;     // of the uplink at the head
+    // statistics
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t retries;
+} miotyAtQueue;
+
+/**
+ * @brief Open the queue on storage and recover its contents
+ *
+ * Erased storage is an empty queue.
+ *
+ * @return false if the geometry of storage is invalid or an erase failed
+ */
+bool miotyAtQueue_open(miotyAtQueue * queue, miotyAtQueue_storage const * storage);
+
+/**
+ * @brief Append an uplink of cmd (e.g. MIOTYATCMD_UMPF) to the queue
+ *
+ * @return ArgumentOOR if cmd can't send, BufferSizeInsufficient if the queue is full,
+ *         StorageFailed if the storage can't be written
+ */
+miotyAtClient_returnCode miotyAtQueue_push(miotyAtQueue * queue, miotyAtCmd_id cmd, uint8_t const * data, uint8_t size);
+
+/**
+ * @brief Send queued uplinks in order until the queue is empty or one fails (blocking)
+ *
+ * A failed uplink is retried by a later call once its backoff elapsed. Uplinks failing with
+ * ArgumentSizeMismatch or ArgumentOOR are dropped, a retry would fail again.
+ *
+ * @return OK if the queue is empty, Busy while the backoff runs, StorageFailed if a record can't be read
+ *         or marked, otherwise the error of the failed uplink
+ */
+miotyAtClient_returnCode miotyAtQueue_drain(miotyAtQueue * queue, miotyAtClient_ctx * ctx, uint32_t nowMs);
+
+/**
+ * @brief Number of queued uplinks
+ */
+static inline uint32_t miotyAtQueue_pending(miotyAtQueue const * queue) {
+    return queue->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Storage of miotyAtQueue on a memory mapped file for Linux hosts
+ */
+
+#if defined(__linux__)
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "miotyAtQueueFile.h"
+
+static bool file_program(void * user, uint32_t offset, void const * data, uint32_t size);
+static bool file_erase(void * user, uint32_t offset);
+static bool file_sync(void * user, uint32_t offset, uint32_t size);
+
+
+bool miotyAtQueueFile_open(miotyAtQueueFile * file, char const * path, uint32_t size, uint32_t pageSize, bool durable, miotyAtQueue_storage * storage) {
+    memset(file, 0, sizeof(*file));
+    file->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file->fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(file->fd, &st) != 0)
+        goto fail;
+    bool created = st.st_size == 0;
+    if (!created && st.st_size != (off_t)size) {
+        errno = EINVAL;
+        goto fail;
+    }
+    if (created && ftruncate(file->fd, size) != 0)
+        goto fail;
+    file->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (file->map == MAP_FAILED) {
+        file->map = NULL;
+        goto fail;
+    }
+    file->size = size;
+    file->pageSize = pageSize;
+    file->durable = durable;
+    if (created) {
+        memset(file->map, 0xFF, size);
+        file_sync(file, 0, size);
+    }
+
+    storage->base = file->map;
+    storage->size = size;
+    storage->pageSize = pageSize;
+    storage->program = file_program;
+    storage->erase = file_erase;
+    storage->sync = durable ? file_sync : NULL;
+    storage->user = file;
+    return true;
+
+fail:
+    close(file->fd);
+    file->fd = -1;
+    return false;
+}
+
+void miotyAtQueueFile_close(miotyAtQueueFile * file) {
+    if (file->map != NULL)
+        munmap(file->map, file->size);
+    if (file->fd >= 0)
+        close(file->fd);
+    file->map = NULL;
+    file->fd = -1;
+}
+
+// the same as programming flash: bits are only cleared
+static bool file_program(void * user, uint32_t offset, void const * data, uint32_t size) {
+    miotyAtQueueFile * file = user;
+    uint8_t const * src = data;
+    for (uint32_t i = 0; i < size; i++)
+        file->map[offset + i] &= src[i];
+    return true;
+}
+
+static bool file_erase(void * user, uint32_t offset) {
+    miotyAtQueueFile * file = user;
+    memset(file->map + offset, 0xFF, file->pageSize);
+    return file->durable ? file_sync(file, offset, file->pageSize) : true;
+}
+
+static bool file_sync(void * user, uint32_t offset, uint32_t size) {
+    miotyAtQueueFile * file = user;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uint32_t start = offset - offset % pageSize;
+    return msync(file->map + start, offset + size - start, MS_SYNC) == 0;
+}
+
+#endif
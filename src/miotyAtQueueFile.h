@@ -0,0 +1,74 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Storage of miotyAtQueue on a memory mapped file for Linux hosts
+ *
+ * The file is mapped shared, so records survive a crash of the process as soon as they are written.
+ * With durable set, every write is also flushed to the disk with msync() before it returns, so they
+ * survive a power cut as well.
+ *
+ * Only compiled on Linux.
+ */
+
+#ifndef _AT_QUEUE_FILE_H
+#define _AT_QUEUE_FILE_H
+
+#include "miotyAtQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct miotyAtQueueFile {
+    int fd;
+    uint8_t * map;
+    uint32_t size;
+    uint32_t pageSize;
+    bool durable;
+} miotyAtQueueFile;
+
+/**
+ * @brief Open or create the queue file at path with size bytes and fill storage for miotyAtQueue_open()
+ *
+ * A new file is created erased, an existing file keeps its contents and must have the same size.
+ *
+ * @param[in]   pageSize    Size of the pages erased at once, e.g. 4096
+ * @param[in]   durable     Flush every write to the disk
+ *
+ * @return false if the file can't be opened or mapped, errno tells why
+ */
+bool miotyAtQueueFile_open(miotyAtQueueFile * file, char const * path, uint32_t size, uint32_t pageSize, bool durable, miotyAtQueue_storage * storage);
+
+/**
+ * @brief Unmap and close the file, the queue using it must not be used anymore
+ */
+void miotyAtQueueFile_close(miotyAtQueueFile * file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Duty-cycle aware uplink scheduler with priority classes, deadlines and coalescing
+ */
+
+#include "miotyAtScheduler.h"
+
+#define AIRTIME_BASE(profile, baseMs, perByteUs)    [profile] = baseMs,
+#define AIRTIME_PER_BYTE(profile, baseMs, perByteUs)    [profile] = perByteUs,
+
+static uint16_t const airtimeBaseMs[] = { MIOTYATSCHEDULER_AIRTIME_TABLE(AIRTIME_BASE) };
+static uint16_t const airtimePerByteUs[] = { MIOTYATSCHEDULER_AIRTIME_TABLE(AIRTIME_PER_BYTE) };
+static uint8_t const modePercent[] = MIOTYATSCHEDULER_MODE_PERCENT;
+
+#define PROFILES    (sizeof(airtimeBaseMs) / sizeof(airtimeBaseMs[0]))
+#define MODES       (sizeof(modePercent) / sizeof(modePercent[0]))
+
+static bool is_uplink(miotyAtCmd_id cmd);
+static bool is_bidi(miotyAtCmd_id cmd);
+static bool transmitted(miotyAtClient_result const * result);
+static void refill(miotyAtScheduler * sched, uint32_t nowMs);
+static void finish(miotyAtScheduler * sched, miotyAtScheduler_msg * msg, miotyAtScheduler_status status, miotyAtClient_result const * result);
+static miotyAtScheduler_msg * next_msg(miotyAtScheduler * sched);
+static uint32_t expire(miotyAtScheduler * sched, uint32_t nowMs);
+static void on_complete(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser);
+
+
+void miotyAtScheduler_init(miotyAtScheduler * sched, miotyAtClient_ctx * ctx, uint16_t dutyPermille, uint32_t windowMs, uint32_t nowMs) {
+    memset(sched, 0, sizeof(*sched));
+    sched->ctx = ctx;
+    sched->dutyPermille = dutyPermille;
+    sched->capacityUs = (uint64_t)windowMs * dutyPermille > UINT32_MAX ? UINT32_MAX : windowMs * dutyPermille;
+    sched->creditUs = sched->capacityUs;
+    sched->lastMs = nowMs;
+}
+
+void miotyAtScheduler_setProfile(miotyAtScheduler * sched, uint8_t profile, uint8_t mode) {
+    sched->profile = profile;
+    sched->mode = mode;
+}
+
+uint32_t miotyAtScheduler_airtimeUs(uint8_t profile, uint8_t mode, uint8_t size) {
+    if (profile >= PROFILES)
+        profile = 0;
+    uint32_t airtime = airtimeBaseMs[profile] * 1000UL + airtimePerByteUs[profile] * (uint32_t)size;
+    return mode < MODES ? airtime / 100 * modePercent[mode] : airtime;
+}
+
+miotyAtClient_returnCode miotyAtScheduler_enqueue(miotyAtScheduler * sched, miotyAtCmd_id cmd, miotyAtScheduler_priority priority, uint16_t key, uint8_t const * data, uint8_t size, uint32_t maxDelayMs, miotyAtScheduler_cb cb, void * cbUser, uint32_t nowMs) {
+    if (!is_uplink(cmd) || priority >= MIOTYATSCHEDULER_PRIOS)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (size > MIOTYATSCHEDULER_PAYLOAD_SIZE)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+
+    miotyAtScheduler_msg * msg = NULL;
+    miotyAtScheduler_msg * superseded = NULL;
+    for (uint8_t i = 0; i < MIOTYATSCHEDULER_QUEUE_SIZE; i++) {
+        miotyAtScheduler_msg * m = &sched->queue[i];
+        if (m->used && key != 0 && m->key == key && m != sched->inFlight)
+            superseded = m;
+        else if (!m->used && msg == NULL)
+            msg = m;
+    }
+    miotyAtScheduler_cb supersededCb = NULL;
+    void * supersededUser = NULL;
+    if (superseded != NULL) {
+        // the new message takes over slot and place in line (seq) of the old one, whose callback runs once
+        // the slot is filled, as it may enqueue again
+        supersededCb = superseded->cb;
+        supersededUser = superseded->cbUser;
+        sched->superseded++;
+        msg = superseded;
+    } else if (msg == NULL) {
+        return MIOTYATCLIENT_RETURN_CODE_Busy;
+    } else {
+        msg->seq = sched->seq++;
+    }
+
+    msg->used = true;
+    msg->cmd = cmd;
+    msg->priority = priority;
+    msg->key = key;
+    msg->hasDeadline = maxDelayMs != 0;
+    msg->deadlineMs = nowMs + maxDelayMs;
+    msg->airtimeUs = miotyAtScheduler_airtimeUs(sched->profile, sched->mode, size);
+    msg->cb = cb;
+    msg->cbUser = cbUser;
+    msg->size = size;
+    memcpy(msg->data, data, size);
+    if (supersededCb != NULL)
+        supersededCb(sched, MIOTYATSCHEDULER_SUPERSEDED, NULL, supersededUser);
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+uint32_t miotyAtScheduler_run(miotyAtScheduler * sched, uint32_t nowMs) {
+    refill(sched, nowMs);
+    uint32_t waitMs = expire(sched, nowMs);
+    if (sched->inFlight != NULL)
+        return waitMs;
+
+    miotyAtScheduler_msg * msg = next_msg(sched);
+    if (msg == NULL)
+        return waitMs;
+    // a message longer than the whole budget goes out once the bucket is full
+    uint32_t requiredUs = msg->airtimeUs < sched->capacityUs ? msg->airtimeUs : sched->capacityUs;
+    if (sched->dutyPermille != 0 && sched->creditUs < requiredUs) {
+        uint32_t budgetMs = (requiredUs - sched->creditUs + sched->dutyPermille - 1) / sched->dutyPermille;
+        return budgetMs < waitMs ? budgetMs : waitMs;
+    }
+
+    // set before submitting, a transport may complete the command right away
+    sched->inFlight = msg;
+    miotyAtClient_returnCode rc = miotyAtClientCtx_sendAsync(sched->ctx, msg->cmd, msg->data, msg->size,
+            is_bidi(msg->cmd) ? sched->downlink : NULL, sizeof(sched->downlink), on_complete, sched, NULL);
+    if (rc == MIOTYATCLIENT_RETURN_CODE_Busy) {
+        // another command is pending on the context, try again after it
+        sched->inFlight = NULL;
+        return 1;
+    }
+    if (rc != MIOTYATCLIENT_RETURN_CODE_OK) {
+        miotyAtClient_result result = { .returnCode = rc };
+        sched->inFlight = NULL;
+        finish(sched, msg, MIOTYATSCHEDULER_SENT, &result);
+        return 0;
+    }
+    return waitMs;
+}
+
+uint8_t miotyAtScheduler_pending(miotyAtScheduler const * sched) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MIOTYATSCHEDULER_QUEUE_SIZE; i++)
+        count += sched->queue[i].used;
+    return count;
+}
+
+static bool is_uplink(miotyAtCmd_id cmd) {
+    return cmd == MIOTYATCMD_U || cmd == MIOTYATCMD_UMPF || cmd == MIOTYATCMD_TU || is_bidi(cmd);
+}
+
+static bool is_bidi(miotyAtCmd_id cmd) {
+    return cmd == MIOTYATCMD_B || cmd == MIOTYATCMD_BMPF || cmd == MIOTYATCMD_TB;
+}
+
+// token bucket, refilled by dutyPermille us of airtime per ms
+static void refill(miotyAtScheduler * sched, uint32_t nowMs) {
+    uint64_t credit = sched->creditUs + (uint64_t)(nowMs - sched->lastMs) * sched->dutyPermille;
+    sched->creditUs = credit > sched->capacityUs ? sched->capacityUs : credit;
+    sched->lastMs = nowMs;
+}
+
+// frees msg before invoking its callback, which may enqueue again
+static void finish(miotyAtScheduler * sched, miotyAtScheduler_msg * msg, miotyAtScheduler_status status, miotyAtClient_result const * result) {
+    miotyAtScheduler_cb cb = msg->cb;
+    void * cbUser = msg->cbUser;
+    msg->used = false;
+    if (status == MIOTYATSCHEDULER_EXPIRED)
+        sched->expired++;
+    else if (status == MIOTYATSCHEDULER_SUPERSEDED)
+        sched->superseded++;
+    if (cb != NULL)
+        cb(sched, status, result, cbUser);
+}
+
+// highest priority, then earliest deadline, then oldest
+static miotyAtScheduler_msg * next_msg(miotyAtScheduler * sched) {
+    miotyAtScheduler_msg * best = NULL;
+    for (uint8_t i = 0; i < MIOTYATSCHEDULER_QUEUE_SIZE; i++) {
+        miotyAtScheduler_msg * m = &sched->queue[i];
+        if (!m->used || m == sched->inFlight)
+            continue;
+        if (best == NULL || m->priority < best->priority) {
+            best = m;
+            continue;
+        }
+        if (m->priority != best->priority)
+            continue;
+        if (m->hasDeadline != best->hasDeadline) {
+            if (m->hasDeadline)
+                best = m;
+            continue;
+        }
+        int32_t d = m->hasDeadline ? (int32_t)(m->deadlineMs - best->deadlineMs) : 0;
+        if (d < 0 || (d == 0 && (int32_t)(m->seq - best->seq) < 0))
+            best = m;
+    }
+    return best;
+}
+
+// drops queued messages past their deadline, returns ms until the next deadline
+static uint32_t expire(miotyAtScheduler * sched, uint32_t nowMs) {
+    uint32_t waitMs = UINT32_MAX;
+    for (uint8_t i = 0; i < MIOTYATSCHEDULER_QUEUE_SIZE; i++) {
+        miotyAtScheduler_msg * m = &sched->queue[i];
+        if (!m->used || !m->hasDeadline || m == sched->inFlight)
+            continue;
+        int32_t left = (int32_t)(m->deadlineMs - nowMs);
+        if (left <= 0)
+            finish(sched, m, MIOTYATSCHEDULER_EXPIRED, NULL);
+        else if ((uint32_t)left < waitMs)
+            waitMs = left;
+    }
+    return waitMs;
+}
+
+// the modem may have gone on air, a command without an answer counts as sent
+static bool transmitted(miotyAtClient_result const * result) {
+    switch (result->returnCode) {
+    case MIOTYATCLIENT_RETURN_CODE_OK:
+    case MIOTYATCLIENT_RETURN_CODE_MacDownlinkNotAvailable:
+    case MIOTYATCLIENT_RETURN_CODE_MacNoDownlinkReceived:
+    case MIOTYATCLIENT_RETURN_CODE_MacDownlinkErr:
+    case MIOTYATCLIENT_RETURN_CODE_ATReadFailed:
+    case MIOTYATCLIENT_RETURN_CODE_Timeout:
+        return true;
+    default:
+        return result->hasPacketCounter;
+    }
+}
+
+static void on_complete(miotyAtClient_ctx * ctx, miotyAtClient_result const * result, void * cbUser) {
+    (void)ctx;
+    miotyAtScheduler * sched = cbUser;
+    miotyAtScheduler_msg * msg = sched->inFlight;
+    sched->inFlight = NULL;
+    if (msg == NULL)
+        return;
+    if (transmitted(result)) {
+        sched->creditUs = sched->creditUs > msg->airtimeUs ? sched->creditUs - msg->airtimeUs : 0;
+        sched->airtimeUs += msg->airtimeUs;
+        sched->sent++;
+    }
+    finish(sched, msg, MIOTYATSCHEDULER_SENT, result);
+}
@@ -0,0 +1,179 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Duty-cycle aware uplink scheduler with priority classes, deadlines and coalescing
+ *
+ * Uplinks are queued instead of sent right away. Whenever miotyAtScheduler_run() is called, the best queued
+ * message is submitted with the async API if the airtime budget of the modem allows it: highest priority
+ * first, then earliest deadline, then oldest. The budget is a token bucket refilled at the duty cycle, e.g.
+ * 10 permille of a one hour window. Airtime per message is estimated from payload size, uplink profile and
+ * uplink mode with MIOTYATSCHEDULER_AIRTIME_TABLE, whose defaults are placeholders to be calibrated.
+ *
+ * Messages whose deadline passes while queued are dropped, a message enqueued with the key of a queued one
+ * replaces it. Time is passed in by the caller, so the scheduler runs on a simulated clock as well.
+ */
+
+#ifndef _AT_SCHEDULER_H
+#define _AT_SCHEDULER_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MIOTYATSCHEDULER_QUEUE_SIZE
+#define MIOTYATSCHEDULER_QUEUE_SIZE     8
+#endif
+
+// longest payload of a queued message
+#ifndef MIOTYATSCHEDULER_PAYLOAD_SIZE
+#define MIOTYATSCHEDULER_PAYLOAD_SIZE   64
+#endif
+
+/*
+ * Estimated radio airtime per uplink profile: X(profile, base ms, us per payload byte).
+ *
+ * The defaults are placeholders, not measured TS-UNB values: every profile uses the same rough figure for a
+ * short telegram split into about 24 radio bursts of 15 ms. Override the table with values calibrated against
+ * the modem firmware and region in use before relying on the duty cycle budget.
+ */
+#ifndef MIOTYATSCHEDULER_AIRTIME_TABLE
+#define MIOTYATSCHEDULER_AIRTIME_TABLE(X) \
+    X(0, 330, 3000)     /* EU0 */ \
+    X(1, 330, 3000)     /* EU1 */ \
+    X(2, 330, 3000)     /* EU2 */ \
+    X(3, 330, 3000)     /* US0 */
+#endif
+
+// airtime of uplink modes 0, 1, 2 in percent of the profile estimate, placeholders that treat all modes alike
+#ifndef MIOTYATSCHEDULER_MODE_PERCENT
+#define MIOTYATSCHEDULER_MODE_PERCENT   { 100, 100, 100 }
+#endif
+
+typedef enum miotyAtScheduler_priority {
+    MIOTYATSCHEDULER_PRIO_HIGH,
+    MIOTYATSCHEDULER_PRIO_NORMAL,
+    MIOTYATSCHEDULER_PRIO_LOW,
+    MIOTYATSCHEDULER_PRIOS,
+} miotyAtScheduler_priority;
+
+typedef enum miotyAtScheduler_status {
+    MIOTYATSCHEDULER_SENT,          // submitted to the modem, result holds the outcome
+    MIOTYATSCHEDULER_EXPIRED,       // deadline passed while queued
+    MIOTYATSCHEDULER_SUPERSEDED,    // replaced by a newer message with the same key
+} miotyAtScheduler_status;
+
+typedef struct miotyAtScheduler miotyAtScheduler;
+
+/**
+ * @brief Called once per enqueued message, result is NULL unless status is MIOTYATSCHEDULER_SENT
+ */
+typedef void (*miotyAtScheduler_cb)(miotyAtScheduler * sched, miotyAtScheduler_status status, miotyAtClient_result const * result, void * cbUser);
+
+typedef struct miotyAtScheduler_msg {
+    bool used;
+    uint8_t cmd;                // MIOTYATCMD_U, B, UMPF, BMPF, TU or TB
+    uint8_t priority;
+    uint16_t key;               // 0 never coalesces
+    bool hasDeadline;
+    uint32_t deadlineMs;
+    uint32_t seq;
+    uint32_t airtimeUs;
+    miotyAtScheduler_cb cb;
+    void * cbUser;
+    uint8_t size;
+    uint8_t data[MIOTYATSCHEDULER_PAYLOAD_SIZE];
+} miotyAtScheduler_msg;
+
+struct miotyAtScheduler {
+    miotyAtClient_ctx * ctx;
+    uint16_t dutyPermille;
+    uint32_t creditUs;          // airtime that may be spent right now
+    uint32_t capacityUs;        // credit of a full window
+    uint32_t lastMs;            // time of the last refill
+    uint8_t profile;
+    uint8_t mode;
+    uint32_t seq;
+    miotyAtScheduler_msg * inFlight;
+    miotyAtScheduler_msg queue[MIOTYATSCHEDULER_QUEUE_SIZE];
+    uint8_t downlink[255];
+    // statistics
+    uint32_t sent;              // messages the modem transmitted or may have (no answer), charged to the budget
+    uint32_t expired;
+    uint32_t superseded;
+    uint64_t airtimeUs;         // estimated airtime of all sent messages
+};
+
+/**
+ * @brief Initialize sched for the modem of ctx
+ *
+ * @param[in]   dutyPermille    Allowed duty cycle, e.g. 10 for 1 %, 0 for no limit
+ * @param[in]   windowMs        Window the duty cycle refers to, the budget never exceeds dutyPermille of it
+ * @param[in]   nowMs           Current time, the budget starts full
+ */
+void miotyAtScheduler_init(miotyAtScheduler * sched, miotyAtClient_ctx * ctx, uint16_t dutyPermille, uint32_t windowMs, uint32_t nowMs);
+
+/**
+ * @brief Set uplink profile and mode used for the airtime estimate, as configured with AT-UP and AT-UM
+ */
+void miotyAtScheduler_setProfile(miotyAtScheduler * sched, uint8_t profile, uint8_t mode);
+
+/**
+ * @brief Estimated airtime in us of an uplink with size bytes of payload
+ */
+uint32_t miotyAtScheduler_airtimeUs(uint8_t profile, uint8_t mode, uint8_t size);
+
+/**
+ * @brief Queue a message, the payload is copied
+ *
+ * @param[in]   cmd         Uplink command, MIOTYATCMD_U, B, UMPF, BMPF, TU or TB
+ * @param[in]   key         Non-zero to replace a queued message with the same key
+ * @param[in]   maxDelayMs  Drop the message if it can't be sent within this time, 0 for no deadline
+ *
+ * @return MIOTYATCLIENT_RETURN_CODE_Busy if the queue is full, ArgumentSizeMismatch/ArgumentOOR for invalid messages
+ */
+miotyAtClient_returnCode miotyAtScheduler_enqueue(miotyAtScheduler * sched, miotyAtCmd_id cmd, miotyAtScheduler_priority priority, uint16_t key, uint8_t const * data, uint8_t size, uint32_t maxDelayMs, miotyAtScheduler_cb cb, void * cbUser, uint32_t nowMs);
+
+/**
+ * @brief Drop expired messages and submit the next one if the modem is idle and the budget allows it
+ *
+ * The response is processed through ctx as for any async command (miotyAtClientCtx_poll() or _feed()).
+ *
+ * @return ms until the scheduler needs to run again without new input, UINT32_MAX if nothing is waiting
+ */
+uint32_t miotyAtScheduler_run(miotyAtScheduler * sched, uint32_t nowMs);
+
+/**
+ * @brief Number of queued messages, including the one in flight
+ */
+uint8_t miotyAtScheduler_pending(miotyAtScheduler const * sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
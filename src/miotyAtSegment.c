@@ -0,0 +1,127 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Segmentation of large payloads into uplinks and reassembly of multi-part downlinks
+ */
+
+#include "miotyAtSegment.h"
+#include "miotyAtCommands.h"
+
+
+miotyAtClient_returnCode miotyAtSegmentTx_start(miotyAtSegmentTx * tx, miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t const * data, size_t size, uint8_t maxPayload, uint8_t msgId, miotyAtSegmentRx * rx) {
+    if (cmd >= MIOTYATCMD_COUNT || !(miotyAtCmd_table[cmd].ops & MIOTYATCMD_OP_SEND) || miotyAtCmd_table[cmd].size != 0)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    uint8_t mpf = (cmd == MIOTYATCMD_UMPF || cmd == MIOTYATCMD_BMPF) ? 1 : 0;
+    if (maxPayload <= mpf + MIOTYATSEGMENT_HEADER_SIZE)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentOOR;
+    if (size < mpf)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+    uint8_t segmentSize = maxPayload - mpf - MIOTYATSEGMENT_HEADER_SIZE;
+    size -= mpf;
+    size_t count = size == 0 ? 1 : (size + segmentSize - 1) / segmentSize;
+    if (count > MIOTYATSEGMENT_MAX_COUNT)
+        return MIOTYATCLIENT_RETURN_CODE_ArgumentSizeMismatch;
+
+    memset(tx, 0, sizeof(*tx));
+    tx->ctx = ctx;
+    tx->cmd = cmd;
+    tx->data = data;
+    tx->size = size;
+    tx->segmentSize = segmentSize;
+    tx->count = (uint8_t)count;
+    tx->msgId = msgId;
+    tx->mpf = mpf;
+    tx->rx = rx;
+    if (rx != NULL)
+        rx->mpf = mpf != 0;
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+miotyAtClient_returnCode miotyAtSegmentTx_send(miotyAtSegmentTx * tx) {
+    while (tx->next < tx->count) {
+        size_t offset = (size_t)tx->next * tx->segmentSize;
+        uint8_t len = tx->size - offset < tx->segmentSize ? (uint8_t)(tx->size - offset) : tx->segmentSize;
+        uint8_t * header = tx->uplink + tx->mpf;
+        if (tx->mpf)
+            tx->uplink[0] = tx->data[0];
+        header[0] = tx->msgId;
+        header[1] = tx->next | (tx->next + 1 == tx->count ? MIOTYATSEGMENT_LAST : 0);
+        memcpy(header + MIOTYATSEGMENT_HEADER_SIZE, tx->data + tx->mpf + offset, len);
+
+        uint8_t sizeDownlink = sizeof(tx->downlink);
+        miotyAtClient_returnCode ret = miotyAtClientCtx_send(tx->ctx, tx->cmd, tx->uplink, tx->mpf + MIOTYATSEGMENT_HEADER_SIZE + len,
+                tx->rx != NULL ? tx->downlink : NULL, &sizeDownlink, NULL);
+        if (ret != MIOTYATCLIENT_RETURN_CODE_OK)
+            return ret;
+        tx->next++;
+        if (tx->rx != NULL && sizeDownlink != 0)
+            miotyAtSegmentRx_feed(tx->rx, tx->downlink, sizeDownlink);
+    }
+    return MIOTYATCLIENT_RETURN_CODE_OK;
+}
+
+void miotyAtSegmentRx_init(miotyAtSegmentRx * rx, uint8_t * buf, size_t cap) {
+    memset(rx, 0, sizeof(*rx));
+    rx->buf = buf;
+    rx->cap = cap;
+}
+
+miotyAtSegment_status miotyAtSegmentRx_feed(miotyAtSegmentRx * rx, uint8_t const * segment, uint8_t size) {
+    if (rx->mpf) {
+        if (size == 0)
+            return MIOTYATSEGMENT_ERROR;
+        rx->mpfField = segment[0];
+        segment++;
+        size--;
+    }
+    if (size < MIOTYATSEGMENT_HEADER_SIZE)
+        return MIOTYATSEGMENT_ERROR;
+    uint8_t msgId = segment[0];
+    uint8_t index = segment[1] & ~MIOTYATSEGMENT_LAST;
+    bool last = segment[1] & MIOTYATSEGMENT_LAST;
+    uint8_t len = size - MIOTYATSEGMENT_HEADER_SIZE;
+
+    bool same = rx->next != 0 && msgId == rx->msgId;
+    if (same && index < rx->next)
+        return MIOTYATSEGMENT_INCOMPLETE;   // repeated segment
+    if (!same || rx->complete) {
+        // start of a new message, drops an incomplete one
+        rx->msgId = msgId;
+        rx->next = 0;
+        rx->len = 0;
+        rx->complete = false;
+    }
+    if (index != rx->next || rx->len + len > rx->cap) {
+        rx->next = 0;
+        rx->len = 0;
+        return MIOTYATSEGMENT_ERROR;
+    }
+    memcpy(rx->buf + rx->len, segment + MIOTYATSEGMENT_HEADER_SIZE, len);
+    rx->len += len;
+    rx->next++;
+    rx->complete = last;
+    return last ? MIOTYATSEGMENT_COMPLETE : MIOTYATSEGMENT_INCOMPLETE;
+}
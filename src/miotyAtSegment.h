@@ -0,0 +1,138 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Segmentation of large payloads into uplinks and reassembly of multi-part downlinks
+ *
+ * A payload of up to MIOTYATSEGMENT_MAX_COUNT segments is sent as a sequence of uplinks with one of the
+ * sending commands (AT-U, AT-UMPF, AT-B, ...), each carrying a header followed by its part of the payload:
+ *
+ *     byte 0  message id, the same for all segments of one payload
+ *     byte 1  bit 7: last segment, bits 0-6: segment index
+ *
+ * With AT-UMPF and AT-BMPF byte 0 of every message is the MPF field. Byte 0 of the payload is taken as the
+ * MPF field of all segments, the header and the segment's part of the rest of the payload follow it. Downlinks
+ * of AT-BMPF are expected in the same layout.
+ *
+ * The sender only keeps a pointer to the payload and one uplink, so memory does not grow with the payload size.
+ * If an uplink fails, miotyAtSegmentTx_send() returns its error and a later call resumes with that segment.
+ * Downlinks of bi-directional commands are passed to an optional miotyAtSegmentRx, which reassembles
+ * segments in the same format into a caller provided buffer.
+ */
+
+#ifndef _AT_SEGMENT_H
+#define _AT_SEGMENT_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIOTYATSEGMENT_HEADER_SIZE  2
+#define MIOTYATSEGMENT_MAX_COUNT    128
+#define MIOTYATSEGMENT_LAST         0x80
+
+typedef enum miotyAtSegment_status {
+    MIOTYATSEGMENT_INCOMPLETE,  // more segments are expected
+    MIOTYATSEGMENT_COMPLETE,    // the last segment arrived, the message is in buf
+    MIOTYATSEGMENT_ERROR,       // missing segment or message too large, the message was dropped
+} miotyAtSegment_status;
+
+typedef struct miotyAtSegmentRx {
+    uint8_t * buf;
+    size_t cap;
+    size_t len;                 // bytes reassembled so far
+    uint8_t msgId;
+    uint8_t next;               // index of the next expected segment, 0: waiting for a new message
+    bool complete;              // the last segment of msgId arrived
+    bool mpf;                   // segments start with an MPF field, set by miotyAtSegmentTx_start() for MPF commands
+    uint8_t mpfField;           // MPF field of the last added segment
+} miotyAtSegmentRx;
+
+typedef struct miotyAtSegmentTx {
+    miotyAtClient_ctx * ctx;
+    miotyAtCmd_id cmd;
+    uint8_t const * data;
+    size_t size;                // without the MPF field
+    uint8_t segmentSize;        // payload bytes per segment, without header
+    uint8_t count;              // segments of the message
+    uint8_t next;               // index of the next segment to send
+    uint8_t msgId;
+    uint8_t mpf;                // 1 if every segment starts with the MPF field of the payload, else 0
+    miotyAtSegmentRx * rx;      // reassembly of downlinks, NULL for uni-directional commands
+    uint8_t uplink[255];
+    uint8_t downlink[255];
+} miotyAtSegmentTx;
+
+/**
+ * @brief Prepare sending size bytes of data in segments with cmd, nothing is sent yet
+ *
+ * data has to stay valid until all segments are sent.
+ *
+ * @param[in]   cmd             Sending command, e.g. MIOTYATCMD_UMPF
+ * @param[in]   data            Payload, for MPF commands starting with the MPF field
+ * @param[in]   maxPayload      Largest uplink payload including the header (and the MPF field)
+ * @param[in]   msgId           Message id, should differ from the previous message
+ * @param[in]   rx              Reassembly of downlinks, only for bi-directional commands, may be NULL
+ *
+ * @return ArgumentOOR if cmd can't send, ArgumentSizeMismatch if data needs more than MIOTYATSEGMENT_MAX_COUNT segments
+ *         or lacks the MPF field of an MPF command
+ */
+miotyAtClient_returnCode miotyAtSegmentTx_start(miotyAtSegmentTx * tx, miotyAtClient_ctx * ctx, miotyAtCmd_id cmd, uint8_t const * data, size_t size, uint8_t maxPayload, uint8_t msgId, miotyAtSegmentRx * rx);
+
+/**
+ * @brief Send the remaining segments (blocking)
+ *
+ * Stops at the first failed uplink and returns its error, calling it again resumes with that segment.
+ */
+miotyAtClient_returnCode miotyAtSegmentTx_send(miotyAtSegmentTx * tx);
+
+/**
+ * @brief All segments have been sent
+ */
+static inline bool miotyAtSegmentTx_done(miotyAtSegmentTx const * tx) {
+    return tx->next >= tx->count;
+}
+
+/**
+ * @brief Initialize rx to reassemble messages of up to cap bytes into buf
+ */
+void miotyAtSegmentRx_init(miotyAtSegmentRx * rx, uint8_t * buf, size_t cap);
+
+/**
+ * @brief Add a received segment
+ *
+ * Segments are expected in order, a repeated segment is ignored and a new message id drops an incomplete message.
+ * After MIOTYATSEGMENT_COMPLETE the message is in rx->buf with rx->len bytes until the next segment is added.
+ * If rx->mpf is set, the MPF field in front of the header is not part of the message and kept in rx->mpfField.
+ */
+miotyAtSegment_status miotyAtSegmentRx_feed(miotyAtSegmentRx * rx, uint8_t const * segment, uint8_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
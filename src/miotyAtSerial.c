@@ -0,0 +1,297 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Serial transport for Linux hosts: termios raw mode, non-blocking I/O and an epoll event loop
+ */
+
+#if defined(__linux__)
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include "miotyAtSerial.h"
+
+static speed_t baud_speed(uint32_t baudrate);
+static bool write_all(miotyAtSerial * serial, uint8_t const * data, size_t size);
+static void serial_write(void * user, uint8_t * data, uint16_t size);
+static void serial_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt);
+static bool serial_read(void * user, uint8_t * buf, uint8_t * len);
+static bool serial_readn(void * user, uint8_t * buf, size_t cap, size_t * len);
+static uint32_t serial_clock(void * user);
+static int ms_to_deadline(miotyAtClient_ctx * ctx, int limitMs);
+
+
+bool miotyAtSerial_open(miotyAtSerial * serial, char const * path, uint32_t baudrate) {
+    memset(serial, 0, sizeof(*serial));
+    serial->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (serial->fd < 0)
+        return false;
+
+    struct termios tio;
+    if (tcgetattr(serial->fd, &tio) != 0) {
+        miotyAtSerial_close(serial);
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(serial->fd, TCSANOW, &tio) != 0 || !miotyAtSerial_setBaudrate(serial, baudrate)) {
+        int err = errno;
+        miotyAtSerial_close(serial);
+        errno = err;
+        return false;
+    }
+    tcflush(serial->fd, TCIOFLUSH);
+    return true;
+}
+
+void miotyAtSerial_close(miotyAtSerial * serial) {
+    if (serial->fd >= 0)
+        close(serial->fd);
+    serial->fd = -1;
+}
+
+bool miotyAtSerial_setBaudrate(void * user, uint32_t baudrate) {
+    miotyAtSerial * serial = user;
+    speed_t speed = baud_speed(baudrate);
+    struct termios tio;
+    if (speed == B0) {
+        errno = EINVAL;
+        return false;
+    }
+    tcdrain(serial->fd);
+    if (tcgetattr(serial->fd, &tio) != 0 || cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0
+            || tcsetattr(serial->fd, TCSANOW, &tio) != 0)
+        return false;
+    serial->baudrate = baudrate;
+    return true;
+}
+
+void miotyAtSerial_bind(miotyAtSerial * serial, miotyAtClient_ctx * ctx) {
+    serial->ctx = ctx;
+    miotyAtClientCtx_init(ctx, serial_write, serial_read, serial);
+    miotyAtClientCtx_setWritev(ctx, serial_writev);
+    miotyAtClientCtx_setReadn(ctx, serial_readn);
+    miotyAtClientCtx_setClock(ctx, serial_clock);
+}
+
+bool miotyAtSerial_service(miotyAtSerial * serial) {
+    miotyAtClient_ctx * ctx = serial->ctx;
+    for (;;) {
+        ssize_t n = read(serial->fd, ctx->rxBuf, sizeof(ctx->rxBuf));
+        if (n > 0) {
+            miotyAtClientCtx_feed(ctx, ctx->rxBuf, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno != EAGAIN) {
+            miotyAtClientCtx_abort(ctx, MIOTYATCLIENT_RETURN_CODE_ATReadFailed);
+            return false;
+        }
+        break;
+    }
+    miotyAtClientCtx_checkDeadline(ctx);
+    return true;
+}
+
+bool miotyAtSerialLoop_init(miotyAtSerialLoop * loop) {
+    memset(loop, 0, sizeof(*loop));
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    return loop->epfd >= 0;
+}
+
+bool miotyAtSerialLoop_add(miotyAtSerialLoop * loop, miotyAtSerial * serial) {
+    if (loop->count == MIOTYATSERIAL_LOOP_SIZE)
+        return false;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = serial };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, serial->fd, &ev) != 0)
+        return false;
+    loop->serial[loop->count++] = serial;
+    return true;
+}
+
+void miotyAtSerialLoop_remove(miotyAtSerialLoop * loop, miotyAtSerial * serial) {
+    for (uint8_t i = 0; i < loop->count; i++) {
+        if (loop->serial[i] == serial) {
+            epoll_ctl(loop->epfd, EPOLL_CTL_DEL, serial->fd, NULL);
+            loop->serial[i] = loop->serial[--loop->count];
+            return;
+        }
+    }
+}
+
+int miotyAtSerialLoop_run(miotyAtSerialLoop * loop, int timeoutMs) {
+    struct epoll_event events[MIOTYATSERIAL_LOOP_SIZE];
+    int n = epoll_wait(loop->epfd, events, MIOTYATSERIAL_LOOP_SIZE, miotyAtSerialLoop_timeout(loop, timeoutMs));
+    if (n < 0)
+        return -1;
+    for (int i = 0; i < n; i++) {
+        miotyAtSerial * serial = events[i].data.ptr;
+        if (!miotyAtSerial_service(serial) || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+            miotyAtClientCtx_abort(serial->ctx, MIOTYATCLIENT_RETURN_CODE_ATReadFailed);
+            miotyAtSerialLoop_remove(loop, serial);
+        }
+    }
+    // modems without input may have passed their deadline
+    for (uint8_t i = 0; i < loop->count; i++)
+        miotyAtClientCtx_checkDeadline(loop->serial[i]->ctx);
+    return n;
+}
+
+int miotyAtSerialLoop_timeout(miotyAtSerialLoop * loop, int limitMs) {
+    for (uint8_t i = 0; i < loop->count; i++)
+        limitMs = ms_to_deadline(loop->serial[i]->ctx, limitMs);
+    return limitMs;
+}
+
+void miotyAtSerialLoop_close(miotyAtSerialLoop * loop) {
+    if (loop->epfd >= 0)
+        close(loop->epfd);
+    loop->epfd = -1;
+    loop->count = 0;
+}
+
+static speed_t baud_speed(uint32_t baudrate) {
+    switch (baudrate) {
+    case 9600:      return B9600;
+    case 19200:     return B19200;
+    case 38400:     return B38400;
+    case 57600:     return B57600;
+    case 115200:    return B115200;
+    case 230400:    return B230400;
+    case 460800:    return B460800;
+    case 921600:    return B921600;
+    default:        return B0;
+    }
+}
+
+// waits for the tty whenever its output buffer is full
+static bool write_all(miotyAtSerial * serial, uint8_t const * data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(serial->fd, data, size);
+        if (n > 0) {
+            data += n;
+            size -= n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        struct pollfd pfd = { .fd = serial->fd, .events = POLLOUT };
+        if ((n < 0 && errno != EAGAIN) || poll(&pfd, 1, MIOTYATSERIAL_WRITE_WAIT_MS) <= 0)
+            return false;
+    }
+    return true;
+}
+
+static void serial_write(void * user, uint8_t * data, uint16_t size) {
+    miotyAtSerial * serial = user;
+    if (!write_all(serial, data, size))
+        serial->writeErrors++;
+}
+
+// one writev() syscall per command, a partial write is completed segment by segment
+static void serial_writev(void * user, miotyAtClient_iovec const * iov, uint8_t iovcnt) {
+    miotyAtSerial * serial = user;
+    struct iovec vec[4];
+    if (iovcnt > 4) {
+        for (uint8_t i = 0; i < iovcnt; i++)
+            serial_write(user, (uint8_t *)iov[i].data, iov[i].size);
+        return;
+    }
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        vec[i].iov_base = (void *)iov[i].data;
+        vec[i].iov_len = iov[i].size;
+    }
+    ssize_t n = writev(serial->fd, vec, iovcnt);
+    if (n < 0)
+        n = 0;
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        size_t skip = (size_t)n < iov[i].size ? (size_t)n : iov[i].size;
+        n -= skip;
+        if (!write_all(serial, iov[i].data + skip, iov[i].size - skip)) {
+            serial->writeErrors++;
+            return;
+        }
+    }
+}
+
+static bool serial_read(void * user, uint8_t * buf, uint8_t * len) {
+    size_t n;
+    bool ok = serial_readn(user, buf, *len, &n);
+    *len = n;
+    return ok;
+}
+
+// used by blocking calls: waits a while for input, bounded by the deadline of the pending command
+static bool serial_readn(void * user, uint8_t * buf, size_t cap, size_t * len) {
+    miotyAtSerial * serial = user;
+    struct pollfd pfd = { .fd = serial->fd, .events = POLLIN };
+    *len = 0;
+    int ready = poll(&pfd, 1, ms_to_deadline(serial->ctx, MIOTYATSERIAL_READ_WAIT_MS));
+    if (ready < 0)
+        return errno == EINTR;
+    if (ready == 0)
+        return true;
+    if (!(pfd.revents & POLLIN))
+        return false;
+    ssize_t n = read(serial->fd, buf, cap);
+    if (n < 0)
+        return errno == EAGAIN || errno == EINTR;
+    if (n == 0 && (pfd.revents & (POLLHUP | POLLERR)))
+        return false;
+    *len = n;
+    return true;
+}
+
+static uint32_t serial_clock(void * user) {
+    (void)user;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000);
+}
+
+// limitMs shortened to the deadline of the pending command of ctx, -1 means no limit
+static int ms_to_deadline(miotyAtClient_ctx * ctx, int limitMs) {
+    miotyAtClient_txn const * txn = &ctx->txn;
+    if ((!txn->pending && !txn->draining) || !txn->hasDeadline)
+        return limitMs;
+    int32_t left = (int32_t)(txn->deadline - ctx->clock(ctx->user));
+    if (left < 0)
+        left = 0;
+    return limitMs < 0 || left < limitMs ? left : limitMs;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * \copyright    Copyright 2019 - 2022 Fraunhofer Institute for Integrated Circuits IIS, Erlangen Germany
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ 
+/**
+ * \file
+ * \version     0.0.1
+ * \brief       Serial transport for Linux hosts: termios raw mode, non-blocking I/O and an epoll event loop
+ *
+ * miotyAtSerial_open() opens a tty (or the slave of a pseudo-terminal) in raw 8N1 mode without flow control.
+ * miotyAtSerial_bind() sets up a client context on it. Blocking calls wait in poll() for the response, the
+ * *Async calls return right away and are completed by miotyAtSerialLoop_run(), which services any number
+ * of modems from one thread.
+ *
+ * Only compiled on Linux.
+ */
+
+#ifndef _AT_SERIAL_H
+#define _AT_SERIAL_H
+
+#include "miotyAtClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// longest wait of one read in blocking calls, the deadline is checked in between
+#ifndef MIOTYATSERIAL_READ_WAIT_MS
+#define MIOTYATSERIAL_READ_WAIT_MS      50
+#endif
+
+// longest wait for the tty to accept more output
+#ifndef MIOTYATSERIAL_WRITE_WAIT_MS
+#define MIOTYATSERIAL_WRITE_WAIT_MS     1000
+#endif
+
+// modems per event loop
+#ifndef MIOTYATSERIAL_LOOP_SIZE
+#define MIOTYATSERIAL_LOOP_SIZE         16
+#endif
+
+typedef struct miotyAtSerial {
+    int fd;
+    uint32_t baudrate;
+    miotyAtClient_ctx * ctx;    // context bound with miotyAtSerial_bind()
+    uint32_t writeErrors;       // commands that could not be written completely
+} miotyAtSerial;
+
+typedef struct miotyAtSerialLoop {
+    int epfd;
+    uint8_t count;
+    miotyAtSerial * serial[MIOTYATSERIAL_LOOP_SIZE];
+} miotyAtSerialLoop;
+
+/**
+ * @brief Open the tty at path in raw mode with baudrate
+ *
+ * @return false if the tty can't be opened or doesn't support baudrate, errno tells why
+ */
+bool miotyAtSerial_open(miotyAtSerial * serial, char const * path, uint32_t baudrate);
+
+void miotyAtSerial_close(miotyAtSerial * serial);
+
+/**
+ * @brief Switch the tty to baudrate after pending output is sent
+ *
+ * Matches miotyAtClient_baudHook with user pointing to the miotyAtSerial, see miotyAtClientCtx_negotiateBaudrate().
+ */
+bool miotyAtSerial_setBaudrate(void * serial, uint32_t baudrate);
+
+/**
+ * @brief Initialize ctx for the modem at serial, with write, writev, readn and clock hooks
+ */
+void miotyAtSerial_bind(miotyAtSerial * serial, miotyAtClient_ctx * ctx);
+
+/**
+ * @brief Pass everything readable to the bound context and enforce its deadline, never blocks
+ *
+ * Reads into the receive buffer of the context, one read() per MIOTYATCLIENT_RX_CHUNK_SIZE bytes (4 KiB by
+ * default on Linux) until the tty is empty. A smaller buffer only costs more syscalls.
+ *
+ * @return false if reading failed, the pending command then ended with MIOTYATCLIENT_RETURN_CODE_ATReadFailed
+ */
+bool miotyAtSerial_service(miotyAtSerial * serial);
+
+/**
+ * @brief Create an event loop
+ *
+ * @return false if epoll is not available
+ */
+bool miotyAtSerialLoop_init(miotyAtSerialLoop * loop);
+
+/**
+ * @brief Service serial, bound to its context, in loop
+ *
+ * @return false if the loop is full or epoll refuses the fd
+ */
+bool miotyAtSerialLoop_add(miotyAtSerialLoop * loop, miotyAtSerial * serial);
+
+void miotyAtSerialLoop_remove(miotyAtSerialLoop * loop, miotyAtSerial * serial);
+
+/**
+ * @brief Wait up to timeoutMs for input of any modem of loop and service it
+ *
+ * Returns early when a pending command hits its deadline, which is then enforced. Completion callbacks of
+ * the *Async calls run from here. timeoutMs=-1 waits until input arrives or a deadline passes. A modem whose
+ * tty hangs up or fails is removed from loop, its pending command ends with MIOTYATCLIENT_RETURN_CODE_ATReadFailed.
+ *
+ * @return number of modems that had input, -1 if waiting failed (e.g. EINTR)
+ */
+int miotyAtSerialLoop_run(miotyAtSerialLoop * loop, int timeoutMs);
+
+/**
+ * @brief Time in ms until the earliest deadline of the commands pending in loop, at most limitMs
+ *
+ * For applications waiting on the fd of the loop (loop->epfd) in their own event loop.
+ * limitMs=-1 means no limit, -1 is returned if no deadline is pending.
+ */
+int miotyAtSerialLoop_timeout(miotyAtSerialLoop * loop, int limitMs);
+
+void miotyAtSerialLoop_close(miotyAtSerialLoop * loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif